@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#include "bench.hpp"
+
+namespace utxord::bench {
+
+std::atomic<uint64_t> g_alloc_count = 0;
+
+BenchConfig ParseBenchArgs(int argc, char* argv[])
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (++i >= argc) throw std::invalid_argument("Missing value for " + arg);
+            return argv[i];
+        };
+
+        if (arg == "--filter") config.filter = value();
+        else if (arg == "--min-time-ms") config.min_time = std::chrono::milliseconds(std::stoul(value()));
+        else if (arg == "--samples") config.samples = std::max<uint32_t>(1, std::stoul(value()));
+        else config.args.emplace_back(move(arg));
+    }
+    return config;
+}
+
+} // utxord::bench
+
+void* operator new(std::size_t size)
+{
+    utxord::bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{ return ::operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    utxord::bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{ return ::operator new(size, tag); }
+
+void operator delete(void* p) noexcept
+{ std::free(p); }
+
+void operator delete[](void* p) noexcept
+{ std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept
+{ std::free(p); }
+
+void operator delete[](void* p, std::size_t) noexcept
+{ std::free(p); }
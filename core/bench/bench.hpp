@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace utxord::bench {
+
+// Counted by the global operator new replacement defined in bench.cpp
+extern std::atomic<uint64_t> g_alloc_count;
+
+struct BenchConfig
+{
+    std::string filter;
+    std::chrono::milliseconds min_time {200};
+    uint32_t samples = 5;
+    std::vector<std::string> args; // positional arguments left for the particular bench binary
+};
+
+// Parses --filter <substr>, --min-time-ms <ms> and --samples <n>; everything else goes to BenchConfig::args
+BenchConfig ParseBenchArgs(int argc, char* argv[]);
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double allocs_per_op = 0;
+};
+
+class BenchRunner
+{
+    BenchConfig m_config;
+    std::vector<BenchResult> m_results;
+
+public:
+    explicit BenchRunner(BenchConfig config) : m_config(std::move(config)) {}
+
+    const BenchConfig& Config() const
+    { return m_config; }
+
+    const std::vector<BenchResult>& Results() const
+    { return m_results; }
+
+    bool Selected(const std::string& name) const
+    { return m_config.filter.empty() || name.find(m_config.filter) != std::string::npos; }
+
+    // Runs op() in batches until min_time is spent per sample and reports the median sample.
+    // Setup work which should not be measured must be done by the caller before Run().
+    void Run(const std::string& name, const std::function<void()>& op)
+    {
+        if (!Selected(name)) return;
+
+        op(); // warm up caches and lazily initialized state
+
+        uint64_t batch = 1;
+        for (;;) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < batch; ++i) op();
+            auto spent = std::chrono::steady_clock::now() - start;
+            if (spent * 10 >= m_config.min_time || batch >= (1ull << 30)) break;
+            batch *= 2;
+        }
+
+        std::vector<BenchResult> samples;
+        samples.reserve(m_config.samples);
+        for (uint32_t s = 0; s < m_config.samples; ++s) {
+            uint64_t iterations = 0;
+            uint64_t allocs_before = g_alloc_count.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            std::chrono::nanoseconds spent {0};
+            do {
+                for (uint64_t i = 0; i < batch; ++i) op();
+                iterations += batch;
+                spent = std::chrono::steady_clock::now() - start;
+            } while (spent < m_config.min_time);
+            uint64_t allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs_before;
+
+            samples.push_back({name, iterations, double(spent.count()) / double(iterations), double(allocs) / double(iterations)});
+        }
+
+        std::sort(samples.begin(), samples.end(), [](const auto& a, const auto& b) { return a.ns_per_op < b.ns_per_op; });
+        BenchResult& median = samples[samples.size() / 2];
+
+        std::cout << std::left << std::setw(64) << median.name
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(1) << median.ns_per_op << " ns/op"
+                  << std::setw(12) << std::setprecision(1) << median.allocs_per_op << " allocs/op"
+                  << std::setw(12) << median.iterations << " iter" << std::endl;
+
+        m_results.emplace_back(std::move(median));
+    }
+};
+
+} // utxord::bench
@@ -0,0 +1,292 @@
+#include <iostream>
+#include <cstdio>
+
+#include "util/translation.h"
+#include "core_io.h"
+
+#include "keyregistry.hpp"
+#include "contract_builder.hpp"
+#include "simple_transaction.hpp"
+#include "coin_selection.hpp"
+#include "create_inscription.hpp"
+#include "inscription.hpp"
+#include "runes.hpp"
+#include "bip322.hpp"
+
+#include "bench.hpp"
+
+using namespace l15;
+using namespace l15::core;
+using namespace utxord;
+using namespace utxord::bench;
+
+const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+namespace {
+
+const ChainMode chain = REGTEST;
+const char* const seedhex = "b37f263befa23efb352f0ba45a5e452363963fabc64c946a75df155244630ebaa1ac8056b873e79232486d5dd36809f8925c9c5ac8322f5380940badc64cc6fe";
+
+const std::vector<uint32_t> input_counts = {1, 10, 100};
+const std::vector<uint32_t> output_counts = {1, 10, 100};
+const std::vector<size_t> content_sizes = {1024, 64 * 1024, 390 * 1024};
+const std::vector<uint32_t> edict_counts = {1, 4, 8};
+const std::vector<uint32_t> utxo_pool_sizes = {1000, 10000, 50000};
+
+class BenchKeys
+{
+    KeyRegistry m_keyreg;
+public:
+    BenchKeys() : m_keyreg(chain, seedhex)
+    {
+        m_keyreg.AddKeyType("fund", R"({"look_cache":true, "key_type":"DEFAULT", "accounts":["0'","1'"], "change":["0","1"], "index_range":"0-256"})");
+        m_keyreg.AddKeyType("inscribe", R"({"look_cache":true, "key_type":"TAPSCRIPT", "accounts":["0'","3'","4'"], "change":["0","1"], "index_range":"0-256"})");
+    }
+
+    KeyRegistry& keyreg() { return m_keyreg; }
+
+    static std::string keypath(uint32_t purpose, uint32_t account, uint32_t change, uint32_t index)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "m/%d'/%d'/%d'/%d/%d", purpose, chain == MAINNET ? 0 : 1, account, change, index);
+        return {buf};
+    }
+
+    KeyPair derive(uint32_t purpose, uint32_t account, uint32_t change, uint32_t index, bool for_script = true)
+    { return m_keyreg.Derive(keypath(purpose, account, change, index), for_script); }
+
+    std::string p2tr(uint32_t account, uint32_t change, uint32_t index)
+    { return derive(86, account, change, index, false).GetP2TRAddress(Bech32(BTC, chain)); }
+
+    std::string p2wpkh(uint32_t account, uint32_t change, uint32_t index)
+    { return derive(84, account, change, index, false).GetP2WPKHAddress(Bech32(BTC, chain)); }
+};
+
+// Deterministic txid which never hits a real chain
+std::string FakeTxID(uint32_t n)
+{
+    char buf[65];
+    snprintf(buf, sizeof(buf), "%056x%08x", 0xbe, n + 1);
+    return {buf};
+}
+
+std::string Suffix(const char* name, size_t value)
+{ return std::string("/") + name + ":" + std::to_string(value); }
+
+SimpleTransaction MakeSimpleTx(BenchKeys& keys, uint32_t ins, uint32_t outs)
+{
+    SimpleTransaction tx(chain);
+    tx.MiningFeeRate(3000);
+    for (uint32_t i = 0; i < ins; ++i) {
+        tx.AddUTXO(FakeTxID(i), i % 4, 100000, (i % 2) ? keys.p2wpkh(0, 0, i % 256) : keys.p2tr(0, 0, i % 256));
+    }
+    CAmount amount = (CAmount(ins) * 100000 / 2) / outs;
+    for (uint32_t i = 0; i < outs; ++i) {
+        tx.AddOutput(amount, keys.p2tr(1, 0, i % 256));
+    }
+    tx.AddChangeOutput(keys.p2tr(0, 1, 0));
+    return tx;
+}
+
+CreateInscriptionBuilder MakeInscription(BenchKeys& keys, uint32_t ins, size_t content_size)
+{
+    bytevector content(content_size);
+    for (size_t i = 0; i < content_size; ++i) content[i] = static_cast<uint8_t>(i * 31 + 7);
+
+    CreateInscriptionBuilder inscription(chain, INSCRIPTION);
+    inscription.MarketFee(0, keys.p2tr(0, 0, 1));
+    inscription.MiningFeeRate(1500);
+    inscription.Data("application/octet-stream", move(content));
+    inscription.OrdOutput(546, keys.p2tr(0, 0, 0));
+    inscription.ChangeAddress(keys.p2tr(0, 1, 1));
+    inscription.InscribeScriptPubKey(keys.derive(86, 0, 0, 0).GetSchnorrKeyPair().GetPubKey());
+    inscription.InscribeInternalPubKey(keys.derive(86, 4, 0, 0).GetSchnorrKeyPair().GetPubKey());
+
+    CAmount input_amount = (CAmount(content_size) + 200000) / ins + 1000;
+    for (uint32_t i = 0; i < ins; ++i) {
+        inscription.AddUTXO(FakeTxID(i), i % 4, input_amount, keys.p2wpkh(0, 0, i % 256));
+    }
+    return inscription;
+}
+
+RuneStone MakeRuneStone(uint32_t edicts)
+{
+    RuneStone runestone;
+    for (uint32_t i = 0; i < edicts; ++i) {
+        runestone.op_dictionary.emplace(RuneId(840000 + i, i), std::make_tuple(uint128_t(1000) * (i + 1), i));
+    }
+    return runestone;
+}
+
+void BenchSimpleTx(BenchRunner& runner, BenchKeys& keys)
+{
+    auto pool = std::make_shared<WorkerPool>();
+
+    for (uint32_t ins: input_counts) {
+        for (uint32_t outs: output_counts) {
+            std::string suffix = Suffix("inputs", ins) + Suffix("outputs", outs);
+
+            SimpleTransaction tx = MakeSimpleTx(keys, ins, outs);
+            runner.Run("SimpleTransaction::Sign" + suffix, [&]() { tx.Sign(keys.keyreg(), "fund"); });
+
+            tx.Sign(keys.keyreg(), "fund");
+            runner.Run("SimpleTransaction::CheckSig" + suffix, [&]() { tx.CheckSig(); });
+
+            if (ins > 1) {
+                SimpleTransaction parallel_tx = tx;
+                parallel_tx.WorkerThreads(pool);
+                runner.Run("SimpleTransaction::Sign" + suffix + Suffix("threads", pool->Concurrency()), [&]() { parallel_tx.Sign(keys.keyreg(), "fund"); });
+                runner.Run("SimpleTransaction::CheckSig" + suffix + Suffix("threads", pool->Concurrency()), [&]() { parallel_tx.CheckSig(); });
+            }
+
+            runner.Run("SimpleTransaction::Serialize" + suffix, [&]() { tx.Serialize(tx.GetVersion(), TX_SIGNATURE); });
+
+            std::string data = tx.Serialize(tx.GetVersion(), TX_SIGNATURE);
+            runner.Run("SimpleTransaction::Deserialize" + suffix, [&]() {
+                SimpleTransaction copy(chain);
+                copy.Deserialize(data, TX_SIGNATURE);
+            });
+        }
+    }
+}
+
+void BenchCreateInscription(BenchRunner& runner, BenchKeys& keys)
+{
+    for (uint32_t ins: input_counts) {
+        for (size_t size: content_sizes) {
+            std::string suffix = Suffix("inputs", ins) + Suffix("content", size);
+
+            CreateInscriptionBuilder inscription = MakeInscription(keys, ins, size);
+            runner.Run("CreateInscriptionBuilder::CalculateWholeFee" + suffix, [&]() { inscription.CalculateWholeFee(IContractBuilder::FEE_OPT_HAS_CHANGE); });
+
+            runner.Run("CreateInscriptionBuilder::SignCommit" + suffix, [&]() { inscription.SignCommit(keys.keyreg(), "fund"); });
+            inscription.SignCommit(keys.keyreg(), "fund");
+
+            runner.Run("CreateInscriptionBuilder::SignInscription" + suffix, [&]() { inscription.SignInscription(keys.keyreg(), "inscribe"); });
+            inscription.SignInscription(keys.keyreg(), "inscribe");
+
+            runner.Run("CreateInscriptionBuilder::Serialize" + suffix, [&]() { inscription.Serialize(inscription.GetVersion(), INSCRIPTION_SIGNATURE); });
+
+            std::string data = inscription.Serialize(inscription.GetVersion(), INSCRIPTION_SIGNATURE);
+            runner.Run("CreateInscriptionBuilder::Deserialize" + suffix, [&]() {
+                CreateInscriptionBuilder copy(chain, INSCRIPTION);
+                copy.Deserialize(data, INSCRIPTION_SIGNATURE);
+            });
+
+            runner.Run("CreateInscriptionBuilder::SerializeBinary" + suffix, [&]() { inscription.SerializeBinary(inscription.GetVersion(), INSCRIPTION_SIGNATURE); });
+
+            bytevector binary = inscription.SerializeBinary(inscription.GetVersion(), INSCRIPTION_SIGNATURE);
+            runner.Run("CreateInscriptionBuilder::DeserializeBinary" + suffix, [&]() {
+                CreateInscriptionBuilder copy(chain, INSCRIPTION);
+                copy.DeserializeBinary(binary, INSCRIPTION_SIGNATURE);
+            });
+
+            if (ins == 1) {
+                std::string genesis_hex = inscription.RawTransactions()[1];
+                runner.Run("ParseInscriptions" + Suffix("content", size), [&]() { ParseInscriptions(genesis_hex); });
+            }
+        }
+    }
+}
+
+void BenchCoinSelection(BenchRunner& runner, BenchKeys& keys)
+{
+    std::vector<std::string> addresses;
+    for (uint32_t i = 0; i < 256; ++i) addresses.emplace_back((i % 2) ? keys.p2wpkh(0, 0, i) : keys.p2tr(0, 0, i));
+    std::string change_addr = keys.p2tr(0, 1, 0);
+
+    for (uint32_t pool_size: utxo_pool_sizes) {
+        CoinSelector selector(chain);
+        for (uint32_t i = 0; i < pool_size; ++i) {
+            selector.AddUTXO(FakeTxID(i), i % 4, 1000 + CAmount(i % 1000) * 1009 + i, addresses[i % addresses.size()]);
+        }
+
+        for (CAmount amount: {CAmount(20000), CAmount(5000000)}) {
+            SimpleTransaction tx(chain);
+            tx.MiningFeeRate(3000);
+            tx.AddOutput(amount, keys.p2tr(1, 0, 0));
+
+            runner.Run("CoinSelector::Select" + Suffix("pool", pool_size) + Suffix("amount", amount), [&]() { selector.Select(tx, change_addr); });
+        }
+
+        // Fee rate changes on every call, so the effective values are re-evaluated each time
+        SimpleTransaction tx(chain);
+        tx.AddOutput(20000, keys.p2tr(1, 0, 0));
+        CAmount fee_rate = 3000;
+        runner.Run("CoinSelector::Select/fee_rate_change" + Suffix("pool", pool_size), [&]() {
+            tx.MiningFeeRate(fee_rate = (fee_rate == 3000) ? 3001 : 3000);
+            selector.Select(tx, change_addr);
+        });
+
+        // Inscription bearing candidates in the pool take the filtered path
+        CoinSelector tagged_selector(chain);
+        for (uint32_t i = 0; i < pool_size; ++i) {
+            tagged_selector.AddUTXO(FakeTxID(i), i % 4, 1000 + CAmount(i % 1000) * 1009 + i, addresses[i % addresses.size()], (i % 100) ? "" : "inscription");
+        }
+        tx.MiningFeeRate(3000);
+        runner.Run("CoinSelector::Select/tagged" + Suffix("pool", pool_size), [&]() { tagged_selector.Select(tx, change_addr); });
+    }
+}
+
+void BenchRunes(BenchRunner& runner, BenchKeys& keys)
+{
+    for (uint32_t edicts: edict_counts) {
+        std::string suffix = Suffix("edicts", edicts);
+
+        RuneStone runestone = MakeRuneStone(edicts);
+        runner.Run("RuneStone::Pack" + suffix, [&]() { runestone.Pack(); });
+
+        bytevector packed = runestone.Pack();
+        runner.Run("RuneStone::Unpack" + suffix, [&]() {
+            RuneStone unpacked;
+            unpacked.Unpack(packed);
+        });
+
+        SimpleTransaction tx(chain);
+        tx.MiningFeeRate(3000);
+        tx.AddUTXO(FakeTxID(0), 0, 100000, keys.p2tr(0, 0, 0));
+        for (uint32_t i = 0; i < edicts; ++i) {
+            tx.AddRuneOutput(546, keys.p2tr(1, 0, i), RuneId(840000 + i, i), uint128_t(1000) * (i + 1));
+        }
+        std::string hex_tx = EncodeHexTx(CTransaction(tx.MakeTx("")));
+        runner.Run("ParseRuneStone" + suffix, [&]() { ParseRuneStone(hex_tx, chain); });
+    }
+}
+
+void BenchBip322(BenchRunner& runner, BenchKeys& keys)
+{
+    Bip322 bip322(chain);
+    bytevector message(64, 'm');
+
+    for (const auto& [type, addr]: {std::make_pair("p2tr", keys.p2tr(0, 0, 0)), std::make_pair("p2wpkh", keys.p2wpkh(0, 0, 0))}) {
+        bytevector sig = bip322.Sign(keys.keyreg(), "fund", addr, message);
+        runner.Run(std::string("Bip322::Verify/") + type, [&]() {
+            if (!bip322.Verify(sig, addr, message)) throw std::runtime_error("BIP322 signature is not valid");
+        });
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    try {
+        BenchRunner runner(ParseBenchArgs(argc, argv));
+        BenchKeys keys;
+
+        BenchSimpleTx(runner, keys);
+        BenchCreateInscription(runner, keys);
+        BenchCoinSelection(runner, keys);
+        BenchRunes(runner, keys);
+        BenchBip322(runner, keys);
+    }
+    catch (const Error& e) {
+        std::cerr << e.what() << ": " << e.details() << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
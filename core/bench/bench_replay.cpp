@@ -0,0 +1,252 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <array>
+
+#include "nlohmann/json.hpp"
+
+#include "util/translation.h"
+
+#include "simple_transaction.hpp"
+#include "create_inscription.hpp"
+#include "swap_inscription.hpp"
+#include "trustless_swap_inscription.hpp"
+
+#include "bench.hpp"
+
+using namespace l15;
+using namespace l15::core;
+using namespace utxord;
+using namespace utxord::bench;
+
+const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+namespace {
+
+ChainMode ParseChain(const std::string& chain_mode)
+{
+    if (chain_mode == "mainnet") return MAINNET;
+    if (chain_mode == "testnet" || chain_mode == "signet") return TESTNET;
+    if (chain_mode == "regtest") return REGTEST;
+    throw std::invalid_argument("Wrong --chain: " + chain_mode);
+}
+
+// TrustlessSwapInscriptionBuilder has no phase names of its own, so the corpus refers to the enum names
+TrustlessSwapPhase ParseTrustlessSwapPhase(const std::string& phase)
+{
+    static const std::map<std::string, TrustlessSwapPhase> phases = {
+        {"TRUSTLESS_ORD_TERMS", TRUSTLESS_ORD_TERMS},
+        {"TRUSTLESS_ORD_SWAP_SIG", TRUSTLESS_ORD_SWAP_SIG},
+        {"TRUSTLESS_FUNDS_TERMS", TRUSTLESS_FUNDS_TERMS},
+        {"TRUSTLESS_FUNDS_COMMIT_SIG", TRUSTLESS_FUNDS_COMMIT_SIG},
+        {"TRUSTLESS_FUNDS_SWAP_TERMS", TRUSTLESS_FUNDS_SWAP_TERMS},
+        {"TRUSTLESS_FUNDS_SWAP_SIG", TRUSTLESS_FUNDS_SWAP_SIG}
+    };
+    auto it = phases.find(phase);
+    if (it == phases.end()) throw ContractTermWrongValue("TrustlessSwapInscription phase: " + phase);
+    return it->second;
+}
+
+enum ReplayPhase { DESERIALIZE, CHECK_TERMS, SERIALIZE, RAW_TRANSACTIONS };
+const char* const replay_phase_names[] = {"Deserialize", "CheckContractTerms", "Serialize", "RawTransactions"};
+
+struct PhaseStat
+{
+    std::vector<uint64_t> latency_ns;
+    uint64_t allocs = 0;
+    uint64_t failures = 0;
+};
+
+std::string ErrorText(const std::exception& e)
+{
+    if (const auto* err = dynamic_cast<const Error*>(&e)) return std::string(err->what()) + ": " + err->details();
+    return e.what();
+}
+
+class ReplayStats
+{
+    std::map<std::string, std::array<PhaseStat, 4>> m_stats;
+    std::vector<std::string> m_errors;
+public:
+    // Failed phase is not counted into the latency, so the throughput is measured over the successful operations only
+    template <typename F>
+    bool Measure(const std::string& contract_type, ReplayPhase phase, F&& op)
+    {
+        PhaseStat& stat = m_stats[contract_type][phase];
+        uint64_t allocs_before = g_alloc_count.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        try {
+            op();
+        }
+        catch (const std::exception& e) {
+            ++stat.failures;
+            Fail(contract_type + ' ' + replay_phase_names[phase] + ": " + ErrorText(e));
+            return false;
+        }
+        stat.latency_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        stat.allocs += g_alloc_count.load(std::memory_order_relaxed) - allocs_before;
+        return true;
+    }
+
+    void Fail(std::string error)
+    { m_errors.emplace_back(move(error)); }
+
+    const std::vector<std::string>& Errors() const
+    { return m_errors; }
+
+    void Print(std::ostream& out)
+    {
+        out << std::left << std::setw(24) << "contract" << std::setw(20) << "phase"
+            << std::right << std::setw(10) << "count" << std::setw(10) << "failed"
+            << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(12) << "p999 ns" << std::setw(14) << "allocs/op" << '\n';
+
+        for (auto& [type, phases]: m_stats) {
+            for (size_t i = 0; i < phases.size(); ++i) {
+                auto& latency = phases[i].latency_ns;
+                if (latency.empty() && !phases[i].failures) continue;
+
+                if (latency.empty()) {
+                    out << std::left << std::setw(24) << type << std::setw(20) << replay_phase_names[i]
+                        << std::right << std::setw(10) << 0 << std::setw(10) << phases[i].failures << '\n';
+                    continue;
+                }
+
+                std::sort(latency.begin(), latency.end());
+                auto percentile = [&](double p) { return latency[std::min(latency.size() - 1, size_t(p * double(latency.size())))]; };
+
+                out << std::left << std::setw(24) << type << std::setw(20) << replay_phase_names[i]
+                    << std::right << std::setw(10) << latency.size() << std::setw(10) << phases[i].failures
+                    << std::setw(12) << percentile(0.5) << std::setw(12) << percentile(0.99) << std::setw(12) << percentile(0.999)
+                    << std::setw(14) << std::fixed << std::setprecision(1) << double(phases[i].allocs) / double(latency.size()) << '\n';
+            }
+        }
+    }
+};
+
+// Returns false if any phase fails; the phases after the failed one are not run
+template <typename BUILDER, typename PHASE>
+bool ReplayContract(ReplayStats& stats, BUILDER& contract, const std::string& contract_string, uint32_t version, PHASE phase,
+                    const std::function<std::vector<std::string>(const BUILDER&)>& raw_transactions)
+{
+    const std::string& type = contract.GetContractName();
+    // CheckContractTerms() is not public for every builder, so call it through the base
+    const ContractBuilder<PHASE>& base = contract;
+
+    return stats.Measure(type, DESERIALIZE, [&]() { contract.Deserialize(contract_string, phase); })
+        && stats.Measure(type, CHECK_TERMS, [&]() { base.CheckContractTerms(version, phase); })
+        && stats.Measure(type, SERIALIZE, [&]() { contract.Serialize(version, phase); })
+        && stats.Measure(type, RAW_TRANSACTIONS, [&]() { raw_transactions(contract); });
+}
+
+}
+
+// Replays contract corpora in the regression.json format:
+//   bench_replay [--chain mainnet|testnet|signet|regtest] [--repeat N] corpus.json [corpus2.json ...]
+// Exits with code 2 if any contract fails to replay, the failures are listed to stderr.
+int main(int argc, char* argv[])
+{
+    try {
+        BenchConfig config = ParseBenchArgs(argc, argv);
+
+        ChainMode chain = REGTEST;
+        uint32_t repeat = 1;
+        std::vector<std::string> corpus_paths;
+        for (auto it = config.args.begin(); it != config.args.end(); ++it) {
+            if (*it == "--repeat" && std::next(it) != config.args.end()) repeat = std::max<uint32_t>(1, std::stoul(*++it));
+            else if (*it == "--chain" && std::next(it) != config.args.end()) chain = ParseChain(*++it);
+            else corpus_paths.push_back(*it);
+        }
+        if (corpus_paths.empty()) corpus_paths.emplace_back("regression.json");
+
+        std::vector<std::tuple<std::string, std::string, uint32_t, std::string>> corpus; // type, phase, version, contract
+        for (const auto& path: corpus_paths) {
+            std::ifstream s(path);
+            if (!s) throw std::invalid_argument("Cannot open corpus: " + path);
+            auto corpus_json = nlohmann::json::parse(s);
+            for (const auto& json: corpus_json["contracts"]) {
+                corpus.emplace_back(json["contract_type"].get<std::string>(), json["params"]["phase"].get<std::string>(),
+                                    json["params"]["protocol_version"].get<uint32_t>(), json.dump());
+            }
+        }
+
+        ReplayStats stats;
+        uint64_t replayed = 0;
+        uint64_t failed = 0;
+        std::string market_contract_cache;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < repeat; ++r) {
+            for (const auto& [type, phase_str, version, contract_string]: corpus) {
+                bool ok = false;
+                try {
+                    if (type == "transaction") {
+                        SimpleTransaction contract(chain);
+                        ok = ReplayContract<SimpleTransaction, TxPhase>(stats, contract, contract_string, version, SimpleTransaction::ParsePhase(phase_str),
+                                                                        [](const auto& c) { return c.RawTransactions(); });
+                    }
+                    else if (type == "CreateInscription") {
+                        CreateInscriptionBuilder contract(chain, phase_str.starts_with("LAZY") ? LAZY_INSCRIPTION : INSCRIPTION);
+                        ok = ReplayContract<CreateInscriptionBuilder, InscribePhase>(stats, contract, contract_string, version, CreateInscriptionBuilder::ParsePhase(phase_str),
+                                                                                     [](const auto& c) { return c.RawTransactions(); });
+                    }
+                    else if (type == "SwapInscription") {
+                        SwapPhase phase = SwapInscriptionBuilder::ParsePhase(phase_str);
+                        if (phase == MARKET_PAYOFF_SIG) market_contract_cache = contract_string;
+
+                        SwapInscriptionBuilder contract(chain);
+                        if (phase == FUNDS_SWAP_SIG && !market_contract_cache.empty()) {
+                            contract.Deserialize(market_contract_cache, MARKET_PAYOFF_SIG);
+                        }
+                        ok = ReplayContract<SwapInscriptionBuilder, SwapPhase>(stats, contract, contract_string, version, phase,
+                                                                               [phase](const auto& c) {
+                            std::vector<std::string> txs;
+                            for (uint32_t n = 0; n < c.TransactionCount(phase); ++n) txs.emplace_back(c.RawTransaction(phase, n));
+                            return txs;
+                        });
+                    }
+                    else if (type == "TrustlessSwapInscription") {
+                        TrustlessSwapPhase phase = ParseTrustlessSwapPhase(phase_str);
+                        TrustlessSwapInscriptionBuilder contract(chain);
+                        ok = ReplayContract<TrustlessSwapInscriptionBuilder, TrustlessSwapPhase>(stats, contract, contract_string, version, phase,
+                                                                                                 [phase](const auto& c) {
+                            std::vector<std::string> txs;
+                            for (uint32_t n = 0; n < c.TransactionCount(phase); ++n) txs.emplace_back(c.RawTransaction(phase, n));
+                            return txs;
+                        });
+                    }
+                    else {
+                        stats.Fail("unsupported contract type: " + type);
+                    }
+                }
+                catch (const std::exception& e) {
+                    stats.Fail(type + ' ' + phase_str + ": " + ErrorText(e));
+                }
+
+                if (ok) ++replayed;
+                else ++failed;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        stats.Print(std::cout);
+        std::cout << '\n' << replayed << " contracts in " << std::fixed << std::setprecision(3) << seconds << " s: "
+                  << std::setprecision(1) << (seconds > 0 ? double(replayed) / seconds : 0.0) << " contracts/sec" << std::endl;
+
+        if (failed) {
+            std::cerr << "\nFAILED: " << failed << " of " << (failed + replayed) << " contracts" << std::endl;
+            const size_t max_listed = 50;
+            for (size_t i = 0; i < std::min(max_listed, stats.Errors().size()); ++i) std::cerr << "  " << stats.Errors()[i] << '\n';
+            if (stats.Errors().size() > max_listed) std::cerr << "  ... " << (stats.Errors().size() - max_listed) << " more" << '\n';
+            return 2;
+        }
+    }
+    catch (const Error& e) {
+        std::cerr << e.what() << ": " << e.details() << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -56,7 +56,7 @@ l15::bytevector Bip322::Sign(l15::core::KeyRegistry &keyreg, std::string keyhint
 
     auto signer = prevout->LookupKey(keyreg, keyhint);
 
-    TxInput input(m_chain, 0, std::make_shared<UTXO>(m_chain, tospend_txid.GetHex(), 0, prevout));
+    TxInput input(m_chain, 0, MakeContractObject<UTXO>(m_chain, tospend_txid.GetHex(), 0, prevout));
     signer->SignInput(input, tx, prevouts, SIGHASH_DEFAULT);
 
     const std::vector<bytevector>& witness = input.witness;
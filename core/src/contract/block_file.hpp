@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "contract_builder.hpp"
+
+namespace utxord {
+
+// Bitcoin Core blk*.dat files store every block prefixed with the network magic and the 32 bit LE block size
+const size_t BLOCK_FILE_HEADER_SIZE = 8;
+const size_t BLOCK_HEADER_SIZE = 80;
+
+inline std::array<uint8_t, 4> BlockFileMagic(ChainMode chain)
+{
+    if (chain == MAINNET) return {0xf9, 0xbe, 0xb4, 0xd9};
+    if (chain == TESTNET) return {0x0b, 0x11, 0x09, 0x07};
+    if (chain == REGTEST) return {0xfa, 0xbf, 0xb5, 0xda};
+    throw ContractTermWrongValue("chain mode: " + std::to_string(static_cast<int>(chain)));
+}
+
+}
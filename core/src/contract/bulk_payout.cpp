@@ -0,0 +1,94 @@
+#include "feerate.h"
+
+#include "transaction.hpp"
+#include "bulk_payout.hpp"
+
+namespace utxord {
+
+using l15::FormatAmount;
+
+std::vector<std::shared_ptr<SimpleTransaction>> BulkPayoutBuilder::Build() const
+{
+    if (m_outputs.empty()) throw ContractStateError(SimpleTransaction::name_outputs + " not defined");
+
+    const CAmount min_change = l15::Dust(DUST_RELAY_TX_FEE);
+    const auto change_dest = P2Address::Construct(m_chain, {}, m_change_addr);
+
+    std::vector<std::shared_ptr<SimpleTransaction>> parts;
+    size_t next_input = 0;
+    size_t next_output = 0;
+
+    while (next_output < m_outputs.size()) {
+        // Change output is reserved in advance: every part but the last one must have it to fund the next part
+        TxWeight weight;
+        weight.AddOutput(*change_dest);
+        CAmount funds = 0;
+        CAmount payout = 0;
+
+        std::shared_ptr<IContractOutput> chained_input;
+        if (!parts.empty()) {
+            auto change = parts.back()->ChangeOutput();
+            chained_input = MakeContractObject<ContractOutput>(parts.back(), change->NOut());
+            weight.AddInput(change->Destination()->DummyScriptSig(), change->Destination()->DummyWitness());
+            funds += change->Amount();
+        }
+
+        size_t part_inputs_begin = next_input;
+        size_t part_outputs_begin = next_output;
+
+        for (; next_output < m_outputs.size(); ++next_output) {
+            TxWeight next_weight = weight;
+            next_weight.AddOutput(*m_outputs[next_output]);
+            CAmount next_payout = payout + m_outputs[next_output]->Amount();
+            CAmount next_funds = funds;
+            size_t next_funding = next_input;
+
+            while (next_funds < next_payout + next_weight.Fee(m_mining_fee_rate) + min_change && next_funding < m_inputs.size()) {
+                const auto& dest = m_inputs[next_funding]->Destination();
+                next_weight.AddInput(dest->DummyScriptSig(), dest->DummyWitness());
+                next_funds += dest->Amount();
+                ++next_funding;
+            }
+
+            if (next_weight.Weight() > m_max_weight) {
+                if (next_output == part_outputs_begin)
+                    throw ContractTermWrongValue(SimpleTransaction::name_outputs + '[' + std::to_string(next_output) + "] does not fit standard transaction weight");
+                break;
+            }
+
+            if (next_funds < next_payout + next_weight.Fee(m_mining_fee_rate) + min_change) {
+                // The very last output may be paid w/o change
+                TxWeight changeless_weight = next_weight;
+                changeless_weight.RemoveOutput(*change_dest);
+                if (next_output + 1 != m_outputs.size() || next_funds < next_payout + changeless_weight.Fee(m_mining_fee_rate))
+                    throw ContractFundsNotEnough(FormatAmount(next_funds) + ", required: " + FormatAmount(next_payout + next_weight.Fee(m_mining_fee_rate) + min_change));
+            }
+
+            weight = next_weight;
+            payout = next_payout;
+            funds = next_funds;
+            next_input = next_funding;
+        }
+
+        auto part = MakeContractObject<SimpleTransaction>(m_chain);
+        part->MiningFeeRate(m_mining_fee_rate);
+        if (chained_input) part->AddInput(move(chained_input));
+        for (size_t i = part_inputs_begin; i < next_input; ++i) {
+            part->AddInput(m_inputs[i]);
+        }
+        for (size_t i = part_outputs_begin; i < next_output; ++i) {
+            part->AddOutputDestination(m_outputs[i]);
+        }
+
+        if (next_output < m_outputs.size() || funds >= payout + weight.Fee(m_mining_fee_rate) + min_change) {
+            part->AddChangeOutput(m_change_addr);
+            if (!part->ChangeOutput()) throw ContractStateError("bulk payout change output is missing for part " + std::to_string(parts.size()));
+        }
+
+        parts.emplace_back(move(part));
+    }
+
+    return parts;
+}
+
+}
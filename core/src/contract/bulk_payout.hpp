@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "policy.h"
+
+#include "contract_builder.hpp"
+#include "simple_transaction.hpp"
+
+namespace utxord {
+
+// Splits a long payout list into a chain of standard size transactions.
+// Every part spends the change of the previous one and draws funding inputs in the order they are added
+// when the chained change does not cover its outputs. The last part returns the rest to the change address
+// unless it is below dust. Funding inputs left unused are not included in any part.
+// Parts have to be signed in order when legacy (non-segwit) funding inputs are used since signing changes their txid.
+class BulkPayoutBuilder
+{
+    ChainMode m_chain;
+    CAmount m_mining_fee_rate;
+    std::string m_change_addr;
+    int64_t m_max_weight;
+
+    std::vector<std::shared_ptr<IContractOutput>> m_inputs;
+    std::vector<std::shared_ptr<IContractDestination>> m_outputs;
+
+public:
+    BulkPayoutBuilder(ChainMode chain, CAmount mining_fee_rate, std::string change_addr, int64_t max_weight = MAX_STANDARD_TX_WEIGHT)
+        : m_chain(chain), m_mining_fee_rate(mining_fee_rate), m_change_addr(move(change_addr)), m_max_weight(max_weight) {}
+
+    void AddInput(std::shared_ptr<IContractOutput> prevout)
+    {
+        if (!prevout) throw ContractTermWrongValue(IContractBuilder::name_utxo + '[' + std::to_string(m_inputs.size()) + ']');
+        m_inputs.emplace_back(move(prevout));
+    }
+
+    void AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr)
+    { AddInput(MakeContractObject<UTXO>(m_chain, move(txid), nout, amount, move(addr))); }
+
+    void AddOutputDestination(std::shared_ptr<IContractDestination> destination)
+    {
+        if (!destination) throw ContractTermWrongValue(SimpleTransaction::name_outputs + '[' + std::to_string(m_outputs.size()) + ']');
+        m_outputs.emplace_back(move(destination));
+    }
+
+    void AddOutput(CAmount amount, std::string addr)
+    { AddOutputDestination(P2Address::Construct(m_chain, amount, move(addr))); }
+
+    size_t CountOutputs() const
+    { return m_outputs.size(); }
+
+    // Ready to sign transactions; every next one spends the change output of the previous one
+    std::vector<std::shared_ptr<SimpleTransaction>> Build() const;
+};
+
+}
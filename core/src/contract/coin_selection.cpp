@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <iterator>
+
+#include "policy.h"
+#include "feerate.h"
+
+#include "transaction.hpp"
+#include "coin_selection.hpp"
+
+namespace utxord {
+
+using l15::FormatAmount;
+
+int64_t CoinSelector::InputVSize(const IContractDestination& dest)
+{
+    // Witness stack is counted even for legacy inputs: an empty one is serialized when the transaction has segwit inputs
+    int64_t weight = TxWeight::InputSize(dest.DummyScriptSig()) * WITNESS_SCALE_FACTOR + TxWeight::WitnessSize(dest.DummyWitness());
+    return (weight + WITNESS_SCALE_FACTOR - 1) / WITNESS_SCALE_FACTOR;
+}
+
+void CoinSelector::AddCandidate(std::shared_ptr<IContractOutput> output, std::string exclusion_tag)
+{
+    if (!output) throw ContractTermWrongValue("coin selection candidate[" + std::to_string(m_pool.size()) + ']');
+
+    CAmount amount = output->Amount();
+    int64_t vsize = InputVSize(*output->Destination());
+    if (!exclusion_tag.empty()) ++m_tagged_count;
+    m_pool.push_back({move(output), move(exclusion_tag), amount, vsize});
+
+    if (m_fee_rate) AppendSelectable(m_pool.size() - 1);
+}
+
+void CoinSelector::AppendSelectable(size_t candidate) const
+{
+    CAmount effective_value = m_pool[candidate].amount - CFeeRate(*m_fee_rate).GetFee(m_pool[candidate].input_vsize);
+    if (effective_value > 0) m_selectable.push_back({candidate, effective_value});
+}
+
+const std::vector<CoinSelector::Selectable>& CoinSelector::SelectablePool(CAmount fee_rate) const
+{
+    if (m_fee_rate != fee_rate) {
+        m_fee_rate = fee_rate;
+        CFeeRate rate(fee_rate);
+
+        m_selectable.clear();
+        m_selectable.reserve(m_pool.size());
+        for (size_t i = 0; i < m_pool.size(); ++i) {
+            CAmount effective_value = m_pool[i].amount - rate.GetFee(m_pool[i].input_vsize);
+            if (effective_value > 0) m_selectable.push_back({i, effective_value});
+        }
+        std::stable_sort(m_selectable.begin(), m_selectable.end(), EffectiveValueGreater);
+        m_selectable_sorted = m_selectable.size();
+    }
+    else if (m_selectable_sorted < m_selectable.size()) {
+        auto tail = m_selectable.begin() + m_selectable_sorted;
+        std::stable_sort(tail, m_selectable.end(), EffectiveValueGreater);
+        std::inplace_merge(m_selectable.begin(), tail, m_selectable.end(), EffectiveValueGreater);
+        m_selectable_sorted = m_selectable.size();
+    }
+    return m_selectable;
+}
+
+void CoinSelector::UpdateChangeAddress(ChainMode chain, const std::string& change_addr) const
+{
+    if (!m_change_addr.empty() && m_change_addr == change_addr) return;
+
+    auto change_dest = P2Address::Construct(chain, {}, change_addr);
+    m_change_output_vsize = TxWeight::OutputSize(change_dest->PubKeyScript());
+    m_change_input_vsize = InputVSize(*change_dest);
+    m_change_addr = change_addr;
+}
+
+bool CoinSelector::SelectBnB(const std::vector<Selectable>& pool, CAmount target, CAmount cost_of_change, std::vector<size_t>& selection)
+{
+    // Depth first search over the pool sorted by effective value descending: inclusion branch goes first.
+    // Looks for the input set which covers the target with the excess less than the cost of change.
+    CAmount available = std::accumulate(pool.begin(), pool.end(), CAmount(0), [](CAmount s, const auto& c) { return s + c.effective_value; });
+    if (available < target) return false;
+
+    std::vector<size_t> current;
+    CAmount current_value = 0;
+    CAmount best_excess = std::numeric_limits<CAmount>::max();
+
+    size_t i = 0;
+    for (size_t tries = 0; tries < BNB_MAX_TRIES; ++tries, ++i) {
+        bool backtrack = false;
+        if (current_value + available < target || current_value > target + cost_of_change) {
+            backtrack = true;
+        }
+        else if (current_value >= target) {
+            if (current_value - target < best_excess) {
+                best_excess = current_value - target;
+                selection = current;
+                if (best_excess == 0) break;
+            }
+            backtrack = true;
+        }
+
+        if (backtrack) {
+            if (current.empty()) break;
+
+            // Return the omitted candidates to the lookahead and try to exclude the last included one
+            for (--i; i > current.back(); --i) {
+                available += pool[i].effective_value;
+            }
+            current_value -= pool[i].effective_value;
+            current.pop_back();
+        }
+        else {
+            available -= pool[i].effective_value;
+            // The branch is the same as the already searched one if previous candidate has the same value and was excluded
+            if (current.empty() || current.back() == i - 1 || pool[i].effective_value != pool[i - 1].effective_value) {
+                current.push_back(i);
+                current_value += pool[i].effective_value;
+            }
+        }
+    }
+    return best_excess != std::numeric_limits<CAmount>::max();
+}
+
+bool CoinSelector::SelectGreedyLower(const std::vector<Selectable>& pool, CAmount target, std::vector<size_t>& selection)
+{
+    // Pool is sorted by effective value descending, so the candidates lower than the target are the tail
+    auto lower_it = std::partition_point(pool.begin(), pool.end(), [target](const auto& c) { return c.effective_value >= target; });
+    size_t lower_begin = lower_it - pool.begin();
+
+    std::optional<size_t> smallest_larger;
+    if (lower_begin > 0) {
+        smallest_larger = lower_begin - 1;
+        if (pool[*smallest_larger].effective_value == target) {
+            selection = {*smallest_larger};
+            return true;
+        }
+    }
+
+    CAmount lower_total = std::accumulate(lower_it, pool.end(), CAmount(0), [](CAmount s, const auto& c) { return s + c.effective_value; });
+    if (lower_total < target) {
+        if (!smallest_larger) return false;
+        selection = {*smallest_larger};
+        return true;
+    }
+
+    // Greedy subset of the lower candidates, then drop the smallest ones which are not needed to cover the target
+    std::vector<size_t> subset;
+    CAmount subset_total = 0;
+    for (size_t i = lower_begin; i < pool.size() && subset_total < target; ++i) {
+        subset.push_back(i);
+        subset_total += pool[i].effective_value;
+    }
+    for (auto it = subset.rbegin(); it != subset.rend();) {
+        if (subset_total - pool[*it].effective_value >= target) {
+            subset_total -= pool[*it].effective_value;
+            it = std::make_reverse_iterator(subset.erase(std::next(it).base()));
+        }
+        else ++it;
+    }
+
+    if (smallest_larger && pool[*smallest_larger].effective_value <= subset_total) {
+        selection = {*smallest_larger};
+    }
+    else {
+        selection = move(subset);
+    }
+    return true;
+}
+
+bool CoinSelector::SelectLargestFirst(const std::vector<Selectable>& pool, CAmount target, std::vector<size_t>& selection)
+{
+    std::vector<size_t> current;
+    CAmount total = 0;
+    for (size_t i = 0; i < pool.size() && total < target; ++i) {
+        current.push_back(i);
+        total += pool[i].effective_value;
+    }
+    if (total < target) return false;
+
+    selection = move(current);
+    return true;
+}
+
+CoinSelectionResult CoinSelector::Select(const SimpleTransaction& tx, const std::string& change_addr, const std::vector<std::string>& allowed_tags) const
+{
+    CFeeRate fee_rate(tx.GetMiningFeeRate());
+
+    TxWeight weight;
+    CAmount preset_amount = 0;
+    for (const auto& input: tx.Inputs()) {
+        weight.AddInput(input);
+        preset_amount += input.output->Destination()->Amount();
+    }
+    CAmount outputs_amount = 0;
+    for (const auto& out: tx.Destinations()) {
+        weight.AddOutput(*out);
+        outputs_amount += out->Amount();
+    }
+
+    // Reserve segwit marker and flag along with input count growth, so the estimation stays an upper bound
+    CAmount base_fee = fee_rate.GetFee((weight.Weight() + 2 + 2 * WITNESS_SCALE_FACTOR + WITNESS_SCALE_FACTOR - 1) / WITNESS_SCALE_FACTOR);
+
+    UpdateChangeAddress(tx.chain(), change_addr);
+    CAmount change_fee = fee_rate.GetFee(m_change_output_vsize);
+    CAmount cost_of_change = change_fee + fee_rate.GetFee(m_change_input_vsize);
+    CAmount min_change = l15::Dust(DUST_RELAY_TX_FEE);
+
+    CAmount target = outputs_amount + base_fee - preset_amount;
+
+    CoinSelectionResult res;
+    auto finalize = [&](CAmount selected_effective_value) {
+        CAmount excess = selected_effective_value - target;
+        res.change = res.algo != CoinSelectionAlgo::BRANCH_AND_BOUND && excess >= change_fee + min_change;
+        res.fee = res.change ? (res.input_amount + preset_amount - outputs_amount - excess + change_fee)
+                             : (res.input_amount + preset_amount - outputs_amount);
+        return res;
+    };
+
+    if (target <= 0) return finalize(0);
+
+    const std::vector<Selectable>& selectable = SelectablePool(tx.GetMiningFeeRate());
+
+    // Filtered copy is needed only when some candidates are tagged; the sort order is preserved
+    std::vector<Selectable> filtered;
+    if (m_tagged_count) {
+        filtered.reserve(selectable.size());
+        std::copy_if(selectable.begin(), selectable.end(), std::back_inserter(filtered), [&](const auto& c) {
+            const std::string& tag = m_pool[c.candidate].exclusion_tag;
+            return tag.empty() || std::find(allowed_tags.begin(), allowed_tags.end(), tag) != allowed_tags.end();
+        });
+    }
+    const std::vector<Selectable>& pool = m_tagged_count ? filtered : selectable;
+
+    std::vector<size_t> selection;
+    if (SelectBnB(pool, target, cost_of_change, selection)) {
+        res.algo = CoinSelectionAlgo::BRANCH_AND_BOUND;
+    }
+    else if (SelectGreedyLower(pool, target + change_fee + min_change, selection)) {
+        res.algo = CoinSelectionAlgo::GREEDY_LOWER;
+    }
+    else if (SelectLargestFirst(pool, target, selection)) {
+        res.algo = CoinSelectionAlgo::LARGEST_FIRST;
+    }
+    else {
+        CAmount available = std::accumulate(pool.begin(), pool.end(), CAmount(0), [](CAmount s, const auto& c) { return s + c.effective_value; });
+        throw ContractFundsNotEnough(FormatAmount(available) + ", required: " + FormatAmount(target));
+    }
+
+    CAmount selected_effective_value = 0;
+    res.inputs.reserve(selection.size());
+    for (size_t i: selection) {
+        res.inputs.push_back(m_pool[pool[i].candidate].output);
+        res.input_amount += m_pool[pool[i].candidate].amount;
+        selected_effective_value += pool[i].effective_value;
+    }
+    return finalize(selected_effective_value);
+}
+
+CoinSelectionResult CoinSelector::Fund(SimpleTransaction& tx, const std::string& change_addr, const std::vector<std::string>& allowed_tags) const
+{
+    CoinSelectionResult res = Select(tx, change_addr, allowed_tags);
+    for (const auto& input: res.inputs) {
+        tx.AddInput(input);
+    }
+    if (res.change) {
+        tx.AddChangeOutput(change_addr);
+    }
+    return res;
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+
+#include "contract_builder.hpp"
+#include "simple_transaction.hpp"
+
+namespace utxord {
+
+enum class CoinSelectionAlgo { PRESET, BRANCH_AND_BOUND, GREEDY_LOWER, LARGEST_FIRST };
+
+struct CoinSelectionResult
+{
+    std::vector<std::shared_ptr<IContractOutput>> inputs;
+    CoinSelectionAlgo algo = CoinSelectionAlgo::PRESET;
+    CAmount input_amount = 0; // amount of the selected inputs only
+    CAmount fee = 0;          // estimated mining fee of the whole transaction; all the excess goes here for changeless selection
+    bool change = false;
+};
+
+// Selects inputs for a transaction out of a candidate pool.
+// Input vsize of a candidate is evaluated once when it is added, using dummy scriptSig/witness of its destination,
+// so selection itself works with plain integers. Branch-and-bound searching for a changeless input set goes first,
+// then deterministic greedy passes try to cover the target along with a change output.
+// Effective values are cached for the last used fee rate. Candidates added after that are appended unsorted
+// and merged into the sorted cache by the next Select(), so building the pool stays linear and repeated selections
+// do not re-evaluate and re-sort the whole pool. The cache makes concurrent Select() calls unsafe.
+class CoinSelector
+{
+public:
+    static const size_t BNB_MAX_TRIES = 100000;
+
+private:
+    struct Candidate
+    {
+        std::shared_ptr<IContractOutput> output;
+        std::string exclusion_tag;
+        CAmount amount;
+        int64_t input_vsize;
+    };
+
+    struct Selectable
+    {
+        size_t candidate;
+        CAmount effective_value;
+    };
+
+    ChainMode m_chain;
+    std::vector<Candidate> m_pool;
+    size_t m_tagged_count = 0;
+
+    // Candidates with positive effective value at m_fee_rate sorted by effective value descending
+    mutable std::optional<CAmount> m_fee_rate;
+    mutable std::vector<Selectable> m_selectable;
+    mutable size_t m_selectable_sorted = 0; // Length of the sorted head of m_selectable
+
+    mutable std::string m_change_addr;
+    mutable int64_t m_change_output_vsize = 0;
+    mutable int64_t m_change_input_vsize = 0;
+
+    static int64_t InputVSize(const IContractDestination& dest);
+
+    static bool EffectiveValueGreater(const Selectable& a, const Selectable& b)
+    { return a.effective_value > b.effective_value; }
+
+    void AppendSelectable(size_t candidate) const;
+    const std::vector<Selectable>& SelectablePool(CAmount fee_rate) const;
+    void UpdateChangeAddress(ChainMode chain, const std::string& change_addr) const;
+
+    static bool SelectBnB(const std::vector<Selectable>& pool, CAmount target, CAmount cost_of_change, std::vector<size_t>& selection);
+    // Deterministic single pass (no randomized knapsack search): the smallest candidate covering the target alone,
+    // or the smallest greedy subset of the lower candidates if it does not exceed that one
+    static bool SelectGreedyLower(const std::vector<Selectable>& pool, CAmount target, std::vector<size_t>& selection);
+    static bool SelectLargestFirst(const std::vector<Selectable>& pool, CAmount target, std::vector<size_t>& selection);
+
+public:
+    explicit CoinSelector(ChainMode chain) : m_chain(chain) {}
+
+    // Candidate with non-empty exclusion tag (i.e. inscription or rune bearing output) is never selected
+    // unless the tag is explicitly allowed for the particular selection.
+    void AddCandidate(std::shared_ptr<IContractOutput> output, std::string exclusion_tag = {});
+    void AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr, std::string exclusion_tag = {})
+    { AddCandidate(MakeContractObject<UTXO>(m_chain, move(txid), nout, amount, move(addr)), move(exclusion_tag)); }
+
+    size_t PoolSize() const
+    { return m_pool.size(); }
+
+    // Selects inputs to pay the outputs of tx at its mining fee rate. Inputs already added to tx are taken into account.
+    CoinSelectionResult Select(const SimpleTransaction& tx, const std::string& change_addr, const std::vector<std::string>& allowed_tags = {}) const;
+
+    // Adds selected inputs to tx along with change output if needed
+    CoinSelectionResult Fund(SimpleTransaction& tx, const std::string& change_addr, const std::vector<std::string>& allowed_tags = {}) const;
+};
+
+}
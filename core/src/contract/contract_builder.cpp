@@ -12,7 +12,11 @@
 #include "contract_builder_factory.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
 
 namespace utxord {
 
@@ -22,6 +26,63 @@ using l15::SignatureError;
 using l15::core::SchnorrKeyPair;
 using l15::core::MasterKey;
 
+namespace {
+
+class HexWriter
+{
+    std::string& m_hex;
+public:
+    explicit HexWriter(std::string& hex) : m_hex(hex) {}
+
+    void write(Span<const std::byte> data)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        for (std::byte b: data) {
+            m_hex.push_back(digits[std::to_integer<uint8_t>(b) >> 4]);
+            m_hex.push_back(digits[std::to_integer<uint8_t>(b) & 0x0f]);
+        }
+    }
+
+    template <typename T>
+    HexWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+
+int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Decodes hex string of any case right into the (reused) output buffer
+bool DecodeHex(const std::string& str, bytevector& out)
+{
+    if (str.size() % 2) return false;
+
+    out.resize(str.size() / 2);
+    auto digit = [](char c) { return (c >= 'A' && c <= 'F') ? c - 'A' + 10 : HexDigit(c); };
+    for (size_t i = 0; i < out.size(); ++i) {
+        int hi = digit(str[i * 2]), lo = digit(str[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+}
+
+std::string SerializeHexTx(const CMutableTransaction& tx)
+{
+    std::string res;
+    res.reserve(GetSerializeSize(TX_WITH_WITNESS(tx)) * 2);
+    HexWriter(res) << TX_WITH_WITNESS(tx);
+    return res;
+}
+
 const std::string IJsonSerializable::name_type = "type";
 
 UniValue WitnessStack::MakeJson() const
@@ -39,24 +100,22 @@ void WitnessStack::ReadJson(const UniValue &stack, const std::function<std::stri
         throw ContractTermWrongFormat(std::string(TxInput::name_witness));
     }
 
+    m_stack.reserve(stack.size());
+
     size_t i = 0;
-    try {
-        for (const auto& v: stack.getValues()) {
-            if (!v.isStr()) {
-                throw ContractTermWrongFormat("witness[" + std::to_string(i) + ']');
-            }
+    bytevector data;
+    for (const auto& v: stack.getValues()) {
+        if (!v.isStr() || !DecodeHex(v.get_str(), data)) {
+            throw ContractTermWrongFormat("witness[" + std::to_string(i) + ']');
+        }
 
-            if (i < m_stack.size()) {
-                if (m_stack[i] != unhex<bytevector>(v.get_str())) throw ContractTermMismatch((std::ostringstream() << lazy_name() << '[' << i << ']').str());
-            }
-            else {
-                m_stack.emplace_back(unhex<bytevector>(v.get_str()));
-            }
-            ++i;
+        if (i < m_stack.size()) {
+            if (m_stack[i] != data) throw ContractTermMismatch((std::ostringstream() << lazy_name() << '[' << i << ']').str());
         }
-    }
-    catch(std::logic_error& e) {
-        std::throw_with_nested(ContractTermWrongFormat("witness[" + std::to_string(i) + ']'));
+        else {
+            m_stack.emplace_back(move(data));
+        }
+        ++i;
     }
 }
 
@@ -84,11 +143,11 @@ UniValue TxInput::MakeJson() const
 void TxInput::ReadJson(const UniValue &json, const std::function<std::string()> &lazy_name)
 {
     if (output) {
-        auto new_output = std::make_shared<UTXO>(chain, json, lazy_name);
+        auto new_output = MakeContractObject<UTXO>(chain, json, lazy_name);
         if (new_output->TxID() != output->TxID() || new_output->NOut() != output->NOut()) throw ContractTermMismatch(lazy_name());
     }
     else {
-        output = std::make_shared<UTXO>(chain, json, lazy_name);
+        output = MakeContractObject<UTXO>(chain, json, lazy_name);
     }
 
     {   const UniValue& val = json[name_scriptsig];
@@ -105,11 +164,133 @@ void TxInput::ReadJson(const UniValue &json, const std::function<std::string()>
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void P2PKHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                            int hashtype) const
+size_t TxWeight::InputSize(size_t scriptsig_size)
+{
+    // prevout hash + prevout n + scriptSig + sequence
+    return 32 + 4 + GetSizeOfCompactSize(scriptsig_size) + scriptsig_size + 4;
+}
+
+size_t TxWeight::WitnessSize(const std::vector<bytevector>& stack)
+{
+    size_t size = GetSizeOfCompactSize(stack.size());
+    for (const auto& item: stack) {
+        size += GetSizeOfCompactSize(item.size()) + item.size();
+    }
+    return size;
+}
+
+size_t TxWeight::WitnessSize(std::initializer_list<size_t> item_sizes)
+{
+    size_t size = GetSizeOfCompactSize(item_sizes.size());
+    for (size_t item_size: item_sizes) {
+        size += GetSizeOfCompactSize(item_size) + item_size;
+    }
+    return size;
+}
+
+size_t TxWeight::OutputSize(size_t pubkeyscript_size)
+{
+    // amount + scriptPubKey
+    return 8 + GetSizeOfCompactSize(pubkeyscript_size) + pubkeyscript_size;
+}
+
+void TxWeight::AddInput(size_t input_size, size_t witness_size)
+{
+    ++m_vin_count;
+    m_vin_size += input_size;
+    if (witness_size) {
+        ++m_witness_count;
+        m_witness_size += witness_size;
+    }
+}
+
+void TxWeight::AddInput(const TxInput& input)
+{
+    const auto& dest = input.output->Destination();
+    CScript scriptSig = input.scriptSig.empty() ? dest->DummyScriptSig() : input.scriptSig;
+    if (input.witness)
+        AddInput(scriptSig, input.witness);
+    else
+        AddInput(scriptSig, dest->DummyWitness());
+}
+
+int64_t TxWeight::Weight() const
+{
+    // version + vin + vout + locktime
+    size_t stripped_size = 4 + GetSizeOfCompactSize(m_vin_count) + m_vin_size + GetSizeOfCompactSize(m_vout_count) + m_vout_size + 4;
+    size_t weight = stripped_size * WITNESS_SCALE_FACTOR;
+    if (m_witness_count) {
+        // segwit marker and flag, then an empty stack for every input w/o witness
+        weight += 2 + m_witness_size + (m_vin_count - m_witness_count);
+    }
+    return static_cast<int64_t>(weight);
+}
+
+int64_t TxWeight::VSize() const
+{ return (Weight() + WITNESS_SCALE_FACTOR - 1) / WITNESS_SCALE_FACTOR; }
+
+CAmount TxWeight::Fee(CAmount fee_rate) const
+{ return CFeeRate(fee_rate).GetFee(VSize()); }
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint256 TxSigningContext::TaprootSigHash(uint32_t nin, uint8_t hashtype, const CScript& spend_script) const
+{
+    ScriptExecutionData execdata;
+    execdata.m_annex_init = true;
+    execdata.m_annex_present = false; // Only support annex-less signing for now.
+
+    if(!spend_script.empty()) {
+        execdata.m_codeseparator_pos_init = true;
+        execdata.m_codeseparator_pos = 0xFFFFFFFF; // Only support non-OP_CODESEPARATOR BIP342 signing for now.
+        execdata.m_tapleaf_hash_init = true;
+        execdata.m_tapleaf_hash = l15::TapLeafHash(spend_script);
+    }
+
+    SigVersion sigversion = spend_script.empty() ? SigVersion::TAPROOT : SigVersion::TAPSCRIPT;
+
+    uint256 sighash;
+    if (!SignatureHashSchnorr(sighash, execdata, m_tx, nin, hashtype, sigversion, m_txdata, MissingDataBehavior::FAIL)) {
+        throw SignatureError("sighash");
+    }
+    return sighash;
+}
+
+uint256 TxSigningContext::WitnessV0SigHash(uint32_t nin, const CScript& witness_script, int hashtype) const
+{ return SignatureHash(witness_script, m_tx, nin, hashtype, m_txdata.m_spent_outputs[nin].nValue, SigVersion::WITNESS_V0, &m_txdata); }
+
+uint256 TxSigningContext::LegacySigHash(uint32_t nin, const CScript& script, int hashtype) const
+{ return SignatureHash(script, m_tx, nin, hashtype, m_txdata.m_spent_outputs[nin].nValue, SigVersion::BASE, &m_txdata); }
+
+signature TxSigningContext::SignTaproot(const SchnorrKeyPair& keypair, uint32_t nin, const CScript& spend_script, uint8_t hashtype) const
+{
+    signature sig = keypair.SignSchnorr(TaprootSigHash(nin, hashtype, spend_script));
+    if (hashtype != SIGHASH_DEFAULT) sig.push_back(hashtype);
+    return sig;
+}
+
+bytevector TxSigningContext::SignEcdsa(const EcdsaKeyPair& keypair, const uint256& sighash, int hashtype)
+{
+    secp256k1_ecdsa_signature ecdsa_sig;
+    if (!secp256k1_ecdsa_sign(KeyPair::GetStaticSecp256k1Context(), &ecdsa_sig, sighash.data(), keypair.PrivKey().data(), nullptr, nullptr))
+        throw SignatureError("ecdsa sign");
+
+    bytevector sig(72);
+    size_t sig_len = sig.size();
+    secp256k1_ecdsa_signature_serialize_der(KeyPair::GetStaticSecp256k1Context(), sig.data(), &sig_len, &ecdsa_sig);
+    sig.resize(sig_len);
+    sig.push_back(static_cast<uint8_t>(hashtype));
+    return sig;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void P2PKHSigner::SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const
 {
     if (hashtype == SIGHASH_DEFAULT) hashtype = SIGHASH_ALL;
 
+    const auto& spent_outputs = ctx.SpentOutputs();
+
     if (spent_outputs[input.nin].scriptPubKey.size() == 25
         && spent_outputs[input.nin].scriptPubKey[0] == OP_DUP
         && spent_outputs[input.nin].scriptPubKey[1] == OP_HASH160
@@ -117,7 +298,7 @@ void P2PKHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::
         && spent_outputs[input.nin].scriptPubKey[23] == OP_EQUALVERIFY
         && spent_outputs[input.nin].scriptPubKey[24] == OP_CHECKSIG) {
 
-        input.scriptSig << m_keypair.SignNonSegwitTx(tx, input.nin, spent_outputs, spent_outputs[input.nin].scriptPubKey, hashtype);
+        input.scriptSig << TxSigningContext::SignEcdsa(m_keypair, ctx.LegacySigHash(input.nin, spent_outputs[input.nin].scriptPubKey, hashtype), hashtype);
         input.scriptSig << m_keypair.GetPubKey().as_vector();
         return;
     }
@@ -125,11 +306,12 @@ void P2PKHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::
     throw ContractError("not P2WPKH contract");
 }
 
-void P2WPKHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                             int hashtype) const
+void P2WPKHSigner::SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const
 {
     if (hashtype == SIGHASH_DEFAULT) hashtype = SIGHASH_ALL;
 
+    const auto& spent_outputs = ctx.SpentOutputs();
+
     int witver;
     std::vector<unsigned char> witprog;
 
@@ -139,21 +321,22 @@ void P2WPKHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std:
     CScript witnessscript;
     witnessscript << OP_DUP << OP_HASH160 << witprog << OP_EQUALVERIFY << OP_CHECKSIG;
 
-    input.witness.Set(0, m_keypair.SignSegwitV0Tx(tx, input.nin, spent_outputs, witnessscript, hashtype));
+    input.witness.Set(0, TxSigningContext::SignEcdsa(m_keypair, ctx.WitnessV0SigHash(input.nin, witnessscript, hashtype), hashtype));
     input.witness.Set(1, m_keypair.GetPubKey().as_vector());
 }
 
-void TaprootSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                              int hashtype) const
+void TaprootSigner::SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const
 {
     if (hashtype == SIGHASH_ALL) hashtype = SIGHASH_DEFAULT;
-    input.witness.Set(0, m_keypair.SignTaprootTx(tx, input.nin, spent_outputs, {}, hashtype));
+    input.witness.Set(0, ctx.SignTaproot(m_keypair, input.nin, {}, hashtype));
 }
 
-void P2WPKH_P2SHSigner::SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs, int hashtype) const
+void P2WPKH_P2SHSigner::SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const
 {
     if (hashtype == SIGHASH_DEFAULT) hashtype = SIGHASH_ALL;
 
+    const auto& spent_outputs = ctx.SpentOutputs();
+
     if (spent_outputs[input.nin].scriptPubKey.IsPayToScriptHash()) {
         bytevector pubkeyhash = cryptohash<bytevector>(m_keypair.GetPubKey(), CHash160());
         bytevector hash(spent_outputs[input.nin].scriptPubKey.begin()+2, spent_outputs[input.nin].scriptPubKey.begin()+22);
@@ -165,7 +348,7 @@ void P2WPKH_P2SHSigner::SignInput(TxInput &input, const CMutableTransaction &tx,
         CScript witnessscript;
         witnessscript << OP_DUP << OP_HASH160 << pubkeyhash << OP_EQUALVERIFY << OP_CHECKSIG;
 
-        input.witness.Set(0, m_keypair.SignSegwitV0Tx(tx, input.nin, spent_outputs, witnessscript, hashtype));
+        input.witness.Set(0, TxSigningContext::SignEcdsa(m_keypair, ctx.WitnessV0SigHash(input.nin, witnessscript, hashtype), hashtype));
         input.witness.Set(1, m_keypair.GetPubKey().as_vector());
         input.scriptSig << bytevector(scriptSig.begin(), scriptSig.end());
 
@@ -173,6 +356,55 @@ void P2WPKH_P2SHSigner::SignInput(TxInput &input, const CMutableTransaction &tx,
     else throw ContractError("not P2WPKH-P2SH input");
 }
 
+void SignerCache::Resolve(const std::vector<const IContractDestination*>& destinations, const std::vector<xonly_pubkey>& pubkeys)
+{
+    std::unordered_map<std::string, const IContractDestination*> missing_addrs;
+    for (const IContractDestination* dest: destinations) {
+        std::string addr = dest->Address();
+        if (addr.empty()) throw ContractTermMissing(std::string(IContractDestination::name_addr));
+        if (!m_signers.contains(addr)) missing_addrs.emplace(move(addr), dest);
+    }
+
+    std::unordered_set<xonly_pubkey, XOnlyPubKeyHasher> missing_pubkeys;
+    for (const xonly_pubkey& pk: pubkeys) {
+        if (!m_keypairs.contains(pk)) missing_pubkeys.emplace(pk);
+    }
+
+    m_signers.reserve(m_signers.size() + missing_addrs.size());
+    for (auto& [addr, dest]: missing_addrs) {
+        m_signers.emplace(addr, dest->LookupKey(m_master_key, m_key_filter_tag));
+    }
+
+    m_keypairs.reserve(m_keypairs.size() + missing_pubkeys.size());
+    for (const xonly_pubkey& pk: missing_pubkeys) {
+        KeyPair keypair = m_master_key.Lookup(pk, m_key_filter_tag);
+        m_keypairs.emplace(pk, SchnorrKeyPair(keypair.PrivKey()));
+    }
+}
+
+const std::shared_ptr<ISigner>& SignerCache::Signer(const IContractDestination& dest)
+{
+    std::string addr = dest.Address();
+    if (addr.empty()) throw ContractTermMissing(std::string(IContractDestination::name_addr));
+
+    auto it = m_signers.find(addr);
+    if (it == m_signers.end()) {
+        auto signer = dest.LookupKey(m_master_key, m_key_filter_tag);
+        it = m_signers.emplace(move(addr), move(signer)).first;
+    }
+    return it->second;
+}
+
+const SchnorrKeyPair& SignerCache::SchnorrKey(const xonly_pubkey& pk)
+{
+    auto it = m_keypairs.find(pk);
+    if (it == m_keypairs.end()) {
+        KeyPair keypair = m_master_key.Lookup(pk, m_key_filter_tag);
+        it = m_keypairs.emplace(pk, SchnorrKeyPair(keypair.PrivKey())).first;
+    }
+    return it->second;
+}
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 ZeroDestination::ZeroDestination(const UniValue &json, const std::function<std::string()>& lazy_name)
@@ -245,23 +477,44 @@ std::shared_ptr<IContractDestination> P2Address::Construct(ChainMode chain, std:
         auto [witver, data] = bech.Decode(addr);
 
         if (witver == 0)
-            return std::make_shared<P2WPKH>(chain, amount.value_or(330), move(addr));
+            return MakeContractObject<P2WPKH>(chain, amount.value_or(330), move(addr), witver, move(data));
         if (witver == 1)
-            return std::make_shared<P2TR>(chain, amount.value_or(330), move(addr));
+            return MakeContractObject<P2TR>(chain, amount.value_or(330), move(addr), witver, move(data));
 
         throw ContractTermWrongValue((std::ostringstream() << addr << " wrong witness ver: " << witver).str());
     }
 
     auto [addrtype, hash] = Base58(chain).Decode(addr);
     if (addrtype == PUB_KEY_HASH)
-        return std::make_shared<P2PKH>(chain, amount.value_or(546), move(addr));
+        return MakeContractObject<P2PKH>(chain, amount.value_or(546), move(addr), std::nullopt, move(hash));
     if (addrtype == SCRIPT_HASH)
-        return std::make_shared<P2SH>(chain, amount.value_or(540), move(addr));
+        return MakeContractObject<P2SH>(chain, amount.value_or(540), move(addr), std::nullopt, move(hash));
 
     throw ContractTermWrongValue(move(addr));
 }
 
-void P2Witness::CheckDust() const
+P2Witness::P2Witness(ChainMode chain, CAmount amount, std::string addr): P2Address(chain, amount, move(addr))
+{
+    std::tie(m_witver, m_program) = Bech().Decode(m_addr);
+    InitPubKeyScript();
+}
+
+P2Witness::P2Witness(ChainMode chain, CAmount amount, std::string addr, unsigned witver, bytevector program)
+    : P2Address(chain, amount, move(addr))
+{
+    m_witver = witver;
+    m_program = move(program);
+    InitPubKeyScript();
+}
+
+void P2Witness::InitPubKeyScript()
+{
+    m_pubkeyscript = CScript() << CScript::EncodeOP_N(m_witver) << m_program;
+    m_dust = DustThreshold(m_pubkeyscript);
+    CheckDust();
+}
+
+CAmount P2Witness::DustThreshold(const CScript& pubkeyscript)
 {
     // A typical spendable segwit P2WPKH txout is 31 bytes big, and will
     // need a CTxIn of at least 67 bytes to spend:
@@ -274,14 +527,12 @@ void P2Witness::CheckDust() const
     // kept to not further reduce the dust level.
     // See discussion in https://github.com/bitcoin/bitcoin/pull/22779 for details.
 
-    size_t nSize = GetSerializeSize(TxOutput());
+    size_t nSize = GetSerializeSize(CTxOut(0, pubkeyscript));
     // sum the sizes of the parts of a transaction input
     // with 75% segwit discount applied to the script size.
     nSize += (32 + 4 + 1 + (107 / WITNESS_SCALE_FACTOR) + 4);
 
-    const CAmount dust = CFeeRate(DUST_RELAY_TX_FEE).GetFee(nSize);
-    if (m_amount < dust)
-        throw ContractTermWrongValue("Dust");
+    return CFeeRate(DUST_RELAY_TX_FEE).GetFee(nSize);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -290,48 +541,56 @@ std::shared_ptr<IContractDestination> P2Legacy::Construct(ChainMode chain, std::
 {
     auto [addrtype, hash] = Base58(chain).Decode(addr);
     if (addrtype == PUB_KEY_HASH)
-        return std::make_shared<P2PKH>(chain, amount.value_or(546), move(addr), move(pubkey));
+        return MakeContractObject<P2PKH>(chain, amount.value_or(546), move(addr), move(pubkey), move(hash));
     if (addrtype == SCRIPT_HASH)
-        return std::make_shared<P2SH>(chain, amount.value_or(540), move(addr), move(pubkey));
+        return MakeContractObject<P2SH>(chain, amount.value_or(540), move(addr), move(pubkey), move(hash));
 
     throw ContractTermWrongValue(move(addr));
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-CScript P2PKH::PubKeyScript() const
+P2PKH::P2PKH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk)
+    : P2Legacy(chain, amount, move(addr), move(pk))
 {
     auto [addrtype, keyhash] = l15::Base58(m_chain).Decode(m_addr);
     if (addrtype != l15::PUB_KEY_HASH) throw ContractTermWrongValue("Not P2PKH: " + m_addr);
-    return CScript() << OP_DUP << OP_HASH160 << keyhash << OP_EQUALVERIFY << OP_CHECKSIG;
+    m_program = move(keyhash);
+    Init();
 }
 
-bytevector P2PKH::DecodePubKeyHash() const
+P2PKH::P2PKH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk, bytevector keyhash)
+    : P2Legacy(chain, amount, move(addr), move(pk))
 {
-    auto [addrtype, hash] = l15::Base58(m_chain).Decode(m_addr);
-    if (addrtype != l15::PUB_KEY_HASH) throw ContractTermWrongValue("Not P2PKH: " + m_addr);
-    return hash;
+    m_program = move(keyhash);
+    Init();
+}
+
+void P2PKH::Init()
+{
+    m_pubkeyscript = CScript() << OP_DUP << OP_HASH160 << m_program << OP_EQUALVERIFY << OP_CHECKSIG;
+    m_dust = DustThreshold(m_pubkeyscript);
+
+    CheckDust();
+    CheckPubKey();
 }
 
 void P2PKH::CheckPubKey() const
 {
-    if (m_pubkey && DecodePubKeyHash() != cryptohash<bytevector>(*m_pubkey, CHash160()))
+    if (m_pubkey && m_program != cryptohash<bytevector>(*m_pubkey, CHash160()))
         throw ContractTermMismatch(IContractBuilder::name_pk.c_str());
 }
 
 
 std::shared_ptr<ISigner> P2PKH::LookupKey(const KeyRegistry &masterKey, const std::string &key_filter_tag) const
 {
-    auto [type, hash] = Base58(m_chain).Decode(m_addr);
-    if (type != PUB_KEY_HASH) throw ContractTermWrongValue(std::string(name_addr));
-
     return std::make_shared<P2PKHSigner>(masterKey.Lookup(m_addr, key_filter_tag).GetEcdsaKeyPair());
 }
 
 void P2PKH::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 {
     if (pk.size() != 33) throw ContractTermWrongValue("P2PKH public key size: " + std::to_string(pk.size()));
-    if (get<1>(l15::Base58(m_chain).Decode(m_addr)) != cryptohash<bytevector>(pk, CHash160())) throw ContractTermMismatch(std::string(name_addr));
+    if (m_program != cryptohash<bytevector>(pk, CHash160())) throw ContractTermMismatch(std::string(name_addr));
     if (m_pubkey && *m_pubkey != pk) throw ContractTermMismatch(std::string(IContractBuilder::name_pk));
 
     input.scriptSig << sig;
@@ -340,11 +599,29 @@ void P2PKH::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-bytevector P2SH::DecodeScriptHash() const
+P2SH::P2SH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk)
+    : P2Legacy(chain, amount, move(addr), move(pk))
 {
-    auto [addrtype, hash] = l15::Base58(m_chain).Decode(m_addr);
+    auto [addrtype, scripthash] = l15::Base58(m_chain).Decode(m_addr);
     if (addrtype != l15::SCRIPT_HASH) throw ContractTermWrongValue("Not P2SH: " + m_addr);
-    return hash;
+    m_program = move(scripthash);
+    Init();
+}
+
+P2SH::P2SH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk, bytevector scripthash)
+    : P2Legacy(chain, amount, move(addr), move(pk))
+{
+    m_program = move(scripthash);
+    Init();
+}
+
+void P2SH::Init()
+{
+    m_pubkeyscript = CScript() << OP_HASH160 << m_program << OP_EQUAL;
+    m_dust = DustThreshold(m_pubkeyscript);
+
+    CheckDust();
+    if (m_pubkey) CheckPubKey();
 }
 
 CScript P2SH::ScriptSig() const
@@ -358,15 +635,12 @@ CScript P2SH::ScriptSig() const
 
 void P2SH::CheckPubKey() const
 {
-    if (DecodeScriptHash() != cryptohash<bytevector>(ScriptSig(), CHash160())) throw ContractTermMismatch(IContractBuilder::name_pk.c_str());
+    if (m_program != cryptohash<bytevector>(ScriptSig(), CHash160())) throw ContractTermMismatch(IContractBuilder::name_pk.c_str());
 }
 
 std::shared_ptr<ISigner> P2SH::LookupKey(const KeyRegistry &keyReg, const std::string &key_filter_tag) const
 {
     // Try to sign as P2WPKH-P2SH
-
-    auto keyhash = DecodeScriptHash();
-
     return std::make_shared<P2WPKH_P2SHSigner>(keyReg.Lookup(m_addr, key_filter_tag).GetEcdsaKeyPair());
 }
 
@@ -382,24 +656,23 @@ void P2SH::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 
     CScript scriptSig = ScriptSig();
 
-    if (DecodeScriptHash() != cryptohash<bytevector>(scriptSig, CHash160())) throw ContractError("PubKey hash does not match or not P2WPKH-P2SH address");
+    if (m_program != cryptohash<bytevector>(scriptSig, CHash160())) throw ContractError("PubKey hash does not match or not P2WPKH-P2SH address");
 
     input.witness.Set(0, move(sig));
     input.witness.Set(1, move(pk));
     input.scriptSig << bytevector(scriptSig.begin(), scriptSig.end());
 }
 
-void P2Legacy::CheckDust() const
+CAmount P2Legacy::DustThreshold(const CScript& pubkeyscript)
 {
     // A typical spendable non-segwit txout is 34 bytes big, and will
     // need a CTxIn of at least 148 bytes to spend:
     // so dust is a spendable txout less than
     // 182*dustRelayFee/1000 (in satoshis).
     // 546 satoshis at the default rate of 3000 sat/kvB.
-    size_t nSize = GetSerializeSize(TxOutput());
+    size_t nSize = GetSerializeSize(CTxOut(0, pubkeyscript));
     nSize += (32 + 4 + 1 + 107 + 4); // the 148 mentioned above
-    if (m_amount < CFeeRate(DUST_RELAY_TX_FEE).GetFee(nSize))
-        throw ContractTermWrongValue("Dust");
+    return CFeeRate(DUST_RELAY_TX_FEE).GetFee(nSize);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -469,17 +742,14 @@ void OpReturnDestination::ReadJson(const UniValue &json, const std::function<std
 
 std::shared_ptr<IContractDestination> OpReturnDestination::Construct(ChainMode chain, const UniValue &json, const std::function<std::string()> &lazy_name)
 {
-    return std::make_shared<OpReturnDestination>(json, lazy_name);
+    return MakeContractObject<OpReturnDestination>(json, lazy_name);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 std::shared_ptr<ISigner> P2WPKH::LookupKey(const KeyRegistry& masterKey, const std::string& key_filter_tag) const
 {
-    unsigned witver;
-    bytevector pkhash;
-    std::tie(witver, pkhash) = Bech().Decode(m_addr);
-    if (witver != 0) throw ContractTermWrongValue(std::string(name_addr));
+    if (m_witver != 0) throw ContractTermWrongValue(std::string(name_addr));
 
     return std::make_shared<P2WPKHSigner>(masterKey.Lookup(m_addr, key_filter_tag).GetEcdsaKeyPair());
 }
@@ -496,7 +766,7 @@ void P2WPKH::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 
     bytevector hash = cryptohash<bytevector>(pk, CHash160());
 
-    if (get<1>(Bech().Decode(m_addr)) != hash) throw ContractTermMismatch(std::string(name_addr));
+    if (m_program != hash) throw ContractTermMismatch(std::string(name_addr));
 
     input.witness.Set(0, move(sig));
     input.witness.Set(1, move(pk));
@@ -504,10 +774,7 @@ void P2WPKH::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 
 std::shared_ptr<ISigner> P2TR::LookupKey(const KeyRegistry& masterKey, const std::string& key_filter_tag) const
 {
-    unsigned witver;
-    bytevector pk;
-    std::tie(witver, pk) = Bech().Decode(m_addr);
-    if (witver != 1) throw ContractTermWrongValue(std::string(name_addr));
+    if (m_witver != 1) throw ContractTermWrongValue(std::string(name_addr));
 
     return std::make_shared<TaprootSigner>(masterKey.Lookup(m_addr, key_filter_tag).GetSchnorrKeyPair());
 }
@@ -515,7 +782,7 @@ std::shared_ptr<ISigner> P2TR::LookupKey(const KeyRegistry& masterKey, const std
 void P2TR::SetSignature(TxInput &input, bytevector pk, bytevector sig)
 {
     if (pk.size() != xonly_pubkey::SIZE) throw ContractTermWrongValue("P2TR public key size: " + std::to_string(pk.size()));
-    if (pk != get<1>(Bech().Decode(m_addr))) throw ContractTermMismatch(std::string(name_addr));
+    if (pk != m_program) throw ContractTermMismatch(std::string(name_addr));
     if (sig.size() < 64 || sig.size() > 65) throw ContractTermWrongValue("P2TR signature size: " + std::to_string(sig.size()));
 
     input.witness.Set(0, move(sig));
@@ -546,6 +813,7 @@ void UTXO::ReadJson(const UniValue &json, const std::function<std::string()> &la
         throw ContractTermWrongValue(move((lazy_name() += '.') += name_type));
     }
     m_txid = json[name_txid].get_str();
+    m_txhash = Txid::FromUint256(uint256S(m_txid));
     m_nout = json[name_nout].getInt<uint32_t >();
 
     const UniValue& dest = json[name_destination];
@@ -594,25 +862,10 @@ CAmount IContractBuilder::CalculateWholeFee(const std::string& params) const
     });
 }
 
-void IContractBuilder::VerifyTxSignature(const xonly_pubkey& pk, const signature& sig, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs, const CScript& spend_script)
+void IContractBuilder::VerifyTxSignature(const xonly_pubkey& pk, const signature& sig, const TxSigningContext& ctx, uint32_t nin, const CScript& spend_script)
 {
     if (sig.size() != 64 && sig.size() != 65) throw SignatureError("sig size");
 
-    uint256 sighash;
-    PrecomputedTransactionData txdata;
-    txdata.Init(tx, std::move(spent_outputs), true);
-
-    ScriptExecutionData execdata;
-    execdata.m_annex_init = true;
-    execdata.m_annex_present = false; // Only support annex-less signing for now.
-
-    if(!spend_script.empty()) {
-        execdata.m_codeseparator_pos_init = true;
-        execdata.m_codeseparator_pos = 0xFFFFFFFF; // Only support non-OP_CODESEPARATOR BIP342 signing for now.
-        execdata.m_tapleaf_hash_init = true;
-        execdata.m_tapleaf_hash = l15::TapLeafHash(spend_script);
-    }
-
     uint8_t hashtype = SIGHASH_DEFAULT;
     if (sig.size() == 65) {
         hashtype = sig.back();
@@ -621,18 +874,17 @@ void IContractBuilder::VerifyTxSignature(const xonly_pubkey& pk, const signature
         }
     }
 
-    SigVersion sigversion = spend_script.empty() ? SigVersion::TAPROOT : SigVersion::TAPSCRIPT;
+    uint256 sighash = ctx.TaprootSigHash(nin, hashtype, spend_script);
 
-    if (!SignatureHashSchnorr(sighash, execdata, tx, nin, hashtype, sigversion, txdata, MissingDataBehavior::FAIL)) {
-        throw SignatureError("sighash");
-    }
     if (!pk.verify(SchnorrKeyPair::GetStaticSecp256k1Context(), sig, sighash)) {
         throw SignatureError("sig");
     }
 }
 
-void IContractBuilder::VerifyTxSignature(ChainMode chain, const std::string& addr, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs)
+void IContractBuilder::VerifyTxSignature(ChainMode chain, const std::string& addr, const TxSigningContext& ctx, uint32_t nin)
 {
+    const CMutableTransaction& tx = ctx.Tx();
+    const std::vector<CTxOut>& spent_outputs = ctx.SpentOutputs();
     try {
         auto [witver, keyid] = Bech32(BTC, chain).Decode(addr);
         const auto& witness = tx.vin[nin].scriptWitness.stack;
@@ -643,20 +895,17 @@ void IContractBuilder::VerifyTxSignature(ChainMode chain, const std::string& add
             xonly_pubkey pk = move(keyid);
             signature sig = witness[0];
 
-            VerifyTxSignature(pk, sig, tx, nin, move(spent_outputs), {});
+            VerifyTxSignature(pk, sig, ctx, nin, {});
 
         }
         else if (witver == 0) {
             if (witness.size() != 2) throw SignatureError("witness stack size: " + std::to_string(witness.size()));
             if (witness[1].size() != 33) throw SignatureError("pubkey size: " + std::to_string(witness[0].size()));
 
-            PrecomputedTransactionData txdata;
-            txdata.Init(tx, std::move(spent_outputs), true);
-
             CScript witnessscript;
             witnessscript << OP_DUP << OP_HASH160 << keyid << OP_EQUALVERIFY << OP_CHECKSIG;
 
-            uint256 sighash = SignatureHash(witnessscript, tx, nin, witness[0].back(), txdata.m_spent_outputs[nin].nValue, SigVersion::WITNESS_V0, &txdata);
+            uint256 sighash = ctx.WitnessV0SigHash(nin, witnessscript, witness[0].back());
 
             secp256k1_pubkey pubkey;
             secp256k1_ecdsa_signature signature;
@@ -714,13 +963,10 @@ void IContractBuilder::VerifyTxSignature(ChainMode chain, const std::string& add
 
             if (scriptSig != tx.vin[nin].scriptSig) throw SignatureError("P2WPKH-P2SH script hash does not match pubkey hash");
 
-            PrecomputedTransactionData txdata;
-            txdata.Init(tx, std::move(spent_outputs), true);
-
             CScript witnessscript;
             witnessscript << OP_DUP << OP_HASH160 << keyid << OP_EQUALVERIFY << OP_CHECKSIG;
 
-            uint256 sighash = SignatureHash(witnessscript, tx, nin, witness[0].back(), txdata.m_spent_outputs[nin].nValue, SigVersion::WITNESS_V0, &txdata);
+            uint256 sighash = ctx.WitnessV0SigHash(nin, witnessscript, witness[0].back());
 
             secp256k1_pubkey pubkey;
             secp256k1_ecdsa_signature signature;
@@ -745,6 +991,402 @@ CAmount IContractBuilder::GetNewOutputMiningFee()
     return CFeeRate(*m_mining_fee_rate).GetFee(TAPROOT_VOUT_VSIZE);
 }
 
+namespace {
+
+// CBOR (RFC 8949) subset used for binary contracts
+enum CborMajor: uint8_t { CBOR_UINT = 0, CBOR_NINT = 1, CBOR_BYTES = 2, CBOR_TEXT = 3, CBOR_ARRAY = 4, CBOR_MAP = 5, CBOR_TAG = 6, CBOR_SIMPLE = 7 };
+
+const uint8_t CBOR_FALSE = 0xf4;
+const uint8_t CBOR_TRUE = 0xf5;
+const uint8_t CBOR_NULL = 0xf6;
+const uint8_t CBOR_FLOAT64 = 0xfb;
+// "Embedded JSON" tag keeps numbers which do not fit 64 bit integer as is
+const uint64_t CBOR_TAG_JSON = 262;
+const size_t CBOR_MAX_DEPTH = 64;
+
+void PackHead(bytevector& out, uint8_t major, uint64_t val)
+{
+    uint8_t head = major << 5;
+    size_t len;
+    if (val < 24) { out.push_back(head | val); return; }
+    else if (val <= 0xff) { out.push_back(head | 24); len = 1; }
+    else if (val <= 0xffff) { out.push_back(head | 25); len = 2; }
+    else if (val <= 0xffffffff) { out.push_back(head | 26); len = 4; }
+    else { out.push_back(head | 27); len = 8; }
+
+    for (size_t i = len; i > 0; --i) out.push_back(static_cast<uint8_t>(val >> ((i - 1) * 8)));
+}
+
+bool IsHexData(const std::string& str)
+{ return !str.empty() && str.size() % 2 == 0 && std::all_of(str.begin(), str.end(), [](char c) { return HexDigit(c) >= 0; }); }
+
+void PackText(bytevector& out, const std::string& str)
+{
+    PackHead(out, CBOR_TEXT, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+void PackNumber(bytevector& out, const std::string& num)
+{
+    bool negative = !num.empty() && num.front() == '-';
+    bool integer = num.size() > (negative ? 1 : 0) && std::all_of(num.begin() + (negative ? 1 : 0), num.end(), [](char c) { return c >= '0' && c <= '9'; });
+    if (integer) {
+        try {
+            if (negative) {
+                int64_t val = std::stoll(num);
+                PackHead(out, CBOR_NINT, static_cast<uint64_t>(-1 - val));
+            }
+            else {
+                PackHead(out, CBOR_UINT, std::stoull(num));
+            }
+            return;
+        }
+        catch (const std::out_of_range&) {}
+    }
+    PackHead(out, CBOR_TAG, CBOR_TAG_JSON);
+    PackText(out, num);
+}
+
+void PackValue(bytevector& out, const UniValue& val, size_t depth)
+{
+    if (depth > CBOR_MAX_DEPTH) throw ContractFormatError("binary contract nesting is too deep");
+
+    switch (val.getType()) {
+    case UniValue::VNULL:
+        out.push_back(CBOR_NULL);
+        break;
+    case UniValue::VBOOL:
+        out.push_back(val.get_bool() ? CBOR_TRUE : CBOR_FALSE);
+        break;
+    case UniValue::VNUM:
+        PackNumber(out, val.getValStr());
+        break;
+    case UniValue::VSTR:
+        if (IsHexData(val.get_str())) {
+            const std::string& str = val.get_str();
+            PackHead(out, CBOR_BYTES, str.size() / 2);
+            for (size_t i = 0; i < str.size(); i += 2) {
+                out.push_back(static_cast<uint8_t>((HexDigit(str[i]) << 4) | HexDigit(str[i + 1])));
+            }
+        }
+        else {
+            PackText(out, val.get_str());
+        }
+        break;
+    case UniValue::VARR:
+        PackHead(out, CBOR_ARRAY, val.size());
+        for (size_t i = 0; i < val.size(); ++i) PackValue(out, val[i], depth + 1);
+        break;
+    case UniValue::VOBJ:
+        PackHead(out, CBOR_MAP, val.size());
+        for (size_t i = 0; i < val.size(); ++i) {
+            PackText(out, val.getKeys()[i]);
+            PackValue(out, val.getValues()[i], depth + 1);
+        }
+        break;
+    }
+}
+
+class BinaryReader
+{
+    bytevector::const_iterator m_it;
+    bytevector::const_iterator m_end;
+    const std::vector<std::string>& m_binary_params;
+    std::vector<std::pair<std::string, bytevector>>& m_binary_values;
+
+    uint8_t Byte()
+    {
+        if (m_it == m_end) throw ContractFormatError("binary contract is truncated");
+        return *m_it++;
+    }
+
+    uint64_t Head(uint8_t& major)
+    {
+        uint8_t head = Byte();
+        major = head >> 5;
+        uint8_t info = head & 0x1f;
+        if (major == CBOR_SIMPLE) return info;
+        if (info < 24) return info;
+        if (info > 27) throw ContractFormatError("binary contract: unsupported item " + std::to_string(head));
+
+        uint64_t val = 0;
+        for (size_t i = 0, len = size_t(1) << (info - 24); i < len; ++i) val = (val << 8) | Byte();
+        return val;
+    }
+
+    size_t Length(uint64_t len) const
+    {
+        if (len > static_cast<uint64_t>(m_end - m_it)) throw ContractFormatError("binary contract is truncated");
+        return static_cast<size_t>(len);
+    }
+
+    uint8_t PeekMajor() const
+    {
+        if (m_it == m_end) throw ContractFormatError("binary contract is truncated");
+        return *m_it >> 5;
+    }
+
+    bytevector Bytes()
+    {
+        uint8_t major;
+        uint64_t len = Head(major);
+        if (major != CBOR_BYTES) throw ContractFormatError("binary contract: byte string expected");
+        bytevector res(m_it, m_it + Length(len));
+        m_it += res.size();
+        return res;
+    }
+
+    bool IsBinaryParam(const std::string& key) const
+    { return std::find(m_binary_params.begin(), m_binary_params.end(), key) != m_binary_params.end(); }
+
+    std::string Text()
+    {
+        uint8_t major;
+        uint64_t len = Head(major);
+        if (major != CBOR_TEXT) throw ContractFormatError("binary contract: text expected");
+        std::string res(m_it, m_it + Length(len));
+        m_it += res.size();
+        return res;
+    }
+
+public:
+    // Byte string values of the listed top level params are returned in binary_values instead of the DOM
+    BinaryReader(const bytevector& data, const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values)
+        : m_it(data.begin()), m_end(data.end()), m_binary_params(binary_params), m_binary_values(binary_values) {}
+
+    bool AtEnd() const
+    { return m_it == m_end; }
+
+    UniValue Read(size_t depth, bool params = false)
+    {
+        if (depth > CBOR_MAX_DEPTH) throw ContractFormatError("binary contract nesting is too deep");
+
+        uint8_t major;
+        uint64_t val = Head(major);
+        switch (major) {
+        case CBOR_UINT:
+            return UniValue(val);
+        case CBOR_NINT:
+            if (val > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) throw ContractFormatError("binary contract: integer is out of range");
+            return UniValue(-1 - static_cast<int64_t>(val));
+        case CBOR_BYTES: {
+            size_t len = Length(val);
+            std::string hexstr;
+            hexstr.reserve(len * 2);
+            for (size_t i = 0; i < len; ++i, ++m_it) {
+                hexstr.push_back("0123456789abcdef"[*m_it >> 4]);
+                hexstr.push_back("0123456789abcdef"[*m_it & 0x0f]);
+            }
+            return UniValue(move(hexstr));
+        }
+        case CBOR_TEXT: {
+            std::string str(m_it, m_it + Length(val));
+            m_it += str.size();
+            return UniValue(move(str));
+        }
+        case CBOR_ARRAY: {
+            UniValue arr(UniValue::VARR);
+            for (uint64_t i = 0; i < val; ++i) arr.push_back(Read(depth + 1));
+            return arr;
+        }
+        case CBOR_MAP: {
+            UniValue obj(UniValue::VOBJ);
+            for (uint64_t i = 0; i < val; ++i) {
+                std::string key = Text();
+                if (params && IsBinaryParam(key) && PeekMajor() == CBOR_BYTES) {
+                    m_binary_values.emplace_back(move(key), Bytes());
+                    continue;
+                }
+                bool params_scope = depth == 0 && key == IContractBuilder::name_params;
+                obj.pushKV(move(key), Read(depth + 1, params_scope));
+            }
+            return obj;
+        }
+        case CBOR_TAG: {
+            if (val != CBOR_TAG_JSON) throw ContractFormatError("binary contract: unsupported tag " + std::to_string(val));
+            UniValue num;
+            num.setNumStr(Text());
+            if (!num.isNum()) throw ContractFormatError("binary contract: wrong number");
+            return num;
+        }
+        default: // CBOR_SIMPLE
+            switch (val) {
+            case CBOR_FALSE & 0x1f: return UniValue(false);
+            case CBOR_TRUE & 0x1f: return UniValue(true);
+            case CBOR_NULL & 0x1f: return UniValue();
+            case CBOR_FLOAT64 & 0x1f: {
+                uint64_t bits = 0;
+                for (size_t i = 0; i < 8; ++i) bits = (bits << 8) | Byte();
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                return UniValue(d);
+            }
+            default:
+                throw ContractFormatError("binary contract: unsupported simple value " + std::to_string(val));
+            }
+        }
+    }
+};
+
+// SAX handler building contract DOM right from JSON tokens: strings and keys are moved from the lexer buffer,
+// binary params are hex decoded to their own buffers and are not put to the DOM
+class JsonStreamReader : public nlohmann::json_sax<nlohmann::json>
+{
+    const std::vector<std::string>& m_binary_params;
+    std::vector<std::pair<std::string, bytevector>>& m_binary_values;
+
+    std::vector<std::pair<UniValue, std::string>> m_stack; // open container along with its key in the parent
+    std::string m_key;
+    UniValue m_root;
+
+    bool IsBinaryParam() const
+    {
+        return m_stack.size() == 2 && m_stack.back().second == IContractBuilder::name_params && m_stack.back().first.isObject() &&
+               std::find(m_binary_params.begin(), m_binary_params.end(), m_key) != m_binary_params.end();
+    }
+
+    bool Add(UniValue val)
+    {
+        if (m_stack.empty()) {
+            m_root = move(val);
+        }
+        else if (m_stack.back().first.isObject()) {
+            m_stack.back().first.pushKV(move(m_key), move(val));
+            m_key.clear();
+        }
+        else {
+            m_stack.back().first.push_back(move(val));
+        }
+        return true;
+    }
+
+    bool Close()
+    {
+        auto container = move(m_stack.back());
+        m_stack.pop_back();
+        m_key = move(container.second);
+        return Add(move(container.first));
+    }
+
+public:
+    JsonStreamReader(const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values)
+        : m_binary_params(binary_params), m_binary_values(binary_values) {}
+
+    UniValue& Root()
+    { return m_root; }
+
+    bool null() override
+    { return Add(UniValue()); }
+    bool boolean(bool val) override
+    { return Add(UniValue(val)); }
+    bool number_integer(number_integer_t val) override
+    { return Add(UniValue(static_cast<int64_t>(val))); }
+    bool number_unsigned(number_unsigned_t val) override
+    { return Add(UniValue(static_cast<uint64_t>(val))); }
+
+    bool number_float(number_float_t, const string_t& str) override
+    {
+        // Keep the original text like UniValue::read() does: the value may not fit double precisely
+        UniValue num;
+        num.setNumStr(str);
+        return Add(move(num));
+    }
+
+    bool string(string_t& str) override
+    {
+        if (IsBinaryParam()) {
+            bytevector data;
+            if (!DecodeHex(str, data)) throw ContractTermWrongValue(m_key + ": " + str);
+            m_binary_values.emplace_back(move(m_key), move(data));
+            m_key.clear();
+            return true;
+        }
+        return Add(UniValue(move(str)));
+    }
+
+    bool binary(binary_t&) override
+    { return false; }
+
+    bool start_object(std::size_t) override
+    {
+        m_stack.emplace_back(UniValue(UniValue::VOBJ), move(m_key));
+        m_key.clear();
+        return true;
+    }
+
+    bool key(string_t& key) override
+    {
+        m_key = move(key);
+        return true;
+    }
+
+    bool end_object() override
+    { return Close(); }
+
+    bool start_array(std::size_t) override
+    {
+        m_stack.emplace_back(UniValue(UniValue::VARR), move(m_key));
+        m_key.clear();
+        return true;
+    }
+
+    bool end_array() override
+    { return Close(); }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+    { return false; }
+};
+
+}
+
+UniValue IContractBuilder::ParseContract(const std::string& data, const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values)
+{
+    JsonStreamReader reader(binary_params, binary_values);
+    if (!nlohmann::json::sax_parse(data, &reader)) return {};
+    return move(reader.Root());
+}
+
+bytevector IContractBuilder::PackBinary(const UniValue& json, const std::vector<std::pair<std::string, std::span<const uint8_t>>>& binary_values)
+{
+    bytevector out;
+    if (binary_values.empty()) {
+        PackValue(out, json, 0);
+        return out;
+    }
+
+    if (!json.isObject() || !json[name_params].isObject()) throw ContractStateError("binary params are passed w/o contract params");
+
+    PackHead(out, CBOR_MAP, json.size());
+    for (size_t i = 0; i < json.size(); ++i) {
+        PackText(out, json.getKeys()[i]);
+        if (json.getKeys()[i] != name_params) {
+            PackValue(out, json.getValues()[i], 1);
+            continue;
+        }
+
+        const UniValue& params = json.getValues()[i];
+        PackHead(out, CBOR_MAP, params.size() + binary_values.size());
+        for (size_t j = 0; j < params.size(); ++j) {
+            PackText(out, params.getKeys()[j]);
+            PackValue(out, params.getValues()[j], 2);
+        }
+        for (const auto& param: binary_values) {
+            PackText(out, param.first);
+            PackHead(out, CBOR_BYTES, param.second.size());
+            out.insert(out.end(), param.second.begin(), param.second.end());
+        }
+    }
+    return out;
+}
+
+UniValue IContractBuilder::UnpackBinary(const bytevector& data, const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values)
+{
+    BinaryReader reader(data, binary_params, binary_values);
+    UniValue res = reader.Read(0);
+    if (!reader.AtEnd()) throw ContractFormatError("binary contract has trailing data");
+    return res;
+}
+
 void IContractBuilder::DeserializeContractAmount(const UniValue &val, std::optional<CAmount> &target, const std::function<std::string()> &lazy_name)
 {
     if (!val.isNull()) {
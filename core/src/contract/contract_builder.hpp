@@ -1,21 +1,29 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <optional>
 #include <vector>
+#include <initializer_list>
 #include <stdexcept>
 #include <memory>
 #include <sstream>
+#include <span>
 #include <list>
+#include <unordered_map>
 
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/multiprecision/debug_adaptor.hpp>
 
 #include "univalue.h"
+#include "interpreter.h"
+#include "util/hasher.h"
 #include "base58.hpp"
 
 #include "utils.hpp"
 #include "contract_error.hpp"
+#include "worker_pool.hpp"
+#include "contract_memory.hpp"
 #include "keyregistry.hpp"
 
 #include "ecdsa.hpp"
@@ -47,13 +55,21 @@ using l15::core::SchnorrKeyPair;
 using l15::core::KeyPair;
 using l15::core::KeyRegistry;
 
-#ifndef DEBUG
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128_t;
+#elif !defined(DEBUG)
 using boost::multiprecision::uint128_t;
 #else
 namespace bmp = boost::multiprecision;
 using uint128_t = bmp::number<bmp::debug_adaptor<bmp::cpp_int_backend<128, 128, bmp::unsigned_magnitude, bmp::unchecked, void> >>;
 #endif
 
+// std::numeric_limits is not specialized for the native 128 bit integer in strict ISO mode
+const uint128_t MAX_UINT128 = ~uint128_t(0);
+
+// Hex encodes a transaction while serializing it, so the binary serialization is never held in memory
+std::string SerializeHexTx(const CMutableTransaction& tx);
+
 enum OutputType {
     P2WPKH_DEFAULT, // m/84'/0'/0'/0/*
     TAPROOT_DEFAULT, // m/86'/0'/0'/0/* or m/86'/0'/0'/1/*
@@ -75,6 +91,16 @@ struct IJsonSerializable
 class ISigner;
 struct TxInput;
 
+// Process wide counter of the contract changes which are not seen by a dependent contract directly: destination amounts
+// changed in place and transactions rebuilt by a parent contract. Cached transactions are re-validated when it moves.
+inline std::atomic<uint64_t> g_contract_generation = 0;
+
+inline uint64_t ContractGeneration()
+{ return g_contract_generation.load(std::memory_order_acquire); }
+
+inline void BumpContractGeneration()
+{ g_contract_generation.fetch_add(1, std::memory_order_acq_rel); }
+
 struct IContractDestination: IJsonSerializable
 {
     static const std::string name_amount;
@@ -122,6 +148,11 @@ protected:
     CAmount m_amount = 0;
     std::string m_addr;
 
+    // Decoded once by the concrete address type constructor
+    bytevector m_program; // witness program or pubkey/script hash
+    CScript m_pubkeyscript;
+    CAmount m_dust = 0;
+
 private:
     P2Address(ChainMode chain, const UniValue& json, const std::function<std::string()>& lazy_name);
 
@@ -168,14 +199,19 @@ private:
     friend IContractDestination;
 
 protected:
-    void CheckDust() const;
+    unsigned m_witver = 0;
+
+    void CheckDust() const
+    { if (m_amount < m_dust) throw ContractTermWrongValue("Dust"); }
+    void InitPubKeyScript();
 public:
     P2Witness() = delete;//default;
     P2Witness(const P2Witness&) = default;
     P2Witness(P2Witness&&) noexcept = default;
 
-    P2Witness(ChainMode chain, CAmount amount, std::string addr): P2Address(chain, amount, move(addr))
-    { CheckDust(); }
+    P2Witness(ChainMode chain, CAmount amount, std::string addr);
+    // Takes the witness version and program already decoded from addr
+    P2Witness(ChainMode chain, CAmount amount, std::string addr, unsigned witver, bytevector program);
 
     ~P2Witness() override = default;
 
@@ -187,11 +223,14 @@ public:
     void Amount(CAmount amount) override
     {
         m_amount = amount;
+        BumpContractGeneration();
         if (amount != 0) CheckDust();
     }
 
     CScript PubKeyScript() const override
-    { return Bech32(BTC, m_chain).PubKeyScript(m_addr); }
+    { return m_pubkeyscript; }
+
+    static CAmount DustThreshold(const CScript& pubkeyscript);
 
     CScript ScriptSig() const override
     { return {};}
@@ -211,6 +250,8 @@ public:
     P2WPKH(P2WPKH&&) noexcept = default;
     P2WPKH(ChainMode m, CAmount amount, std::string addr) : P2WPKH(Bech32(BTC, m), amount, move(addr)) {}
     P2WPKH(Bech32 bech, CAmount amount, std::string addr) : P2Witness(bech.GetChainMode(), amount, move(addr)) {}
+    P2WPKH(ChainMode m, CAmount amount, std::string addr, unsigned witver, bytevector program)
+        : P2Witness(m, amount, move(addr), witver, move(program)) {}
     std::shared_ptr<ISigner> LookupKey(const KeyRegistry& masterKey, const std::string& key_filter_tag) const override;
     std::vector<bytevector> DummyWitness() const override
     { return { bytevector(72), bytevector(33) }; }
@@ -225,6 +266,8 @@ public:
     P2TR(P2TR &&) noexcept = default;
     P2TR(ChainMode m, CAmount amount, std::string addr) : P2TR(Bech32(BTC, m), amount, move(addr)) {}
     P2TR(Bech32 bech, CAmount amount, std::string addr) : P2Witness(bech.GetChainMode(), amount, move(addr)) {}
+    P2TR(ChainMode m, CAmount amount, std::string addr, unsigned witver, bytevector program)
+        : P2Witness(m, amount, move(addr), witver, move(program)) {}
     std::shared_ptr<ISigner> LookupKey(const KeyRegistry& masterKey, const std::string& key_filter_tag) const override;
     std::vector<bytevector> DummyWitness() const override { return { signature() }; }
     void SetSignature(TxInput &input, bytevector pk, bytevector sig) override;
@@ -235,7 +278,9 @@ class P2Legacy: public P2Address
 {
 protected:
     std::optional<compressed_pubkey> m_pubkey;
-    void CheckDust() const;
+
+    void CheckDust() const
+    { if (m_amount < m_dust) throw ContractTermWrongValue("Dust"); }
 public:
     P2Legacy() = delete;
     P2Legacy(const P2Legacy&) = default;
@@ -248,30 +293,31 @@ public:
     void Amount(CAmount amount) override
     {
         m_amount = amount;
+        BumpContractGeneration();
         if (amount != 0) CheckDust();
     }
     std::vector<bytevector> DummyWitness() const override
     { return {}; }
 
+    CScript PubKeyScript() const override
+    { return m_pubkeyscript; }
+
+    static CAmount DustThreshold(const CScript& pubkeyscript);
+
     static std::shared_ptr<IContractDestination> Construct(ChainMode chain, std::optional<CAmount> amount, std::string addr, compressed_pubkey pubkey);
 };
 
 class P2PKH: public P2Legacy
 {
-    bytevector DecodePubKeyHash() const;
     void CheckPubKey() const;
+    void Init();
 public:
     P2PKH() = delete;
     P2PKH(const P2PKH&) = default;
     P2PKH(P2PKH&&) noexcept = default;
-    P2PKH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk = {})
-        : P2Legacy(chain, amount, move(addr), move(pk))
-    {
-        CheckDust();
-        CheckPubKey();
-    }
-
-    CScript PubKeyScript() const override;
+    P2PKH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk = {});
+    // Takes the pubkey hash already decoded from addr
+    P2PKH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk, bytevector keyhash);
 
     std::shared_ptr<ISigner> LookupKey(const KeyRegistry& masterKey, const std::string& key_filter_tag) const override;
 
@@ -286,21 +332,15 @@ public:
 
 class P2SH: public P2Legacy
 {
-    bytevector DecodeScriptHash() const;
     void CheckPubKey() const;
+    void Init();
 public:
     P2SH() = delete;
     P2SH(const P2SH&) = default;
     P2SH(P2SH&&) noexcept = default;
-    P2SH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk = {})
-        : P2Legacy(chain, amount, move(addr), move(pk))
-    {
-        CheckDust();
-        if (m_pubkey) CheckPubKey();
-    }
-
-    CScript PubKeyScript() const override
-    { return CScript() << OP_HASH160 << DecodeScriptHash() << OP_EQUAL; }
+    P2SH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk = {});
+    // Takes the script hash already decoded from addr
+    P2SH(ChainMode chain, CAmount amount, std::string addr, std::optional<compressed_pubkey> pk, bytevector scripthash);
 
     CScript ScriptSig() const override;
 
@@ -335,7 +375,7 @@ public:
     explicit OpReturnDestination(const UniValue& json, const std::function<std::string()>& lazy_name);
 
     const char* Type() const override { return type; }
-    void Amount(CAmount amount) override { m_amount = amount; }
+    void Amount(CAmount amount) override { m_amount = amount; BumpContractGeneration(); }
     CAmount Amount() const final { return m_amount; }
 
     void Data(bytevector data);
@@ -364,6 +404,7 @@ class IContractMultiOutput {
 public:
     virtual ~IContractMultiOutput() = default;
     virtual std::string TxID() const = 0;
+    virtual Txid TxHash() const { return Txid::FromUint256(uint256S(TxID())); }
     virtual const std::vector<std::shared_ptr<IContractDestination>>& Destinations() const = 0;
     virtual uint32_t CountDestinations() const = 0;
 };
@@ -374,6 +415,7 @@ public:
     virtual ~IContractOutput() = default;
     virtual std::string TxID() const = 0;
     virtual uint32_t NOut() const = 0;
+    virtual COutPoint OutPoint() const { return {Txid::FromUint256(uint256S(TxID())), NOut()}; }
     virtual CAmount Amount() const { return Destination()->Amount(); }
     virtual std::string Address() const { return Destination()->Address(); }
     virtual const std::shared_ptr<IContractDestination> & Destination() const = 0;
@@ -426,12 +468,84 @@ struct TxInput : public IJsonSerializable
     bool operator<(const TxInput& r) const { return nin < r.nin; }
 };
 
+// Transaction weight accumulated from inputs and outputs so the fee can be calculated without building and serializing a transaction.
+// Inputs w/o scriptSig or witness contribute with dummy ones provided by the destination being spent, same as contract MakeTx() does.
+class TxWeight
+{
+    size_t m_vin_count = 0;
+    size_t m_vout_count = 0;
+    size_t m_vin_size = 0;
+    size_t m_vout_size = 0;
+    size_t m_witness_size = 0;
+    size_t m_witness_count = 0;
+
+public:
+    static size_t InputSize(const CScript& scriptSig)
+    { return InputSize(scriptSig.size()); }
+    static size_t InputSize(size_t scriptsig_size);
+    static size_t WitnessSize(const std::vector<bytevector>& stack);
+    static size_t WitnessSize(std::initializer_list<size_t> item_sizes);
+    static size_t OutputSize(const CScript& pubkeyscript)
+    { return OutputSize(pubkeyscript.size()); }
+    static size_t OutputSize(size_t pubkeyscript_size);
+
+    void AddInput(const CScript& scriptSig, const std::vector<bytevector>& witness)
+    { AddInput(InputSize(scriptSig), witness.empty() ? 0 : WitnessSize(witness)); }
+    void AddInput(const TxInput& input);
+    // Serialized input and witness sizes, zero witness size stands for an input w/o witness
+    void AddInput(size_t input_size, size_t witness_size);
+    void AddOutput(const IContractDestination& destination)
+    { AddOutput(OutputSize(destination.PubKeyScript())); }
+    void AddOutput(size_t output_size)
+    {
+        ++m_vout_count;
+        m_vout_size += output_size;
+    }
+    void RemoveOutput(const IContractDestination& destination)
+    {
+        --m_vout_count;
+        m_vout_size -= OutputSize(destination.PubKeyScript());
+    }
+
+    int64_t Weight() const;
+    int64_t VSize() const;
+    CAmount Fee(CAmount fee_rate) const;
+};
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+// Signature hash state shared by all the inputs of a transaction: BIP143/BIP341 midstates are calculated once.
+// Referenced transaction must outlive the context and stay unchanged while the context is in use.
+class TxSigningContext
+{
+    const CMutableTransaction& m_tx;
+    PrecomputedTransactionData m_txdata;
+public:
+    TxSigningContext(const CMutableTransaction& tx, std::vector<CTxOut> spent_outputs) : m_tx(tx)
+    { m_txdata.Init(tx, move(spent_outputs), true); }
+
+    TxSigningContext(const TxSigningContext&) = delete;
+    TxSigningContext& operator=(const TxSigningContext&) = delete;
+
+    const CMutableTransaction& Tx() const { return m_tx; }
+    const std::vector<CTxOut>& SpentOutputs() const { return m_txdata.m_spent_outputs; }
+    const PrecomputedTransactionData& TxData() const { return m_txdata; }
+
+    uint256 TaprootSigHash(uint32_t nin, uint8_t hashtype, const CScript& spend_script) const;
+    uint256 WitnessV0SigHash(uint32_t nin, const CScript& witness_script, int hashtype) const;
+    uint256 LegacySigHash(uint32_t nin, const CScript& script, int hashtype) const;
+
+    signature SignTaproot(const SchnorrKeyPair& keypair, uint32_t nin, const CScript& spend_script, uint8_t hashtype = SIGHASH_DEFAULT) const;
+    static bytevector SignEcdsa(const EcdsaKeyPair& keypair, const uint256& sighash, int hashtype);
+};
+
 class ISigner
 {
 public:
-    virtual void SignInput(TxInput& input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs, int hashtype) const = 0;
+    virtual void SignInput(TxInput& input, const TxSigningContext& ctx, int hashtype) const = 0;
+
+    void SignInput(TxInput& input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs, int hashtype) const
+    { SignInput(input, TxSigningContext(tx, move(spent_outputs)), hashtype); }
 };
 
 class P2PKHSigner : public ISigner
@@ -444,8 +558,8 @@ public:
     P2PKHSigner& operator=(const P2PKHSigner&) = default;
     P2PKHSigner& operator=(P2PKHSigner&&) noexcept = default;
 
-    void SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                   int hashtype) const override;
+    using ISigner::SignInput;
+    void SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const override;
 };
 
 class P2WPKHSigner: public ISigner
@@ -458,8 +572,8 @@ public:
     P2WPKHSigner& operator=(const P2WPKHSigner&) = default;
     P2WPKHSigner& operator=(P2WPKHSigner&&) noexcept = default;
 
-    void SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                   int hashtype) const override;
+    using ISigner::SignInput;
+    void SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const override;
 };
 
 class TaprootSigner: public ISigner
@@ -472,8 +586,8 @@ public:
     TaprootSigner& operator=(const TaprootSigner&) = default;
     TaprootSigner& operator=(TaprootSigner&&) noexcept = default;
 
-    void SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                   int hashtype) const override;
+    using ISigner::SignInput;
+    void SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const override;
 };
 
 class P2WPKH_P2SHSigner: public ISigner
@@ -486,8 +600,55 @@ public:
     P2WPKH_P2SHSigner& operator=(const P2WPKH_P2SHSigner&) = default;
     P2WPKH_P2SHSigner& operator=(P2WPKH_P2SHSigner&&) noexcept = default;
 
-    void SignInput(TxInput &input, const CMutableTransaction &tx, std::vector<CTxOut> spent_outputs,
-                   int hashtype) const override;
+    using ISigner::SignInput;
+    void SignInput(TxInput &input, const TxSigningContext& ctx, int hashtype) const override;
+};
+
+// Resolves keys once per signing session: inputs paying the same address share one signer
+// and every distinct address or pubkey is looked up in the key registry only once.
+// It is not thread safe, so all the lookups have to be done before parallel signing.
+class SignerCache
+{
+    struct XOnlyPubKeyHasher
+    {
+        SaltedUint256Hasher m_hasher;
+        size_t operator()(const xonly_pubkey& pk) const
+        { return m_hasher(uint256(Span<const unsigned char>(pk.data(), pk.size()))); }
+    };
+
+    const KeyRegistry& m_master_key;
+    std::string m_key_filter_tag;
+    std::unordered_map<std::string, std::shared_ptr<ISigner>> m_signers;
+    std::unordered_map<xonly_pubkey, SchnorrKeyPair, XOnlyPubKeyHasher> m_keypairs;
+public:
+    SignerCache(const KeyRegistry& master_key, std::string key_filter_tag) : m_master_key(master_key), m_key_filter_tag(move(key_filter_tag)) {}
+    SignerCache(const SignerCache&) = delete;
+    SignerCache& operator=(const SignerCache&) = delete;
+
+    // Collects the addresses and pubkeys missing in the cache and resolves them in a single pass
+    void Resolve(const std::vector<const IContractDestination*>& destinations, const std::vector<xonly_pubkey>& pubkeys = {});
+
+    const std::shared_ptr<ISigner>& Signer(const IContractDestination& dest);
+
+    template <typename INPUTS>
+    std::vector<std::shared_ptr<ISigner>> Signers(const INPUTS& inputs)
+    {
+        std::vector<const IContractDestination*> destinations;
+        destinations.reserve(inputs.size());
+        for (const auto& input: inputs) {
+            destinations.emplace_back(input.output->Destination().get());
+        }
+        Resolve(destinations);
+
+        std::vector<std::shared_ptr<ISigner>> signers;
+        signers.reserve(inputs.size());
+        for (const IContractDestination* dest: destinations) {
+            signers.emplace_back(Signer(*dest));
+        }
+        return signers;
+    }
+
+    const SchnorrKeyPair& SchnorrKey(const xonly_pubkey& pk);
 };
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -502,6 +663,7 @@ public:
 
     std::string TxID() const override { return m_contract->TxID(); }
     uint32_t NOut() const override { return m_nout; }
+    COutPoint OutPoint() const override { return {m_contract->TxHash(), m_nout}; }
     const std::shared_ptr<IContractDestination> & Destination() const override { return m_contract->Destinations()[m_nout]; }
     std::shared_ptr<IContractDestination> Destination() override { return m_contract->Destinations()[m_nout]; }
 };
@@ -518,21 +680,22 @@ public:
 private:
     ChainMode m_chain;
     std::string m_txid;
+    Txid m_txhash; // parsed once to build transactions w/o hex decoding
     uint32_t m_nout = 0;
     std::shared_ptr<IContractDestination> m_destination;
 public:
     //UTXO() = default;
     UTXO(ChainMode chain, std::string txid, uint32_t nout, CAmount amount, std::string addr)
-        : m_chain(chain), m_txid(move(txid)), m_nout(nout), m_destination(P2Address::Construct(chain, amount, move(addr))) {}
+        : m_chain(chain), m_txid(move(txid)), m_txhash(Txid::FromUint256(uint256S(m_txid))), m_nout(nout), m_destination(P2Address::Construct(chain, amount, move(addr))) {}
 
     UTXO(ChainMode chain, std::string txid, uint32_t nout, std::shared_ptr<IContractDestination> destination)
-        : m_chain(chain), m_txid(move(txid)), m_nout(nout), m_destination(move(destination)) {}
+        : m_chain(chain), m_txid(move(txid)), m_txhash(Txid::FromUint256(uint256S(m_txid))), m_nout(nout), m_destination(move(destination)) {}
 
     UTXO(ChainMode chain, const IContractOutput& out)
-        : m_chain(chain), m_txid(out.TxID()), m_nout(out.NOut()), m_destination(out.Destination()) {}
+        : m_chain(chain), m_txid(out.TxID()), m_txhash(out.OutPoint().hash), m_nout(out.NOut()), m_destination(out.Destination()) {}
 
     UTXO(ChainMode chain, const IContractMultiOutput& out, uint32_t nout)
-        : m_chain(chain), m_txid(out.TxID()), m_nout(nout), m_destination(out.Destinations()[nout]) {}
+        : m_chain(chain), m_txid(out.TxID()), m_txhash(out.TxHash()), m_nout(nout), m_destination(out.Destinations()[nout]) {}
 
     explicit UTXO(ChainMode chain, const UniValue& json, const std::function<std::string()>& lazy_name) : m_chain(chain)
     { UTXO::ReadJson(json, lazy_name); }
@@ -543,6 +706,9 @@ public:
     uint32_t NOut() const final
     { return  m_nout; }
 
+    COutPoint OutPoint() const final
+    { return {m_txhash, m_nout}; }
+
     const std::shared_ptr<IContractDestination> & Destination() const final
     { return m_destination; }
     std::shared_ptr<IContractDestination> Destination() final
@@ -592,8 +758,22 @@ protected:
     std::list<std::shared_ptr<IContractDestination>> m_custom_fees;
     std::optional<std::string> m_change_addr;
 
+    std::shared_ptr<WorkerPool> m_worker_pool;
+    std::shared_ptr<std::pmr::memory_resource> m_arena;
+
     virtual CAmount CalculateWholeFee(const std::string &params) const;
 
+    // Runs independent per-input work on the worker pool if it is set or serially otherwise
+    void ForEachInput(size_t count, const std::function<void(size_t)>& task) const
+    {
+        if (m_worker_pool) {
+            m_worker_pool->ForEach(count, task);
+        }
+        else {
+            for (size_t i = 0; i < count; ++i) task(i);
+        }
+    }
+
     ///deprecated
     virtual std::vector<std::pair<CAmount,CMutableTransaction>> GetTransactions() const { return {}; };
 
@@ -621,7 +801,7 @@ public:
             m_market_fee = P2Address::Construct(chain(), amount, move(addr));
         }
         else {
-            m_market_fee = std::make_shared<ZeroDestination>();
+            m_market_fee = MakeContractObject<ZeroDestination>();
         }
     }
 
@@ -644,8 +824,32 @@ public:
 
     CAmount GetMiningFeeRate() const { return m_mining_fee_rate.value(); }
 
-    static void VerifyTxSignature(const xonly_pubkey& pk, const signature& sig, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs, const CScript& spend_script);
-    static void VerifyTxSignature(ChainMode chain, const std::string& addr, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs);
+    // Pool used to sign and verify inputs in parallel; may be shared between builders. Null pool means serial processing.
+    void WorkerThreads(std::shared_ptr<WorkerPool> pool)
+    { m_worker_pool = move(pool); }
+
+    // Arena for the contract objects created by deserialization; it is kept alive by the builder and by every such object
+    void MemoryArena(std::shared_ptr<std::pmr::memory_resource> arena)
+    { m_arena = move(arena); }
+
+    static void VerifyTxSignature(const xonly_pubkey& pk, const signature& sig, const TxSigningContext& ctx, uint32_t nin, const CScript& spend_script);
+    static void VerifyTxSignature(ChainMode chain, const std::string& addr, const TxSigningContext& ctx, uint32_t nin);
+
+    static void VerifyTxSignature(const xonly_pubkey& pk, const signature& sig, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs, const CScript& spend_script)
+    { VerifyTxSignature(pk, sig, TxSigningContext(tx, move(spent_outputs)), nin, spend_script); }
+    static void VerifyTxSignature(ChainMode chain, const std::string& addr, const CMutableTransaction& tx, uint32_t nin, std::vector<CTxOut> spent_outputs)
+    { VerifyTxSignature(chain, addr, TxSigningContext(tx, move(spent_outputs)), nin); }
+
+    // Contract JSON <-> CBOR conversion: lowercase even-length hex strings are packed as byte strings and restored as hex.
+    // Raw binary values are packed as byte strings of the top level params; byte strings of the listed binary params
+    // are returned in binary_values as is instead of the DOM.
+    static bytevector PackBinary(const UniValue& json, const std::vector<std::pair<std::string, std::span<const uint8_t>>>& binary_values = {});
+    static UniValue UnpackBinary(const bytevector& data, const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values);
+
+    // Streaming contract JSON parser: builds the DOM right from the parser tokens w/o reading the whole text into an intermediate tree.
+    // Hex string values of the listed top level params are decoded in place and returned in binary_values instead of the DOM.
+    // Returns null value if data is not a valid JSON.
+    static UniValue ParseContract(const std::string& data, const std::vector<std::string>& binary_params, std::vector<std::pair<std::string, bytevector>>& binary_values);
 
     static void DeserializeContractAmount(const UniValue& val, std::optional<CAmount> &target, const std::function<std::string()> &lazy_name);
     static void DeserializeContractString(const UniValue& val, std::optional<std::string> &target, const std::function<std::string()> &lazy_name);
@@ -666,7 +870,7 @@ public:
             if (target) {
                 if (*target != hexdata) throw ContractTermMismatch(lazy_name() + " is already set to " + hex(*target));
             }
-            else target = hexdata;
+            else target = move(hexdata);
         }
     }
 
@@ -696,18 +900,31 @@ public:
 
     void Deserialize(const std::string& data, PHASE phase)
     {
-        UniValue root;
-        root.read(data);
+        std::vector<std::pair<std::string, bytevector>> binary_values;
+        UniValue root = ParseContract(data, BinaryParams(), binary_values);
 
-        if (!root.isObject() || !root[name_contract_type].isStr() || !root[name_params].isObject())
-            throw ContractProtocolError("JSON is not " + GetContractName() + " contract");
+        ReadContract(root, phase, move(binary_values));
+    }
 
-        if (root[name_contract_type].get_str() != GetContractName())
-            throw ContractProtocolError(GetContractName() + " contract does not match " + root[name_contract_type].getValStr());
+    // Compact binary (CBOR) form of the same contract structure: hex encoded fields are stored as raw byte strings
+    bytevector SerializeBinary(uint32_t version, PHASE phase) const
+    {
+        CheckContractTerms(version, phase);
 
-        ReadJson(root[name_params], phase);
+        std::vector<std::pair<std::string, std::span<const uint8_t>>> binary_values;
+        UniValue dataRoot(UniValue::VOBJ);
+        dataRoot.pushKV(name_contract_type, GetContractName());
+        dataRoot.pushKV(name_params, MakeBinaryJson(version, phase, binary_values));
 
-        CheckContractTerms(GetVersion(), phase);
+        return PackBinary(dataRoot, binary_values);
+    }
+
+    void DeserializeBinary(const bytevector& data, PHASE phase)
+    {
+        std::vector<std::pair<std::string, bytevector>> binary_values;
+        UniValue root = UnpackBinary(data, BinaryParams(), binary_values);
+
+        ReadContract(root, phase, move(binary_values));
     }
 
     virtual const std::string& GetContractName() const = 0;
@@ -716,6 +933,35 @@ public:
     virtual UniValue MakeJson(uint32_t version, PHASE phase) const = 0;
     virtual void ReadJson(const UniValue& json, PHASE phase) = 0;
 
+protected:
+    // Params holding (potentially large) hex encoded data which Deserialize() passes to ReadBinaryParam() before ReadJson() call
+    virtual const std::vector<std::string>& BinaryParams() const
+    { static const std::vector<std::string> none; return none; }
+    virtual void ReadBinaryParam(const std::string& name, bytevector&& data)
+    { throw ContractStateError("unexpected binary param: " + name); }
+    // Contract JSON w/o BinaryParams() values: SerializeBinary() packs them right from the returned builder fields
+    virtual UniValue MakeBinaryJson(uint32_t version, PHASE phase, std::vector<std::pair<std::string, std::span<const uint8_t>>>& binary_values) const
+    { return MakeJson(version, phase); }
+
+private:
+    void ReadContract(const UniValue& root, PHASE phase, std::vector<std::pair<std::string, bytevector>> binary_values)
+    {
+        std::optional<ContractMemoryScope> memory_scope;
+        if (m_arena) memory_scope.emplace(m_arena);
+
+        if (!root.isObject() || !root[name_contract_type].isStr() || !root[name_params].isObject())
+            throw ContractProtocolError("JSON is not " + GetContractName() + " contract");
+
+        if (root[name_contract_type].get_str() != GetContractName())
+            throw ContractProtocolError(GetContractName() + " contract does not match " + root[name_contract_type].getValStr());
+
+        for (auto& param: binary_values) {
+            ReadBinaryParam(param.first, move(param.second));
+        }
+        ReadJson(root[name_params], phase);
+
+        CheckContractTerms(GetVersion(), phase);
+    }
 };
 
 } // utxord
@@ -36,7 +36,7 @@ template <>
 struct ContractDestinationFactory<ZeroDestination>
 {
     static std::shared_ptr<IContractDestination> ReadJson(ChainMode chain, const UniValue& json, const std::function<std::string()>& lazy_name)
-    { return std::make_shared<ZeroDestination>(json, lazy_name); }
+    { return MakeContractObject<ZeroDestination>(json, lazy_name); }
 };
 
 typedef ContractDestinationFactory<P2Address, P2Witness, RuneStoneDestination, OpReturnDestination, ZeroDestination> DestinationFactory;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace utxord {
+
+// Allocator holding a reference to its arena: every contract object allocated from the arena keeps it alive,
+// so the objects escaping the builder (outputs, inputs, nested builders) never outlive their memory.
+template <typename T>
+class ContractAllocator
+{
+    template <typename U> friend class ContractAllocator;
+    std::shared_ptr<std::pmr::memory_resource> m_arena;
+public:
+    using value_type = T;
+
+    explicit ContractAllocator(std::shared_ptr<std::pmr::memory_resource> arena) noexcept : m_arena(move(arena)) {}
+    template <typename U>
+    ContractAllocator(const ContractAllocator<U>& other) noexcept : m_arena(other.m_arena) {}
+
+    T* allocate(size_t n)
+    { return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) noexcept
+    { m_arena->deallocate(p, n * sizeof(T), alignof(T)); }
+
+    template <typename U>
+    bool operator==(const ContractAllocator<U>& other) const noexcept
+    { return m_arena == other.m_arena; }
+};
+
+// Arena for contract object graph nodes (destinations, outputs, nested builders) created on the current thread.
+// A builder installs its own arena (see IContractBuilder::MemoryArena()) for the time of contract deserialization only.
+// The arena may be released by the last object from another thread, so it has to be safe to deallocate concurrently,
+// i.e. std::pmr::monotonic_buffer_resource, which does not free anything before destruction.
+class ContractMemoryScope
+{
+    static inline thread_local std::shared_ptr<std::pmr::memory_resource> s_arena;
+    std::shared_ptr<std::pmr::memory_resource> m_prev;
+public:
+    explicit ContractMemoryScope(std::shared_ptr<std::pmr::memory_resource> arena) : m_prev(move(s_arena))
+    { s_arena = move(arena); }
+
+    ~ContractMemoryScope()
+    { s_arena = move(m_prev); }
+
+    ContractMemoryScope(const ContractMemoryScope&) = delete;
+    ContractMemoryScope& operator=(const ContractMemoryScope&) = delete;
+
+    static const std::shared_ptr<std::pmr::memory_resource>& Arena()
+    { return s_arena; }
+};
+
+// Object and its shared_ptr control block are allocated at once from the current contract arena if any
+template <typename T, typename... ARGS>
+std::shared_ptr<T> MakeContractObject(ARGS&&... args)
+{
+    if (const auto& arena = ContractMemoryScope::Arena())
+        return std::allocate_shared<T>(ContractAllocator<T>(arena), std::forward<ARGS>(args)...);
+    return std::make_shared<T>(std::forward<ARGS>(args)...);
+}
+
+}
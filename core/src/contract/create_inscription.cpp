@@ -10,11 +10,14 @@
 
 #include "transaction.hpp"
 #include "psbt.hpp"
+#include "crypto/common.h"
 
 #include "create_inscription.hpp"
 
 #include <exception>
+#include <fstream>
 #include <ranges>
+#include <string_view>
 #include <deque>
 
 #include "contract_builder_factory.hpp"
@@ -33,6 +36,55 @@ const char* LAZY_INSCRIPTION_MARKET_TERMS_STR = "LAZY_INSCRIPTION_MARKET_TERMS";
 const char* LAZY_INSCRIPTION_SIGNATURE_STR = "LAZY_INSCRIPTION_SIGNATURE";
 const char* INSCRIPTION_SIGNATURE_STR = "INSCRIPTION_SIGNATURE";
 
+// Same encoding as CScript::operator<<(const std::vector<unsigned char>&) w/o a temporary copy of the data
+void PushScriptData(CScript& script, std::span<const uint8_t> data)
+{
+    if (data.size() < OP_PUSHDATA1) {
+        script.insert(script.end(), static_cast<uint8_t>(data.size()));
+    }
+    else if (data.size() <= 0xff) {
+        script.insert(script.end(), static_cast<uint8_t>(OP_PUSHDATA1));
+        script.insert(script.end(), static_cast<uint8_t>(data.size()));
+    }
+    else if (data.size() <= 0xffff) {
+        uint8_t size[2];
+        WriteLE16(size, static_cast<uint16_t>(data.size()));
+        script.insert(script.end(), static_cast<uint8_t>(OP_PUSHDATA2));
+        script.insert(script.end(), size, size + sizeof(size));
+    }
+    else {
+        uint8_t size[4];
+        WriteLE32(size, static_cast<uint32_t>(data.size()));
+        script.insert(script.end(), static_cast<uint8_t>(OP_PUSHDATA4));
+        script.insert(script.end(), size, size + sizeof(size));
+    }
+    script.insert(script.end(), data.begin(), data.end());
+}
+
+// Size of the data pushed by PushScriptData()
+size_t PushScriptDataSize(size_t data_size)
+{
+    if (data_size < OP_PUSHDATA1) return 1 + data_size;
+    if (data_size <= 0xff) return 2 + data_size;
+    if (data_size <= 0xffff) return 3 + data_size;
+    return 5 + data_size;
+}
+
+// Size of the data pushed by MAX_PUSH chunks, every chunk is preceded with a tag of tag_size
+size_t ChunkedScriptDataSize(size_t data_size, size_t tag_size)
+{
+    size_t rest = data_size % MAX_PUSH;
+    return (data_size / MAX_PUSH) * (tag_size + PushScriptDataSize(MAX_PUSH)) + (rest ? tag_size + PushScriptDataSize(rest) : 0);
+}
+
+// Same threshold as P2Address::Construct() destinations check against
+CAmount DustThreshold(const CScript& pubkeyscript)
+{
+    int witver;
+    bytevector program;
+    return pubkeyscript.IsWitnessProgram(witver, program) ? P2Witness::DustThreshold(pubkeyscript) : P2Legacy::DustThreshold(pubkeyscript);
+}
+
 }
 
 const uint32_t CreateInscriptionBuilder::s_protocol_version = 12;
@@ -92,7 +144,12 @@ const std::string& CreateInscriptionBuilder::GetContractName() const
 
 CScript CreateInscriptionBuilder::MakeInscriptionScript() const
 {
+    // Up to 3 bytes of a push opcode and size per MAX_PUSH chunk
+    size_t content_size = m_content ? m_content->size() + (m_content->size() / MAX_PUSH + 1) * 3 : 0;
+    size_t metadata_size = m_metadata ? m_metadata->size() + (m_metadata->size() / MAX_PUSH + 1) * 4 : 0;
+
     CScript script;
+    script.reserve(256 + m_content_type.value_or("").size() + content_size + metadata_size);
     script << m_inscribe_script_pk.value_or(xonly_pubkey());
     script << OP_CHECKSIG;
     if (m_type == LAZY_INSCRIPTION) {
@@ -109,8 +166,9 @@ CScript CreateInscriptionBuilder::MakeInscriptionScript() const
     }
 
     if (m_metadata) {
-        for (auto pos = m_metadata->begin(); pos < m_metadata->end(); pos += MAX_PUSH) {
-            script << METADATA_TAG << bytevector(pos, ((pos + MAX_PUSH) < m_metadata->end()) ? (pos + MAX_PUSH) : m_metadata->end());
+        for (size_t pos = 0; pos < m_metadata->size(); pos += MAX_PUSH) {
+            script << METADATA_TAG;
+            PushScriptData(script, std::span(*m_metadata).subspan(pos, std::min(MAX_PUSH, m_metadata->size() - pos)));
         }
     }
 
@@ -125,8 +183,8 @@ CScript CreateInscriptionBuilder::MakeInscriptionScript() const
 
         script << CONTENT_OP_TAG;
 
-        for (auto pos = m_content->begin(); pos < m_content->end(); pos += MAX_PUSH) {
-            script << bytevector(pos, ((pos + MAX_PUSH) < m_content->end()) ? (pos + MAX_PUSH) : m_content->end());
+        for (size_t pos = 0; pos < m_content->size(); pos += MAX_PUSH) {
+            PushScriptData(script, std::span(*m_content).subspan(pos, std::min(MAX_PUSH, m_content->size() - pos)));
         }
     }
 
@@ -136,7 +194,7 @@ CScript CreateInscriptionBuilder::MakeInscriptionScript() const
 }
 
 
-std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> CreateInscriptionBuilder::GenesisTapRoot() const
+std::tuple<xonly_pubkey, uint8_t, l15::bytevector> CreateInscriptionBuilder::GenesisTapRoot() const
 {
     if (!m_inscribe_int_pk) throw ContractStateError(name_inscribe_int_pk + " not defined");
     if (!m_inscribe_script_pk) throw ContractStateError(name_inscribe_script_pk + " not defined");
@@ -145,9 +203,18 @@ std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> CreateInscriptionBuilde
         if (!m_inscribe_script_market_pk) throw ContractStateError(name_inscribe_script_pk + " not defined");
     }
 
-    ScriptMerkleTree tap_tree(TreeBalanceType::WEIGHTED, { MakeInscriptionScript() });
+    const ScriptMerkleTree& tap_tree = GetInscriptionTapTree();
+    auto [taproot_pk, parity] = core::SchnorrKeyPair::AddTapTweak(KeyPair::GetStaticSecp256k1Context(), *m_inscribe_int_pk, tap_tree.CalculateRoot());
 
-    return std::tuple_cat(core::SchnorrKeyPair::AddTapTweak(KeyPair::GetStaticSecp256k1Context(), *m_inscribe_int_pk, tap_tree.CalculateRoot()), std::make_tuple(tap_tree));
+    std::vector<uint256> genesis_scriptpath = tap_tree.CalculateScriptPath(tap_tree.GetScripts().front());
+    bytevector control_block;
+    control_block.reserve(1 + m_inscribe_int_pk->size() + genesis_scriptpath.size() * uint256::size());
+    control_block.emplace_back(static_cast<uint8_t>(0xc0 | parity));
+    control_block.insert(control_block.end(), m_inscribe_int_pk->begin(), m_inscribe_int_pk->end());
+    for (uint256 &branch_hash: genesis_scriptpath)
+        control_block.insert(control_block.end(), branch_hash.begin(), branch_hash.end());
+
+    return {move(taproot_pk), parity, move(control_block)};
 }
 
 std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> CreateInscriptionBuilder::FundMiningFeeTapRoot() const
@@ -169,6 +236,7 @@ void CreateInscriptionBuilder::Collection(std::string collection_id, CAmount amo
     else {
         CheckInscriptionId(collection_id);
         m_parent_collection_id = move(collection_id);
+        ResetInscriptionScript();
     }
 
     if (m_collection_destination) {
@@ -186,6 +254,18 @@ void CreateInscriptionBuilder::OverrideCollectionAddress(std::string addr)
     m_collection_destination = P2Address::Construct(chain(), m_collection_destination->Amount(), move(addr));
 }
 
+void CreateInscriptionBuilder::DataFromFile(std::string content_type, const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) throw ContractTermWrongValue(name_content + " file: " + path);
+
+    bytevector content(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(content.data()), content.size())) throw ContractTermWrongValue(name_content + " file: " + path);
+
+    Data(move(content_type), move(content));
+}
+
 void CreateInscriptionBuilder::MetaData(bytevector cbor)
 {
     auto check_metadata = nlohmann::json::from_cbor(cbor);
@@ -193,12 +273,14 @@ void CreateInscriptionBuilder::MetaData(bytevector cbor)
         throw ContractTermWrongFormat(std::string(name_metadata));
 
     m_metadata = move(cbor);
+    ResetInscriptionScript();
 }
 
 void CreateInscriptionBuilder::Delegate(std::string inscription_id)
 {
     CheckInscriptionId(inscription_id);
     m_delegate = move(inscription_id);
+    ResetInscriptionScript();
 }
 
 std::string CreateInscriptionBuilder::GetInscribeInternalPubKey() const
@@ -227,14 +309,36 @@ void CreateInscriptionBuilder::SignCommit(const KeyRegistry& master_key, const s
     }
 
     CMutableTransaction tx = MakeCommitTx();
+    TxSigningContext ctx(tx, move(spent_outs));
 
+    std::vector<std::shared_ptr<ISigner>> signers = SignerCache(master_key, key_filter).Signers(m_inputs);
+    std::vector<TxInput*> inputs;
+    inputs.reserve(m_inputs.size());
     for (auto& utxo: m_inputs) {
-        auto signer = utxo.output->Destination()->LookupKey(master_key, key_filter);
-        signer->SignInput(utxo, tx, spent_outs, SIGHASH_ALL);
+        inputs.emplace_back(&utxo);
     }
+
+    ForEachInput(inputs.size(), [&](size_t i) { signers[i]->SignInput(*inputs[i], ctx, SIGHASH_ALL); });
+}
+
+void CreateInscriptionBuilder::ResetInscriptionScript()
+{
+    mInscriptionTapTree.reset();
+    mInscriptionTaproot.reset();
+    mFundMiningFeeTaproot.reset();
+    mCommitTx.reset();
+    mGenesisTx.reset();
 }
 
-const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& CreateInscriptionBuilder::GetInscriptionTapRoot() const
+const l15::ScriptMerkleTree& CreateInscriptionBuilder::GetInscriptionTapTree() const
+{
+    if (!mInscriptionTapTree) {
+        mInscriptionTapTree.emplace(ScriptMerkleTree(TreeBalanceType::WEIGHTED, { MakeInscriptionScript() }));
+    }
+    return *mInscriptionTapTree;
+}
+
+const std::tuple<xonly_pubkey, uint8_t, l15::bytevector>& CreateInscriptionBuilder::GetInscriptionTapRoot() const
 {
     if (!mInscriptionTaproot) {
         mInscriptionTaproot.emplace(GenesisTapRoot());
@@ -242,6 +346,14 @@ const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& CreateInscriptio
     return *mInscriptionTaproot;
 }
 
+const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& CreateInscriptionBuilder::GetFundMiningFeeTapRoot() const
+{
+    if (!mFundMiningFeeTaproot) {
+        mFundMiningFeeTaproot.emplace(FundMiningFeeTapRoot());
+    }
+    return *mFundMiningFeeTaproot;
+}
+
 void CreateInscriptionBuilder::SignCollection(const KeyRegistry &master_key, const std::string& key_filter)
 {
     if (!m_inscribe_script_pk) throw ContractStateError(name_inscribe_script_pk + " undefined");
@@ -267,17 +379,17 @@ void CreateInscriptionBuilder::SignInscription(const KeyRegistry &master_key, co
     if (*m_inscribe_script_pk != script_keypair.GetPubKey()) throw ContractTermMismatch(std::string(name_inscribe_script_pk));
 
     CMutableTransaction genesis_tx = MakeGenesisTx(MakeCommitTx());
+    TxSigningContext ctx(genesis_tx, GetGenesisTxSpends());
 
-    m_inscribe_sig = script_keypair.SignTaprootTx(genesis_tx, 0, GetGenesisTxSpends(),
-                                                  get<2>(GetInscriptionTapRoot()).GetScripts().front(),
-                                                  m_type == LAZY_INSCRIPTION ? (SIGHASH_ANYONECANPAY | SIGHASH_SINGLE) : SIGHASH_DEFAULT);
+    m_inscribe_sig = ctx.SignTaproot(script_keypair, 0, GetInscriptionTapTree().GetScripts().front(),
+                                     m_type == LAZY_INSCRIPTION ? (SIGHASH_ANYONECANPAY | SIGHASH_SINGLE) : SIGHASH_DEFAULT);
 
     if (m_parent_collection_id) {
         if (m_type == LAZY_INSCRIPTION)
-            m_fund_mining_fee_sig = script_keypair.SignTaprootTx(genesis_tx, 2, GetGenesisTxSpends(),
-                MakeMultiSigScript(*m_inscribe_script_pk, *m_inscribe_script_market_pk), SIGHASH_ANYONECANPAY | SIGHASH_NONE);
+            m_fund_mining_fee_sig = ctx.SignTaproot(script_keypair, 2, MakeMultiSigScript(*m_inscribe_script_pk, *m_inscribe_script_market_pk),
+                                                    SIGHASH_ANYONECANPAY | SIGHASH_NONE);
         else
-            m_fund_mining_fee_sig = script_keypair.SignTaprootTx(genesis_tx, 2, GetGenesisTxSpends(), {});
+            m_fund_mining_fee_sig = ctx.SignTaproot(script_keypair, 2, {});
     }
 }
 
@@ -293,11 +405,11 @@ void CreateInscriptionBuilder::MarketSignInscription(const KeyRegistry &master_k
     if (*m_inscribe_script_market_pk != script_keypair.GetPubKey()) throw ContractTermMismatch(std::string(name_inscribe_script_market_pk));
 
     CMutableTransaction genesis_tx = MakeGenesisTx(MakeCommitTx());
+    TxSigningContext ctx(genesis_tx, GetGenesisTxSpends());
 
-    m_inscribe_market_sig = script_keypair.SignTaprootTx(genesis_tx, 0, GetGenesisTxSpends(), get<2>(GetInscriptionTapRoot()).GetScripts().front());
+    m_inscribe_market_sig = ctx.SignTaproot(script_keypair, 0, GetInscriptionTapTree().GetScripts().front());
     if (m_parent_collection_id) {
-        m_fund_mining_fee_market_sig = script_keypair.SignTaprootTx(genesis_tx, 2, GetGenesisTxSpends(),
-                MakeMultiSigScript(*m_inscribe_script_pk, *m_inscribe_script_market_pk));
+        m_fund_mining_fee_market_sig = ctx.SignTaproot(script_keypair, 2, MakeMultiSigScript(*m_inscribe_script_pk, *m_inscribe_script_market_pk));
     }
 }
 
@@ -307,8 +419,8 @@ l15::stringvector CreateInscriptionBuilder::RawTransactions() const
         RestoreTransactions();
     }
 
-    std::string funding_tx_hex = EncodeHexTx(*mCommitTx);
-    std::string genesis_tx_hex = EncodeHexTx(*mGenesisTx);
+    std::string funding_tx_hex = SerializeHexTx(*mCommitTx);
+    std::string genesis_tx_hex = SerializeHexTx(*mGenesisTx);
 
     return {move(funding_tx_hex), move(genesis_tx_hex)};
 }
@@ -338,14 +450,14 @@ l15::stringvector CreateInscriptionBuilder::TransactionsPSBT() const
         res.witness_utxo = in;
         return res;
     });
-    auto genTapRoot = GetInscriptionTapRoot();
+    const auto& genTapTree = GetInscriptionTapTree();
     genesisPsbt.inputs.front().m_tap_internal_key = *m_inscribe_int_pk;
-    genesisPsbt.inputs.front().m_tap_merkle_root = get<2>(genTapRoot).CalculateRoot();
-    genesisPsbt.inputs.front().m_tap_scripts.emplace(get<2>(genTapRoot).GetScripts().front(), InscribeScriptControlBlock(genTapRoot));
+    genesisPsbt.inputs.front().m_tap_merkle_root = genTapTree.CalculateRoot();
+    genesisPsbt.inputs.front().m_tap_scripts.emplace(genTapTree.GetScripts().front(), get<2>(GetInscriptionTapRoot()));
     if (m_parent_collection_id) {
         if (m_type == LAZY_INSCRIPTION) {
             genesisPsbt.inputs.front().sighash_type = SIGHASH_ANYONECANPAY | SIGHASH_SINGLE;
-            auto fundFeeTapRoot = FundMiningFeeTapRoot();
+            const auto& fundFeeTapRoot = GetFundMiningFeeTapRoot();
             genesisPsbt.inputs.back().m_tap_internal_key = *m_fund_mining_fee_int_pk;
             genesisPsbt.inputs.back().m_tap_merkle_root = get<2>(fundFeeTapRoot).CalculateRoot();
             genesisPsbt.inputs.back().m_tap_scripts.emplace(get<2>(fundFeeTapRoot).GetScripts().front(), FundMiningFeeControlBlock(fundFeeTapRoot));
@@ -388,23 +500,23 @@ void CreateInscriptionBuilder::ApplyPSBTSignature(const l15::stringvector& psbts
 
     core::PSBT genesisPsbt(base64::decode<bytevector>(psbts.back()));
 
-    auto ordTR = GetInscriptionTapRoot();
+    const auto& ordTapTree = GetInscriptionTapTree();
 
     if (!genesisPsbt.inputs.empty()) {
         const auto& psbtOrdInput = genesisPsbt.inputs.front();
 
         if (psbtOrdInput.m_tap_internal_key != *m_inscribe_int_pk) throw ContractTermMismatch(std::string(name_inscribe_int_pk));
-        if (psbtOrdInput.m_tap_merkle_root != get<2>(ordTR).CalculateRoot()) throw ContractTermMismatch(std::string(name_inscribe_int_pk));
+        if (psbtOrdInput.m_tap_merkle_root != ordTapTree.CalculateRoot()) throw ContractTermMismatch(std::string(name_inscribe_int_pk));
         if (psbtOrdInput.m_tap_script_sigs.empty()) throw ContractTermMissing(std::string(name_inscribe_sig));
         if (psbtOrdInput.m_tap_script_sigs.size() != 1) throw ContractTermWrongValue(name_inscribe_sig + " has more than 1 value");
 
         if (psbtOrdInput.m_tap_scripts.size() != 1 ||
-            psbtOrdInput.m_tap_scripts.begin()->first != get<2>(ordTR).GetScripts().front() ||
-            psbtOrdInput.m_tap_scripts.begin()->second != InscribeScriptControlBlock(ordTR)) {
+            psbtOrdInput.m_tap_scripts.begin()->first != ordTapTree.GetScripts().front() ||
+            psbtOrdInput.m_tap_scripts.begin()->second != get<2>(GetInscriptionTapRoot())) {
             throw ContractTermMismatch("Inscription script");
         }
 
-        uint256 tap_leaf = l15::TapLeafHash(get<2>(ordTR).GetScripts().front());
+        uint256 tap_leaf = l15::TapLeafHash(ordTapTree.GetScripts().front());
 
         auto& [key_n_leaf, sig] = *(psbtOrdInput.m_tap_script_sigs.begin());
         if (get<0>(key_n_leaf) != *m_inscribe_script_pk) throw ContractTermMismatch(std::string(name_inscribe_script_pk));
@@ -424,7 +536,7 @@ void CreateInscriptionBuilder::ApplyPSBTSignature(const l15::stringvector& psbts
         if (genesisPsbt.inputs.size() != 3) throw ContractTermWrongValue("genesis tx inputs: " + std::to_string(genesisPsbt.inputs.size()));
 
         const auto& psbtFeeInput = genesisPsbt.inputs.back();
-        auto fundTR = FundMiningFeeTapRoot();
+        const auto& fundTR = GetFundMiningFeeTapRoot();
 
         if (m_type == INSCRIPTION) {
             throw std::runtime_error("not implemented");
@@ -554,7 +666,10 @@ void CreateInscriptionBuilder::CheckContractTerms(uint32_t version, InscribePhas
     }
 }
 
-UniValue CreateInscriptionBuilder::MakeJson(uint32_t version, InscribePhase phase) const
+UniValue CreateInscriptionBuilder::MakeBinaryJson(uint32_t version, InscribePhase phase, std::vector<std::pair<std::string, std::span<const uint8_t>>>& binary_values) const
+{ return MakeJson(version, phase, &binary_values); }
+
+UniValue CreateInscriptionBuilder::MakeJson(uint32_t version, InscribePhase phase, std::vector<std::pair<std::string, std::span<const uint8_t>>>* binary_values) const
 {
     if (version != s_protocol_version &&
         version != s_protocol_version_no_p2address &&
@@ -574,10 +689,14 @@ UniValue CreateInscriptionBuilder::MakeJson(uint32_t version, InscribePhase phas
         contract.pushKV(name_mining_fee_rate, *m_mining_fee_rate);
         if (m_content_type)
             contract.pushKV(name_content_type, *m_content_type);
-        if (m_content_type)
-            contract.pushKV(name_content, hex(*m_content));
-        if (m_metadata)
-            contract.pushKV(name_metadata, hex(*m_metadata));
+        if (m_content) {
+            if (binary_values) binary_values->emplace_back(name_content, *m_content);
+            else contract.pushKV(name_content, hex(*m_content));
+        }
+        if (m_metadata) {
+            if (binary_values) binary_values->emplace_back(name_metadata, *m_metadata);
+            else contract.pushKV(name_metadata, hex(*m_metadata));
+        }
         {   UniValue utxo_arr(UniValue::VARR);
             for (const auto &input: m_inputs) {
                 UniValue utxo_val = input.MakeJson();
@@ -632,7 +751,7 @@ UniValue CreateInscriptionBuilder::MakeJson(uint32_t version, InscribePhase phas
                 contract.pushKV(name_collection, move(collectionVal));
             }
             else {
-                TxInput fake_collection_input{chain(), 1, std::make_shared<UTXO>(chain(), uint256(0).GetHex(), 0, m_collection_destination)};
+                TxInput fake_collection_input{chain(), 1, MakeContractObject<UTXO>(chain(), uint256(0).GetHex(), 0, m_collection_destination)};
                 UniValue collectionVal = fake_collection_input.MakeJson();
                 collectionVal.pushKV(name_collection_id, *m_parent_collection_id);
                 contract.pushKV(name_collection, move(collectionVal));
@@ -660,6 +779,34 @@ UniValue CreateInscriptionBuilder::MakeJson(uint32_t version, InscribePhase phas
     return contract;
 }
 
+const std::vector<std::string>& CreateInscriptionBuilder::BinaryParams() const
+{
+    static const std::vector<std::string> binary_params = {name_content, name_metadata};
+    return binary_params;
+}
+
+void CreateInscriptionBuilder::ReadBinaryParam(const std::string& name, bytevector&& data)
+{
+    if (name == name_content) {
+        if (m_content) {
+            if (*m_content != data) throw ContractTermMismatch(name_content + " is already set to " + hex(*m_content));
+        }
+        else {
+            m_content = move(data);
+            ResetInscriptionScript();
+        }
+    }
+    else if (name == name_metadata) {
+        if (m_metadata) {
+            if (*m_metadata != data) throw ContractTermMismatch(name_metadata + " is already set to " + hex(*m_metadata));
+        }
+        else {
+            MetaData(move(data));
+        }
+    }
+    else throw ContractStateError("unexpected binary param: " + name);
+}
+
 void CreateInscriptionBuilder::ReadJson(const UniValue &contract, InscribePhase phase)
 {
     if (m_type != INSCRIPTION && m_type != LAZY_INSCRIPTION) throw ContractTermMismatch (std::string(name_contract_type));
@@ -801,7 +948,7 @@ void CreateInscriptionBuilder::ReadJson(const UniValue &contract, InscribePhase
             if (m_rune_stone)
                 m_rune_stone->ReadJson(val, [](){ return name_rune_stone; });
             else
-                m_rune_stone = std::make_shared<RuneStoneDestination>(chain(), val, [](){ return name_rune_stone; });
+                m_rune_stone = MakeContractObject<RuneStoneDestination>(chain(), val, [](){ return name_rune_stone; });
         }
     }
 
@@ -827,6 +974,8 @@ void CreateInscriptionBuilder::ReadJson(const UniValue &contract, InscribePhase
                 m_fixed_change = NoZeroDestinationFactory::ReadJson(chain(), val, [](){ return name_fixed_change; });
         }
     }
+
+    ResetInscriptionScript();
 }
 
 void CreateInscriptionBuilder::RestoreTransactions() const
@@ -850,14 +999,191 @@ const CMutableTransaction& CreateInscriptionBuilder::CommitTx() const
     return *mCommitTx;
 }
 
+size_t CreateInscriptionBuilder::InscriptionScriptSize(InscribeType type, std::optional<size_t> content_type_size, size_t content_size,
+                                                       std::optional<size_t> metadata_size, std::optional<size_t> collection_id_size,
+                                                       std::optional<size_t> delegate_id_size, std::optional<size_t> rune_commit_size)
+{
+    const size_t pk_push_size = PushScriptDataSize(xonly_pubkey().size());
+    const size_t tag_size = PushScriptDataSize(1);
+
+    // <pk> OP_CHECKSIG [<market pk> OP_CHECKSIGADD 2 OP_NUMEQUAL] OP_0 OP_IF "ord" ... OP_ENDIF
+    size_t size = pk_push_size + 1;
+    if (type == LAZY_INSCRIPTION)
+        size += pk_push_size + 3;
+    size += 2 + PushScriptDataSize(ORD_TAG.size()) + 1;
+
+    if (collection_id_size)
+        size += tag_size + PushScriptDataSize(*collection_id_size);
+    if (metadata_size)
+        size += ChunkedScriptDataSize(*metadata_size, tag_size);
+    if (rune_commit_size)
+        size += tag_size + PushScriptDataSize(*rune_commit_size);
+    if (delegate_id_size)
+        size += tag_size + PushScriptDataSize(*delegate_id_size);
+    if (content_type_size)
+        size += tag_size + PushScriptDataSize(*content_type_size) + 1 + ChunkedScriptDataSize(content_size, 0);
+
+    return size;
+}
+
+size_t CreateInscriptionBuilder::InscriptionWitnessSize(InscribeType type, size_t script_size, size_t sig_size, size_t market_sig_size)
+{
+    // Inscription tap tree has the only leaf, so the control block has no script path
+    if (type == LAZY_INSCRIPTION)
+        return TxWeight::WitnessSize({market_sig_size, 65, script_size, TAPROOT_CONTROL_BASE_SIZE});
+    else
+        return TxWeight::WitnessSize({sig_size, script_size, TAPROOT_CONTROL_BASE_SIZE});
+}
+
+CAmount CreateInscriptionBuilder::CollectionAddVSize(InscribeType type)
+{
+    CAmount add_vsize = TAPROOT_KEYSPEND_VIN_VSIZE + TAPROOT_VOUT_VSIZE;
+    if (type == LAZY_INSCRIPTION)
+        add_vsize += TAPROOT_MULTISIG_VIN_VSIZE + 1; // for mining fee compensation input (+1 for sighash flag)
+    else
+        add_vsize += TAPROOT_KEYSPEND_VIN_VSIZE; // for mining fee compensation input
+    return add_vsize;
+}
+
+size_t CreateInscriptionBuilder::InscriptionScriptSize() const
+{
+    return InscriptionScriptSize(m_type,
+                                 m_content ? std::optional<size_t>(m_content_type->size()) : std::nullopt,
+                                 m_content ? m_content->size() : 0,
+                                 m_metadata ? std::optional<size_t>(m_metadata->size()) : std::nullopt,
+                                 m_parent_collection_id ? std::optional<size_t>(SerializeInscriptionId(*m_parent_collection_id).size()) : std::nullopt,
+                                 m_delegate ? std::optional<size_t>(SerializeInscriptionId(*m_delegate).size()) : std::nullopt,
+                                 m_rune_stone ? std::optional<size_t>(m_rune_stone->Commit().size()) : std::nullopt);
+}
+
+size_t CreateInscriptionBuilder::InscriptionWitnessSize() const
+{
+    return InscriptionWitnessSize(m_type, InscriptionScriptSize(),
+                                  m_inscribe_sig ? m_inscribe_sig->size() : signature().size(),
+                                  m_inscribe_market_sig ? m_inscribe_market_sig->size() : signature().size());
+}
+
+TxWeight CreateInscriptionBuilder::GenesisTxTemplateWeight() const
+{
+    TxWeight weight;
+    weight.AddInput(TxWeight::InputSize(0), InscriptionWitnessSize());
+
+    weight.AddOutput(m_ord_destination ? TxWeight::OutputSize(m_ord_destination->PubKeyScript()) : TAPROOT_VOUT_VSIZE);
+    if (m_market_fee->Amount() > 0) {
+        weight.AddOutput(*m_market_fee);
+    }
+    if (m_author_fee && m_author_fee->Amount() > 0) {
+        weight.AddOutput(*m_author_fee);
+    }
+    for (const auto& fee: m_custom_fees) {
+        weight.AddOutput(*fee);
+    }
+    if (m_rune_stone) {
+        weight.AddOutput(*m_rune_stone);
+    }
+    return weight;
+}
+
+TxWeight CreateInscriptionBuilder::GenesisTxWeight() const
+{
+    TxWeight weight = GenesisTxTemplateWeight();
+
+    if (m_parent_collection_id) {
+        if (m_collection_input) {
+            weight.AddInput(CScript(), m_collection_input->witness ? m_collection_input->witness : m_collection_input->output->Destination()->DummyWitness());
+        }
+        else {
+            weight.AddInput(TxWeight::InputSize(0), 0);
+        }
+
+        if (m_type == LAZY_INSCRIPTION) {
+            size_t script_size = MakeMultiSigScript(xonly_pubkey(), xonly_pubkey()).size();
+            weight.AddInput(TxWeight::InputSize(0), TxWeight::WitnessSize({m_fund_mining_fee_market_sig ? m_fund_mining_fee_market_sig->size() : signature().size(), 65, script_size, TAPROOT_CONTROL_BASE_SIZE}));
+        }
+        else {
+            weight.AddInput(TxWeight::InputSize(0), TxWeight::WitnessSize({m_fund_mining_fee_sig ? m_fund_mining_fee_sig->size() : signature().size()}));
+        }
+
+        weight.AddOutput(*m_collection_destination);
+    }
+    return weight;
+}
+
+CAmount CreateInscriptionBuilder::GenesisTxFunds() const
+{
+    CAmount genesis_funds = GenesisTxTemplateWeight().Fee(*m_mining_fee_rate) + m_market_fee->Amount();
+    if (m_author_fee)
+        genesis_funds += m_author_fee->Amount();
+
+    for (const auto& fee: m_custom_fees)
+        genesis_funds += fee->Amount();
+
+    if (m_rune_stone)
+        genesis_funds += m_rune_stone->Amount();
+
+    if (m_parent_collection_id)
+        genesis_funds += CFeeRate(*m_mining_fee_rate).GetFee(CollectionAddVSize(m_type));
+
+    return genesis_funds;
+}
+
+std::tuple<TxWeight, CAmount> CreateInscriptionBuilder::CommitTxInputs() const
+{
+    TxWeight weight;
+    CAmount funds = 0;
+    for (const auto& input: m_inputs) {
+        weight.AddInput(input);
+        funds += input.output->Destination()->Amount();
+    }
+    return {weight, funds};
+}
+
+CreateInscriptionBuilder::CommitTxSolution CreateInscriptionBuilder::SolveCommitTx(TxWeight weight, CAmount funds) const
+{
+    CommitTxSolution res;
+    res.genesis_funds = GenesisTxFunds();
+
+    CAmount payout = m_ord_destination->Amount() + res.genesis_funds;
+    weight.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (m_parent_collection_id) {
+        weight.AddOutput(TAPROOT_VOUT_VSIZE);
+    }
+    if (m_fixed_change) {
+        weight.AddOutput(*m_fixed_change);
+        payout += m_fixed_change->Amount();
+    }
+
+    res.commit_fee = weight.Fee(*m_mining_fee_rate);
+
+    if (m_change_addr) {
+        auto change = P2Address::Construct(chain(), {}, *m_change_addr);
+        weight.AddOutput(*change);
+        CAmount change_fee = weight.Fee(*m_mining_fee_rate);
+        CAmount change_amount = funds - payout - change_fee;
+
+        if (change_amount >= DustThreshold(change->PubKeyScript())) {
+            change->Amount(change_amount);
+            res.change = move(change);
+            res.commit_fee = change_fee;
+        }
+        else {
+            // If less than dust then spend all the excessive funds to inscription, or collection, or add to "fixed" change
+            res.excess = funds - payout - res.commit_fee;
+        }
+    }
+    return res;
+}
+
 CMutableTransaction CreateInscriptionBuilder::MakeCommitTx() const
 {
+    auto [weight, total_funds] = CommitTxInputs();
+    CommitTxSolution solution = SolveCommitTx(move(weight), total_funds);
+
     CMutableTransaction tx;
 
-    CAmount total_funds = 0;
     tx.vin.reserve(m_inputs.size());
     for(const auto& input: m_inputs) {
-        tx.vin.emplace_back(Txid::FromUint256(uint256S(input.output->TxID())), input.output->NOut(), input.scriptSig);
+        tx.vin.emplace_back(input.output->OutPoint(), input.scriptSig);
         tx.vin.back().scriptWitness.stack = input.witness;
         if (tx.vin.back().scriptWitness.stack.empty()) {
             tx.vin.back().scriptWitness.stack = input.output->Destination()->DummyWitness();
@@ -865,58 +1191,31 @@ CMutableTransaction CreateInscriptionBuilder::MakeCommitTx() const
         if (tx.vin.back().scriptSig.empty()) {
             tx.vin.back().scriptSig = input.output->Destination()->DummyScriptSig();
         }
-        total_funds += input.output->Destination()->Amount();
     }
 
-    tx.vout.emplace_back(m_ord_destination->Amount(), CScript() << 1 << get<0>(GenesisTapRoot()));
-    CAmount genesis_sum_fee = CalculateTxFee(*m_mining_fee_rate, CreateGenesisTxTemplate()) + m_market_fee->Amount();
-    if (m_author_fee)
-        genesis_sum_fee += m_author_fee->Amount();
-
-    for (const auto& fee: m_custom_fees)
-       genesis_sum_fee += fee->Amount();
-
-    if (m_rune_stone)
-        genesis_sum_fee += m_rune_stone->Amount();
+    tx.vout.emplace_back(m_ord_destination->Amount(), CScript() << 1 << get<0>(GetInscriptionTapRoot()));
 
     if (m_parent_collection_id) {
-        CAmount add_vsize = TAPROOT_KEYSPEND_VIN_VSIZE + TAPROOT_VOUT_VSIZE;
         if (m_type == LAZY_INSCRIPTION) {
-            add_vsize += TAPROOT_MULTISIG_VIN_VSIZE + 1; // for mining fee compensation input (+1 for sighash flag)
-            genesis_sum_fee += CFeeRate(*m_mining_fee_rate).GetFee(add_vsize);
-            tx.vout.emplace_back(genesis_sum_fee, CScript() << 1 << get<0>(FundMiningFeeTapRoot()));
+            tx.vout.emplace_back(solution.genesis_funds, CScript() << 1 << get<0>(GetFundMiningFeeTapRoot()));
         }
         else {
-            add_vsize += TAPROOT_KEYSPEND_VIN_VSIZE; // for mining fee compensation input
-            genesis_sum_fee += CFeeRate(*m_mining_fee_rate).GetFee(add_vsize);
-
-            tx.vout.emplace_back(genesis_sum_fee, CScript() << 1 << m_inscribe_script_pk.value_or(xonly_pubkey()));
+            tx.vout.emplace_back(solution.genesis_funds, CScript() << 1 << m_inscribe_script_pk.value_or(xonly_pubkey()));
         }
     }
     else {
-        tx.vout.back().nValue += genesis_sum_fee;
+        tx.vout.back().nValue += solution.genesis_funds;
     }
 
-    CAmount fixed_change_amount = 0;
     if (m_fixed_change) {
-        fixed_change_amount = m_fixed_change->Amount();
         tx.vout.emplace_back(m_fixed_change->TxOutput());
     }
 
-    if (m_change_addr) {
-        try {
-            auto changeDest = P2Address::Construct(chain(), {}, *m_change_addr);
-            tx.vout.emplace_back(changeDest->TxOutput());
-            CAmount change_amount = total_funds - m_ord_destination->Amount() - fixed_change_amount - genesis_sum_fee - CalculateTxFee(*m_mining_fee_rate, tx);
-            changeDest->Amount(change_amount);
-            tx.vout.back().nValue = changeDest->Amount();
-        }
-        catch (const ContractTermWrongValue &) {
-            // If less than dust then spend all the excessive funds to inscription, or collection, or add to "fixed" change
-            tx.vout.pop_back();
-            CAmount mining_fee = CalculateTxFee(*m_mining_fee_rate, tx);
-            tx.vout.back().nValue += total_funds - m_ord_destination->Amount() - fixed_change_amount - genesis_sum_fee - mining_fee;
-        }
+    if (solution.change) {
+        tx.vout.emplace_back(solution.change->TxOutput());
+    }
+    else {
+        tx.vout.back().nValue += solution.excess;
     }
 
     return tx;
@@ -955,18 +1254,6 @@ std::vector<CTxOut> CreateInscriptionBuilder::GetGenesisTxSpends() const
     return spending_outs;
 }
 
-l15::bytevector CreateInscriptionBuilder::InscribeScriptControlBlock(const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& tr) const
-{
-    std::vector<uint256> genesis_scriptpath = get<2>(tr).CalculateScriptPath(get<2>(tr).GetScripts().front());
-    bytevector control_block;
-    control_block.reserve(1 + m_inscribe_int_pk->size() + genesis_scriptpath.size() * uint256::size());
-    control_block.emplace_back(static_cast<uint8_t>(0xc0 | get<1>(tr)));
-    control_block.insert(control_block.end(), m_inscribe_int_pk->begin(), m_inscribe_int_pk->end());
-    for (uint256 &branch_hash: genesis_scriptpath)
-        control_block.insert(control_block.end(), branch_hash.begin(), branch_hash.end());
-    return control_block;
-}
-
 l15::bytevector CreateInscriptionBuilder::FundMiningFeeControlBlock(const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& tr) const
 {
     std::vector<uint256> scriptpath = get<2>(tr).CalculateScriptPath(get<2>(tr).GetScripts().front());
@@ -987,6 +1274,7 @@ CMutableTransaction CreateInscriptionBuilder::MakeGenesisTx(const CMutableTransa
     tx.vin.emplace_back(commit_tx.GetHash(), 0);
     tx.vout.emplace_back(m_ord_destination->Amount(), m_ord_destination->PubKeyScript());
 
+    const auto &tap_tree = GetInscriptionTapTree();
     const auto &tr = GetInscriptionTapRoot();
 
     if (m_type == LAZY_INSCRIPTION) {
@@ -997,12 +1285,12 @@ CMutableTransaction CreateInscriptionBuilder::MakeGenesisTx(const CMutableTransa
     else {
         tx.vin.front().scriptWitness.stack.emplace_back(m_inscribe_sig.value_or(signature()));
     }
-    tx.vin.front().scriptWitness.stack.emplace_back(get<2>(tr).GetScripts().front().begin(), get<2>(tr).GetScripts().front().end());
-    tx.vin.front().scriptWitness.stack.emplace_back(InscribeScriptControlBlock(tr));
+    tx.vin.front().scriptWitness.stack.emplace_back(tap_tree.GetScripts().front().begin(), tap_tree.GetScripts().front().end());
+    tx.vin.front().scriptWitness.stack.emplace_back(get<2>(tr));
 
     if (m_parent_collection_id) {
         if (m_collection_input) {
-            tx.vin.emplace_back(Txid::FromUint256(uint256S(m_collection_input->output->TxID())), m_collection_input->output->NOut());
+            tx.vin.emplace_back(m_collection_input->output->OutPoint());
             tx.vin.back().scriptWitness.stack = m_collection_input->witness ? m_collection_input->witness : m_collection_input->output->Destination()->DummyWitness();
         }
         else {
@@ -1013,7 +1301,7 @@ CMutableTransaction CreateInscriptionBuilder::MakeGenesisTx(const CMutableTransa
         tx.vout.emplace_back(m_collection_destination->TxOutput());
 
         if (m_type == LAZY_INSCRIPTION) {
-            auto tr = FundMiningFeeTapRoot();
+            const auto& tr = GetFundMiningFeeTapRoot();
             tx.vin.back().scriptWitness.stack.emplace_back(m_fund_mining_fee_market_sig.value_or(signature()));
             tx.vin.back().scriptWitness.stack.emplace_back(m_fund_mining_fee_sig.value_or(signature()));
             tx.vin.back().scriptWitness.stack.back().resize(65);
@@ -1052,55 +1340,6 @@ CMutableTransaction CreateInscriptionBuilder::MakeGenesisTx(const CMutableTransa
     return tx;
 }
 
-CMutableTransaction CreateInscriptionBuilder::CreateGenesisTxTemplate() const
-{
-    CMutableTransaction tx;
-
-    tx.vin = {{Txid(), 0}};
-
-    ScriptMerkleTree genesis_tap_tree(TreeBalanceType::WEIGHTED, { MakeInscriptionScript() });
-    uint256 root = genesis_tap_tree.CalculateRoot();
-
-    xonly_pubkey emptyKey;
-
-    std::vector<uint256> genesis_scriptpath = genesis_tap_tree.CalculateScriptPath(genesis_tap_tree.GetScripts().front());
-    bytevector control_block;
-    control_block.reserve(1 + emptyKey.size() + genesis_scriptpath.size() * uint256::size());
-    control_block.emplace_back(static_cast<uint8_t>(0xc0));
-    control_block.insert(control_block.end(), emptyKey.begin(), emptyKey.end());
-
-    for(uint256 &branch_hash : genesis_scriptpath)
-        control_block.insert(control_block.end(), branch_hash.begin(), branch_hash.end());
-
-    if (m_type == LAZY_INSCRIPTION) {
-        tx.vin.front().scriptWitness.stack.emplace_back(m_inscribe_market_sig.value_or(signature()));
-        tx.vin.front().scriptWitness.stack.emplace_back(m_inscribe_sig.value_or(signature()));
-        tx.vin.front().scriptWitness.stack.back().resize(65);
-    }
-    else {
-        tx.vin.front().scriptWitness.stack.emplace_back(m_inscribe_sig.value_or(signature()));
-    }
-    tx.vin.front().scriptWitness.stack.emplace_back(genesis_tap_tree.GetScripts().front().begin(), genesis_tap_tree.GetScripts().front().end());
-    tx.vin.front().scriptWitness.stack.emplace_back(move(control_block));
-
-    tx.vout.emplace_back(0, m_ord_destination ? m_ord_destination->PubKeyScript() : (CScript() << 1 << emptyKey));
-    if (m_market_fee->Amount() > 0) {
-        tx.vout.emplace_back(m_market_fee->TxOutput());
-    }
-    if (m_author_fee && m_author_fee->Amount() > 0) {
-        tx.vout.emplace_back(m_author_fee->TxOutput());
-    }
-    for (const auto& fee: m_custom_fees) {
-        tx.vout.emplace_back(fee->TxOutput());
-    }
-    if (m_rune_stone) {
-        tx.vout.emplace_back(m_rune_stone->TxOutput());
-    }
-
-    return tx;
-}
-
-
 std::string CreateInscriptionBuilder::MakeInscriptionId() const
 {
     return MakeGenesisTx(MakeCommitTx()).GetHash().GetHex() + "i0";
@@ -1108,10 +1347,14 @@ std::string CreateInscriptionBuilder::MakeInscriptionId() const
 
 CAmount CreateInscriptionBuilder::CalculateMissingAmount(std::string address)
 {
-    CAmount funds = 0;
-    funds = std::accumulate(m_inputs.begin(), m_inputs.end(), funds, [](CAmount prev, const auto& input) { return prev + input.output->Amount(); });
+    if (!m_mining_fee_rate) throw ContractTermMissing(std::string(name_mining_fee_rate));
+    if (!m_ord_destination) throw ContractTermMissing(std::string(name_ord));
+    if (!m_market_fee) throw ContractTermMissing(std::string(name_market_fee));
+
+    auto [weight, funds] = CommitTxInputs();
 
-    CAmount mining_fee = CalculateMiningFeeAmount();
+    CommitTxSolution solution = SolveCommitTx(weight, funds);
+    CAmount mining_fee = solution.commit_fee + GenesisTxWeight().Fee(*m_mining_fee_rate);
     CAmount required_amount = mining_fee + m_ord_destination->Amount();
 
     // Do not need to take collection input/output amounts into this acccounting
@@ -1139,10 +1382,10 @@ CAmount CreateInscriptionBuilder::CalculateMissingAmount(std::string address)
         if (address.empty())
             return required_amount - funds;
 
+        // Additional input is solved the same way as if it were added with the default amount of its address type
         auto add_source = P2Address::Construct(chain(), {}, address);
-        AddInput(std::make_shared<UTXO>(chain(), uint256::ZERO.GetHex(), 0, add_source));
-        required_amount += CalculateMiningFeeAmount() - mining_fee;
-        m_inputs.pop_back();
+        weight.AddInput(add_source->DummyScriptSig(), add_source->DummyWitness());
+        required_amount += SolveCommitTx(move(weight), funds + add_source->Amount()).commit_fee - solution.commit_fee;
 
         return std::max(required_amount - funds, add_source->Amount());
     }
@@ -1159,14 +1402,64 @@ CAmount CreateInscriptionBuilder::CalculateMiningFeeAmount() const
     if (!m_parent_collection_id && m_collection_input) throw ContractTermMissing(std::string(name_collection_id));
     //if (!m_collection_input && m_parent_collection_id) throw ContractTermMissing(std::string(name_collection));
 
-    CMutableTransaction commitTx = MakeCommitTx();
-    CAmount commit_fee = CalculateTxFee(*m_mining_fee_rate, commitTx);
-    CAmount genesis_fee = CalculateTxFee(*m_mining_fee_rate, MakeGenesisTx(commitTx));
+    auto [weight, funds] = CommitTxInputs();
+    CAmount commit_fee = SolveCommitTx(move(weight), funds).commit_fee;
+    CAmount genesis_fee = GenesisTxWeight().Fee(*m_mining_fee_rate);
 
     return commit_fee + genesis_fee;
 }
 
 
+InscriptionQuote CreateInscriptionBuilder::Quote(const InscriptionQuoteParams& params, const std::vector<CAmount>& fee_rates)
+{
+    const size_t sig_size = signature().size();
+    const size_t inscription_id_size = uint256::size();
+
+    bool content = params.content_type_size || params.content_size;
+    size_t script_size = InscriptionScriptSize(params.type,
+                                               content ? std::optional<size_t>(params.content_type_size) : std::nullopt,
+                                               params.content_size,
+                                               params.metadata_size ? std::optional<size_t>(params.metadata_size) : std::nullopt,
+                                               params.collection ? std::optional<size_t>(inscription_id_size) : std::nullopt,
+                                               params.delegate ? std::optional<size_t>(inscription_id_size) : std::nullopt,
+                                               params.rune ? std::optional<size_t>(16) : std::nullopt); // 128 bit rune name
+
+    TxWeight genesis;
+    genesis.AddInput(TxWeight::InputSize(0), InscriptionWitnessSize(params.type, script_size, sig_size, sig_size));
+    genesis.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (params.market_fee > 0) genesis.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (params.author_fee > 0) genesis.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (params.rune) genesis.AddOutput(TxWeight::OutputSize(2 + PushScriptDataSize(RUNESTONE_MAX_SIZE))); // OP_RETURN OP_13 <rune stone>
+
+    // Same dummy scriptSig and witness sizes as the funding destinations provide
+    TxWeight commit;
+    for (uint32_t i = 0; i < params.p2tr_inputs; ++i)
+        commit.AddInput(TxWeight::InputSize(0), TxWeight::WitnessSize({sig_size}));
+    for (uint32_t i = 0; i < params.p2wpkh_inputs; ++i)
+        commit.AddInput(TxWeight::InputSize(0), TxWeight::WitnessSize({72, 33}));
+    for (uint32_t i = 0; i < params.p2sh_p2wpkh_inputs; ++i)
+        commit.AddInput(TxWeight::InputSize(PushScriptDataSize(22)), TxWeight::WitnessSize({72, 33}));
+    for (uint32_t i = 0; i < params.p2pkh_inputs; ++i)
+        commit.AddInput(TxWeight::InputSize(PushScriptDataSize(sig_size) + PushScriptDataSize(33)), 0);
+
+    commit.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (params.collection) commit.AddOutput(TAPROOT_VOUT_VSIZE);
+    if (params.change) commit.AddOutput(TAPROOT_VOUT_VSIZE);
+
+    CAmount collection_add_vsize = params.collection ? CollectionAddVSize(params.type) : 0;
+    CAmount payout = params.ord_amount + params.market_fee + params.author_fee;
+
+    InscriptionQuote res;
+    res.commit_vsize = commit.VSize();
+    res.genesis_vsize = genesis.VSize() + collection_add_vsize;
+    res.total_cost.reserve(fee_rates.size());
+    for (CAmount fee_rate: fee_rates) {
+        // Genesis fee is rounded the same way the commit tx locks it, see GenesisTxFunds()
+        res.total_cost.push_back(commit.Fee(fee_rate) + genesis.Fee(fee_rate) + CFeeRate(fee_rate).GetFee(collection_add_vsize) + payout);
+    }
+    return res;
+}
+
 CAmount CreateInscriptionBuilder::GetMinFundingAmount(const std::string& params) const {
     if(!m_ord_destination) throw ContractStateError(std::string(name_ord_amount));
     if(!m_market_fee) throw ContractTermMissing(std::string(name_market_fee));
@@ -1185,7 +1478,7 @@ CAmount CreateInscriptionBuilder::GetMinFundingAmount(const std::string& params)
 
 std::string CreateInscriptionBuilder::GetGenesisTxMiningFee() const
 {
-    CAmount fee = CalculateTxFee(*m_mining_fee_rate, CreateGenesisTxTemplate());
+    CAmount fee = GenesisTxTemplateWeight().Fee(*m_mining_fee_rate);
     if (m_parent_collection_id) fee += CFeeRate(*m_mining_fee_rate).GetFee(TAPROOT_KEYSPEND_VIN_VSIZE*2 + TAPROOT_VOUT_VSIZE);
     return FormatAmount(fee);
 }
@@ -1196,17 +1489,18 @@ CAmount CreateInscriptionBuilder::CalculateWholeFee(const std::string& params) c
 
     bool change = false, collection = false, p2wpkh_utxo = false;
 
-    std::istringstream ss(params);
-    std::string param;
-    while(std::getline(ss, param, ',')) {
+    for (std::string_view opts = params; !opts.empty(); ) {
+        size_t pos = opts.find(',');
+        std::string_view param = opts.substr(0, pos);
+        opts.remove_prefix(pos == std::string_view::npos ? opts.size() : pos + 1);
+
         if (param == FEE_OPT_HAS_CHANGE) { change = true; continue; }
         if (param == FEE_OPT_HAS_COLLECTION) { collection = true; continue; }
         if (param == FEE_OPT_HAS_P2WPKH_INPUT) { p2wpkh_utxo = true; continue; }
-        throw IllegalArgument(move(param));
+        throw IllegalArgument(std::string(param));
     }
 
-    CMutableTransaction genesisTxTpl = CreateGenesisTxTemplate();
-    CAmount genesis_fee = CalculateTxFee(*m_mining_fee_rate, genesisTxTpl);
+    CAmount genesis_fee = GenesisTxTemplateWeight().Fee(*m_mining_fee_rate);
 
     CAmount genesis_vsize_add = 0;
     if (collection && !m_parent_collection_id) genesis_vsize_add += COLLECTION_SCRIPT_ADD_VSIZE;
@@ -1233,13 +1527,13 @@ CAmount CreateInscriptionBuilder::CalculateWholeFee(const std::string& params) c
 
 std::shared_ptr<IContractOutput> CreateInscriptionBuilder::InscriptionOutput() const
 {
-    return std::make_shared<UTXO>(chain(), GenesisTx().GetHash().GetHex(), 0, m_ord_destination);
+    return MakeContractObject<UTXO>(chain(), GenesisTx().GetHash().GetHex(), 0, m_ord_destination);
 }
 
 std::shared_ptr<IContractOutput> CreateInscriptionBuilder::CollectionOutput() const
 {
     if (m_collection_destination) {
-        return std::make_shared<UTXO>(chain(), GenesisTx().GetHash().GetHex(), 1, m_collection_destination);
+        return MakeContractObject<UTXO>(chain(), GenesisTx().GetHash().GetHex(), 1, m_collection_destination);
     }
     else
         return {};
@@ -1252,17 +1546,17 @@ std::shared_ptr<IContractOutput> CreateInscriptionBuilder::ChangeOutput() const
         CMutableTransaction commitTx = CommitTx();
         if (m_parent_collection_id && m_fixed_change) {
             if (commitTx.vout.size() == 4) {
-                res = std::make_shared<UTXO>(chain(), commitTx.GetHash().GetHex(), 3, commitTx.vout[3].nValue, *m_change_addr);
+                res = MakeContractObject<UTXO>(chain(), commitTx.GetHash().GetHex(), 3, commitTx.vout[3].nValue, *m_change_addr);
             }
         }
         if (m_parent_collection_id || m_fixed_change) {
             if (commitTx.vout.size() == 3) {
-                res = std::make_shared<UTXO>(chain(), commitTx.GetHash().GetHex(), 2, commitTx.vout[2].nValue, *m_change_addr);
+                res = MakeContractObject<UTXO>(chain(), commitTx.GetHash().GetHex(), 2, commitTx.vout[2].nValue, *m_change_addr);
             }
         }
         else {
             if (commitTx.vout.size() == 2) {
-                res = std::make_shared<UTXO>(chain(), commitTx.GetHash().GetHex(), 1, commitTx.vout[1].nValue, *m_change_addr);
+                res = MakeContractObject<UTXO>(chain(), commitTx.GetHash().GetHex(), 1, commitTx.vout[1].nValue, *m_change_addr);
             }
         }
     }
@@ -1272,7 +1566,7 @@ std::shared_ptr<IContractOutput> CreateInscriptionBuilder::ChangeOutput() const
 std::shared_ptr<IContractOutput> CreateInscriptionBuilder::FixedChangeOutput() const
 {
     if (m_fixed_change) {
-        return std::make_shared<UTXO>(chain(), MakeCommitTx().GetHash().GetHex(), m_parent_collection_id ? 2 : 1, m_fixed_change);
+        return MakeContractObject<UTXO>(chain(), MakeCommitTx().GetHash().GetHex(), m_parent_collection_id ? 2 : 1, m_fixed_change);
     }
     else
         return {};
@@ -1281,10 +1575,10 @@ std::shared_ptr<IContractOutput> CreateInscriptionBuilder::FixedChangeOutput() c
 std::string CreateInscriptionBuilder::RawTransaction(InscribePhase phase, uint32_t n) const
 {
     if (n == 0) {
-        return EncodeHexTx(MakeCommitTx());
+        return SerializeHexTx(MakeCommitTx());
     }
     else if (n == 1) {
-        return EncodeHexTx(MakeGenesisTx(MakeCommitTx()));
+        return SerializeHexTx(MakeGenesisTx(MakeCommitTx()));
     }
     else return {};
 }
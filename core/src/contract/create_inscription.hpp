@@ -19,6 +19,37 @@ class RuneStoneDestination;
 enum InscribeType { INSCRIPTION, LAZY_INSCRIPTION };
 enum InscribePhase { MARKET_TERMS, LAZY_INSCRIPTION_MARKET_TERMS, LAZY_INSCRIPTION_SIGNATURE, INSCRIPTION_SIGNATURE };
 
+// Inscription terms given by sizes and flags only, so a price can be quoted w/o keys, addresses and inputs.
+// Collection and delegate ids are assumed to point to the first inscription of a transaction (i.e. i0),
+// a rune is quoted for the largest rune stone and rune name commitment, all the outputs are taproot ones.
+struct InscriptionQuoteParams
+{
+    InscribeType type = INSCRIPTION;
+    size_t content_type_size = 0;
+    size_t content_size = 0; // No content is inscribed when both content type and content sizes are zero
+    size_t metadata_size = 0;
+    bool delegate = false;
+    bool collection = false;
+    bool rune = false;
+
+    uint32_t p2tr_inputs = 1;
+    uint32_t p2wpkh_inputs = 0;
+    uint32_t p2sh_p2wpkh_inputs = 0;
+    uint32_t p2pkh_inputs = 0;
+    bool change = true;
+
+    CAmount ord_amount = 546;
+    CAmount market_fee = 0;
+    CAmount author_fee = 0;
+};
+
+struct InscriptionQuote
+{
+    int64_t commit_vsize = 0;
+    int64_t genesis_vsize = 0; // Includes collection input, output and mining fee compensation input as paid with the commit tx
+    std::vector<CAmount> total_cost; // Funding amount required at every quoted mining fee rate
+};
+
 class CreateInscriptionBuilder: public utxord::ContractBuilder<utxord::InscribePhase>
 {
     static const CAmount COLLECTION_SCRIPT_ADD_VSIZE = 18;
@@ -61,30 +92,62 @@ class CreateInscriptionBuilder: public utxord::ContractBuilder<utxord::InscribeP
     std::optional<xonly_pubkey> m_inscribe_int_pk; //taproot
     std::optional<xonly_pubkey> m_fund_mining_fee_int_pk; //taproot
 
-    mutable std::optional<std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>> mInscriptionTaproot;
+    // Inscription script holds the whole content, so its tap tree and taproot are built once and reset by the setters they depend on
+    mutable std::optional<l15::ScriptMerkleTree> mInscriptionTapTree;
+    mutable std::optional<std::tuple<xonly_pubkey, uint8_t, l15::bytevector>> mInscriptionTaproot; // output key, parity, control block
+    mutable std::optional<std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>> mFundMiningFeeTaproot;
     mutable std::optional<CMutableTransaction> mCommitTx;
     mutable std::optional<CMutableTransaction> mGenesisTx;
 
+    // Commit tx amounts solved from the transaction weights w/o building the transactions
+    struct CommitTxSolution
+    {
+        CAmount genesis_funds = 0; // Genesis tx mining fee and payouts locked in the commit tx outputs
+        CAmount commit_fee = 0;
+        std::shared_ptr<IContractDestination> change; // Absent when there is no change address or the change is dust
+        CAmount excess = 0; // Funds added to the last commit tx output instead of the dust change
+    };
+
 private:
     void CheckContractTerms(uint32_t version, InscribePhase phase) const override;
+    const std::vector<std::string>& BinaryParams() const override;
+    void ReadBinaryParam(const std::string& name, bytevector&& data) override;
+    UniValue MakeBinaryJson(uint32_t version, InscribePhase phase, std::vector<std::pair<std::string, std::span<const uint8_t>>>& binary_values) const override;
+    UniValue MakeJson(uint32_t version, InscribePhase phase, std::vector<std::pair<std::string, std::span<const uint8_t>>>* binary_values) const;
 
     void RestoreTransactions() const;
 
-    const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& GetInscriptionTapRoot() const;
+    void ResetInscriptionScript();
+
+    const l15::ScriptMerkleTree& GetInscriptionTapTree() const;
+    const std::tuple<xonly_pubkey, uint8_t, l15::bytevector>& GetInscriptionTapRoot() const;
+    const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree>& GetFundMiningFeeTapRoot() const;
 public:
     std::vector<CTxOut> GetGenesisTxSpends() const;
 private:
     CScript MakeInscriptionScript() const;
 
-    l15::bytevector InscribeScriptControlBlock(const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> &tr) const;
     l15::bytevector FundMiningFeeControlBlock(const std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> &tr) const;
-    std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> GenesisTapRoot() const;
+    std::tuple<xonly_pubkey, uint8_t, l15::bytevector> GenesisTapRoot() const;
     std::tuple<xonly_pubkey, uint8_t, l15::ScriptMerkleTree> FundMiningFeeTapRoot() const;
 
     CMutableTransaction MakeCommitTx() const;
     CMutableTransaction MakeGenesisTx(const CMutableTransaction& commit_tx) const;
 
-    CMutableTransaction CreateGenesisTxTemplate() const;
+    // Sizes of the optional envelope parts are passed only when the part is present
+    static size_t InscriptionScriptSize(InscribeType type, std::optional<size_t> content_type_size, size_t content_size,
+                                        std::optional<size_t> metadata_size, std::optional<size_t> collection_id_size,
+                                        std::optional<size_t> delegate_id_size, std::optional<size_t> rune_commit_size);
+    static size_t InscriptionWitnessSize(InscribeType type, size_t script_size, size_t sig_size, size_t market_sig_size);
+    static CAmount CollectionAddVSize(InscribeType type);
+
+    size_t InscriptionScriptSize() const;
+    size_t InscriptionWitnessSize() const;
+    TxWeight GenesisTxTemplateWeight() const;
+    TxWeight GenesisTxWeight() const;
+    CAmount GenesisTxFunds() const;
+    std::tuple<TxWeight, CAmount> CommitTxInputs() const;
+    CommitTxSolution SolveCommitTx(TxWeight weight, CAmount funds) const;
 
     const CMutableTransaction& CommitTx() const;
     const CMutableTransaction& GenesisTx() const;
@@ -125,13 +188,14 @@ public:
 
     const std::string& GetContractName() const override;
     uint32_t GetVersion() const override { return s_protocol_version; }
-    UniValue MakeJson(uint32_t version, InscribePhase phase) const override;
+    UniValue MakeJson(uint32_t version, InscribePhase phase) const override
+    { return MakeJson(version, phase, nullptr); }
     void ReadJson(const UniValue& json, InscribePhase phase) override;
 
     static const char* SupportedVersions() { return s_versions; }
 
     std::string GetContentType() const { return m_content_type.value_or(""); }
-    std::string GetContent() const { return m_content ? l15::hex(m_content.value()) : std::string(); }
+    std::string GetContent() const { return m_content ? l15::hex(*m_content) : std::string(); }
     std::string GetInscribeAddress() const { return m_ord_destination->Address(); }
 
     void OrdOutput(CAmount amount, std::string addr)
@@ -141,10 +205,10 @@ public:
     { m_ord_destination = move(destination); }
 
     void AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr)
-    { m_inputs.emplace_back(chain(), m_inputs.size(), std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr))); }
+    { m_inputs.emplace_back(chain(), m_inputs.size(), MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr))); }
 
     void AddLegacyUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr, compressed_pubkey pk)
-    { m_inputs.emplace_back(chain(), m_inputs.size(), std::make_shared<UTXO>(chain(), txid, nout, P2Legacy::Construct(chain(), amount, addr, pk))); }
+    { m_inputs.emplace_back(chain(), m_inputs.size(), MakeContractObject<UTXO>(chain(), txid, nout, P2Legacy::Construct(chain(), amount, addr, pk))); }
 
     void AddInput(std::shared_ptr<IContractOutput> prevout)
     { m_inputs.emplace_back(chain(), m_inputs.size(), move(prevout)); }
@@ -160,23 +224,42 @@ public:
     {
         m_content_type = move(content_type);
         m_content = move(data);
+        ResetInscriptionScript();
     }
+
+    // Reads the content straight into the builder w/o intermediate copies
+    void DataFromFile(std::string content_type, const std::string& path);
     void Delegate(std::string inscription_id);
     void MetaData(bytevector metadata);
     void Rune(std::shared_ptr<RuneStoneDestination> runeStone)
-    { m_rune_stone = move(runeStone); }
+    {
+        m_rune_stone = move(runeStone);
+        ResetInscriptionScript();
+    }
 
     void InscribeScriptPubKey(xonly_pubkey pk)
-    { m_inscribe_script_pk = move(pk); }
+    {
+        m_inscribe_script_pk = move(pk);
+        ResetInscriptionScript();
+    }
 
     void MarketInscribeScriptPubKey(xonly_pubkey pk)
-    { m_inscribe_script_market_pk = move(pk); }
+    {
+        m_inscribe_script_market_pk = move(pk);
+        ResetInscriptionScript();
+    }
 
     void InscribeInternalPubKey(xonly_pubkey pk)
-    { m_inscribe_int_pk = move(pk); }
+    {
+        m_inscribe_int_pk = move(pk);
+        ResetInscriptionScript();
+    }
 
     void FundMiningFeeInternalPubKey(xonly_pubkey pk)
-    { m_fund_mining_fee_int_pk = move(pk); }
+    {
+        m_fund_mining_fee_int_pk = move(pk);
+        ResetInscriptionScript();
+    }
 
     void AuthorFee(CAmount amount, std::string addr)
     {
@@ -184,7 +267,7 @@ public:
             m_author_fee = P2Address::Construct(chain(), amount, move(addr));
         }
         else {
-            m_author_fee = std::make_shared<ZeroDestination>();
+            m_author_fee = MakeContractObject<ZeroDestination>();
         }
     }
 
@@ -198,7 +281,7 @@ public:
     }
 
     void AddCollectionUTXO(std::string collection_id, std::string utxo_txid, uint32_t utxo_nout, CAmount amount, std::string collection_addr)
-    { AddCollectionInput(move(collection_id), std::make_shared<UTXO>(chain(), move(utxo_txid), utxo_nout, amount, move(collection_addr))); }
+    { AddCollectionInput(move(collection_id), MakeContractObject<UTXO>(chain(), move(utxo_txid), utxo_nout, amount, move(collection_addr))); }
 
     void Collection(std::string collection_id, CAmount amount, std::string collection_addr);
 
@@ -228,6 +311,9 @@ public:
     CAmount CalculateMissingAmount(std::string address);
     CAmount CalculateMiningFeeAmount() const;
 
+    // Quotes commit and genesis transactions with the weight arithmetic only: no keys, scripts or transactions are built
+    static InscriptionQuote Quote(const InscriptionQuoteParams& params, const std::vector<CAmount>& fee_rates);
+
     l15::stringvector RawTransactions() const;
     l15::stringvector TransactionsPSBT() const;
 
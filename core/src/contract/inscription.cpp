@@ -1,10 +1,14 @@
 
+#include <algorithm>
 #include <list>
+#include <numeric>
 #include <ranges>
 #include <sstream>
 
 #include "transaction.h"
 #include "streams.h"
+#include "hash.h"
+#include "crypto/common.h"
 
 
 #include "inscription.hpp"
@@ -33,6 +37,105 @@ opcodetype GetNextScriptData(const CScript &script, CScript::const_iterator &it,
     return opcode;
 }
 
+// Follows CScript::GetOp() but borrows the push data instead of copying it
+bool GetScriptOp(std::span<const uint8_t> script, size_t& pos, opcodetype& opcode, std::span<const uint8_t>& data)
+{
+    opcode = OP_INVALIDOPCODE;
+    data = {};
+
+    if (pos >= script.size()) return false;
+
+    uint8_t op = script[pos++];
+    if (op <= OP_PUSHDATA4) {
+        size_t size;
+        if (op < OP_PUSHDATA1) {
+            size = op;
+        }
+        else if (op == OP_PUSHDATA1) {
+            if (script.size() - pos < 1) return false;
+            size = script[pos];
+            pos += 1;
+        }
+        else if (op == OP_PUSHDATA2) {
+            if (script.size() - pos < 2) return false;
+            size = ReadLE16(&script[pos]);
+            pos += 2;
+        }
+        else {
+            if (script.size() - pos < 4) return false;
+            size = ReadLE32(&script[pos]);
+            pos += 4;
+        }
+        if (script.size() - pos < size) return false;
+
+        data = script.subspan(pos, size);
+        pos += size;
+    }
+
+    opcode = static_cast<opcodetype>(op);
+    return true;
+}
+
+opcodetype GetNextScriptData(std::span<const uint8_t> script, size_t& pos, std::span<const uint8_t>& data, const char* errtag, bool force_push = false)
+{
+    opcodetype opcode;
+    if (!GetScriptOp(script, pos, opcode, data)) throw InscriptionFormatError(errtag);
+    if (force_push && opcode > OP_PUSHDATA4) {
+        if (opcode == OP_ENDIF) throw EnvelopeEnd();
+        throw InscriptionFormatError("Wrong OP_CODE: " + GetOpName(opcode));
+    }
+    return opcode;
+}
+
+bool IsTag(opcodetype opcode, std::span<const uint8_t> data, opcodetype op_tag, const bytevector& tag)
+{ return opcode == op_tag || (opcode == tag.size() && std::ranges::equal(data, tag)); }
+
+struct TxReader
+{
+    std::span<const uint8_t> data;
+    size_t& pos;
+
+    std::span<const uint8_t> Read(size_t size)
+    {
+        if (data.size() - pos < size) throw InscriptionFormatError("transaction is truncated");
+        auto res = data.subspan(pos, size);
+        pos += size;
+        return res;
+    }
+
+    uint64_t ReadCompactSize()
+    {
+        uint8_t prefix = Read(1)[0];
+        if (prefix < 253) return prefix;
+        if (prefix == 253) return ReadLE16(Read(2).data());
+        if (prefix == 254) return ReadLE32(Read(4).data());
+        return ReadLE64(Read(8).data());
+    }
+
+    std::span<const uint8_t> ReadVarBytes()
+    {
+        uint64_t size = ReadCompactSize();
+        if (size > data.size() - pos) throw InscriptionFormatError("transaction is truncated");
+        return Read(size);
+    }
+
+    bool SegwitMarker() const
+    { return data.size() - pos >= 2 && data[pos] == 0 && data[pos + 1] == 1; }
+};
+
+template <typename TXID>
+void ParseScriptInscriptions(std::span<const uint8_t> script, const TXID& get_txid, std::string& txid, size_t& index, std::vector<InscriptionView>& res)
+{
+    size_t pos = 0;
+    while (pos < script.size()) {
+        try {
+            auto envelope = ParseEnvelopeScript(script, pos);
+            if (txid.empty()) txid = get_txid();
+            res.emplace_back(txid + 'i' + std::to_string(index++), move(envelope));
+        } catch(...) { /*Ignore errors but skip adding inscription*/}
+    }
+}
+
 }
 
 
@@ -79,109 +182,261 @@ Inscription::Inscription(std::string inscription_id, std::list<std::pair<bytevec
 }
 
 
+Inscription::Inscription(const InscriptionView& view)
+    : m_inscription_id(view.GetInscriptionId())
+    , m_content_type(view.GetContentType())
+    , m_content(view.GetContent())
+    , m_ord_shift(view.GetOrdShift())
+    , m_collection_id(view.GetCollectionId())
+    , m_metadata(view.GetMetadata())
+    , m_content_encoding(view.GetContentEncoding())
+    , m_delegate_id(view.GetDelegateId())
+{
+    if (view.HasRuneCommitment()) {
+        auto commitment = view.GetRuneCommitment();
+        m_rune_commitment.emplace(commitment.begin(), commitment.end());
+    }
+}
+
+
 std::list<std::pair<bytevector, bytevector>> ParseEnvelopeScript(const CScript& script, CScript::const_iterator& it) {
+    std::span<const uint8_t> script_data(script.data(), script.size());
+    size_t pos = it - script.begin();
+
+    EnvelopeData envelope;
+    try {
+        envelope = ParseEnvelopeScript(script_data, pos);
+    }
+    catch (...) {
+        it = script.begin() + pos;
+        throw;
+    }
+    it = script.begin() + pos;
+
     std::list<std::pair<bytevector, bytevector>> res;
+    for (const auto& [tag, value]: envelope.tags) {
+        res.emplace_back(bytevector(tag.begin(), tag.end()), bytevector(value.begin(), value.end()));
+    }
+
     bytevector content;
+    content.reserve(std::accumulate(envelope.content.begin(), envelope.content.end(), size_t(0), [](size_t s, const auto& chunk) { return s + chunk.size(); }));
+    for (const auto& chunk: envelope.content) content.insert(content.end(), chunk.begin(), chunk.end());
+    if (!content.empty()) {
+        res.emplace_back(CONTENT_TAG, move(content));
+    }
+
+    return res;
+}
+
+
+EnvelopeData ParseEnvelopeScript(std::span<const uint8_t> script, size_t& pos)
+{
+    EnvelopeData res;
 
-    CScript::const_iterator end = script.end();
     opcodetype prev_opcode_2 = OP_INVALIDOPCODE;
     opcodetype prev_opcode = OP_INVALIDOPCODE;
     opcodetype opcode = OP_INVALIDOPCODE;
-    bytevector data;
+    std::span<const uint8_t> data;
     bool has_ord_envelope = false;
 
-    while (it < end && !has_ord_envelope) {
+    while (pos < script.size() && !has_ord_envelope) {
         prev_opcode_2 = prev_opcode;
         prev_opcode = opcode;
 
-        if (!script.GetOp(it, opcode, data))
+        if (!GetScriptOp(script, pos, opcode, data))
             throw TransactionError("wrong script");
 
         has_ord_envelope = (prev_opcode_2 == OP_0 &&
             prev_opcode == OP_IF &&
             opcode == ORD_TAG.size() &&
-            data == ORD_TAG);
+            std::ranges::equal(data, ORD_TAG));
     }
 
     if (!has_ord_envelope) throw TransactionError("No inscription");
 
+    // Tags given with an opcode have no bytes to borrow from the script, so the static tag values are referenced
+    static const std::pair<opcodetype, const bytevector*> known_tags[] = {
+        {CONTENT_TYPE_OP_TAG, &CONTENT_TYPE_TAG},
+        {ORD_SHIFT_OP_TAG, &ORD_SHIFT_TAG},
+        {COLLECTION_ID_OP_TAG, &COLLECTION_ID_TAG},
+        {METADATA_OP_TAG, &METADATA_TAG},
+        {CONTENT_ENCODING_OP_TAG, &CONTENT_ENCODING_TAG},
+        {DELEGATE_ID_OP_TAG, &DELEGATE_ID_TAG}
+    };
+
     bool fetching_content = false;
 
-    while (it < end) {
+    while (pos < script.size()) {
         try {
-            opcode = GetNextScriptData(script, it, data, "inscription envelope", fetching_content);
+            size_t op_pos = pos;
+            opcode = GetNextScriptData(script, pos, data, "inscription envelope", fetching_content);
 
             if (opcode == OP_ENDIF) {
                 break;
             }
             if (fetching_content) {
-                content.insert(content.end(), data.begin(), data.end());
+                if (!data.empty()) res.content.emplace_back(data);
             }
             else if (opcode == CONTENT_OP_TAG) {
-                content.clear();
+                res.content.clear();
                 fetching_content = true;
             }
-            else if (opcode == CONTENT_TYPE_OP_TAG || (opcode == CONTENT_TYPE_TAG.size() && data == CONTENT_TYPE_TAG)) {
-                GetNextScriptData(script, it, data, "content type", true);
-                res.emplace_back(CONTENT_TYPE_TAG, move(data));
+            else {
+                auto known_it = std::find_if(std::begin(known_tags), std::end(known_tags), [&](const auto& t) { return IsTag(opcode, data, t.first, *t.second); });
+
+                std::span<const uint8_t> tag = (known_it != std::end(known_tags)) ? std::span<const uint8_t>(*known_it->second)
+                                             : data.empty() ? script.subspan(op_pos, 1) : data;
+                GetNextScriptData(script, pos, data, "tag value", true);
+                res.tags.emplace_back(tag, data);
             }
-            else if (opcode == ORD_SHIFT_OP_TAG || (opcode == ORD_SHIFT_TAG.size() && data == ORD_SHIFT_TAG)) {
-                GetNextScriptData(script, it, data, "ord shift", true);
-                res.emplace_back(ORD_SHIFT_TAG, move(data));
+        }
+        catch (EnvelopeEnd&) {break;}
+        catch (...) { }
+    }
+
+    return res;
+}
+
+size_t InscriptionView::GetContentSize() const
+{
+    return std::accumulate(m_content.begin(), m_content.end(), size_t(0), [](size_t s, const auto& chunk) { return s + chunk.size(); });
+}
+
+bytevector InscriptionView::Join(const std::vector<std::span<const uint8_t>>& chunks)
+{
+    bytevector res;
+    res.reserve(std::accumulate(chunks.begin(), chunks.end(), size_t(0), [](size_t s, const auto& chunk) { return s + chunk.size(); }));
+    for (const auto& chunk: chunks) res.insert(res.end(), chunk.begin(), chunk.end());
+    return res;
+}
+
+InscriptionView::InscriptionView(std::string inscription_id, EnvelopeData&& envelope)
+    : m_inscription_id(move(inscription_id))
+{
+    for (const auto& [tag, value]: envelope.tags) {
+        try {
+            if (std::ranges::equal(tag, CONTENT_TYPE_TAG)) {
+                m_content_type = value;
             }
-            else if (opcode == COLLECTION_ID_OP_TAG || (opcode == COLLECTION_ID_TAG.size() && data == COLLECTION_ID_TAG)) {
-                GetNextScriptData(script, it, data, "collection id", true);
-                res.emplace_back(COLLECTION_ID_TAG, move(data));
+            else if (std::ranges::equal(tag, CONTENT_TAG)) {
+                m_content.assign(1, value);
             }
-            else if (opcode == METADATA_OP_TAG || (opcode == METADATA_TAG.size() && data == METADATA_TAG)) {
-                GetNextScriptData(script, it, data, "meta-data", true);
-                res.emplace_back(METADATA_TAG, move(data));
+            else if (std::ranges::equal(tag, COLLECTION_ID_TAG)) {
+                m_collection_id = DeserializeInscriptionId(bytevector(value.begin(), value.end()));
             }
-            else if (opcode == CONTENT_ENCODING_OP_TAG || (opcode == CONTENT_ENCODING_TAG.size() && data == CONTENT_ENCODING_TAG)) {
-                GetNextScriptData(script, it, data, "content encoding", true);
-                res.emplace_back(CONTENT_ENCODING_TAG, move(data));
+            else if (std::ranges::equal(tag, ORD_SHIFT_TAG)) {
+                m_ord_shift = CScriptNum(bytevector(value.begin(), value.end()), false, sizeof(CAmount)).GetInt64();
             }
-            else if (opcode == DELEGATE_ID_OP_TAG || (opcode == DELEGATE_ID_TAG.size() && data == DELEGATE_ID_TAG)) {
-                GetNextScriptData(script, it, data, "delegate id", true);
-                res.emplace_back(DELEGATE_ID_TAG, move(data));
+            else if (std::ranges::equal(tag, METADATA_TAG)) {
+                m_metadata.emplace_back(value);
             }
-            else {
-                bytevector tag = data.empty() ? bytevector{(uint8_t)opcode} : move(data);
-                GetNextScriptData(script, it, data, "unknown tag", true);
-                res.emplace_back(move(tag), move(data));
+            else if (std::ranges::equal(tag, CONTENT_ENCODING_TAG)) {
+                m_content_encoding = value;
+            }
+            else if (std::ranges::equal(tag, DELEGATE_ID_TAG)) {
+                m_delegate_id = DeserializeInscriptionId(bytevector(value.begin(), value.end()));
             }
+            else if (std::ranges::equal(tag, RUNE_TAG)) {
+                m_rune_commitment = value;
+            }
+        } catch (...) {
+            // Just skip a tag data if the data are wrong
         }
-        catch (EnvelopeEnd&) {break;}
-        catch (...) { }
     }
 
-    if (!content.empty()) {
-        res.emplace_back(CONTENT_TAG, move(content));
+    if (!envelope.content.empty()) {
+        m_content = move(envelope.content);
     }
+}
 
-    return res;
+void ParseInscriptions(std::span<const uint8_t> data, size_t& pos, std::vector<InscriptionView>& res)
+{
+    TxReader reader {data, pos};
+    size_t tx_begin = pos;
+
+    auto version = reader.Read(4);
+    bool segwit = reader.SegwitMarker();
+    if (segwit) reader.Read(2);
+
+    size_t body_begin = pos;
+
+    uint64_t vin_count = reader.ReadCompactSize();
+    for (uint64_t i = 0; i < vin_count; ++i) {
+        reader.Read(36);
+        reader.ReadVarBytes();
+        reader.Read(4);
+    }
+    uint64_t vout_count = reader.ReadCompactSize();
+    for (uint64_t i = 0; i < vout_count; ++i) {
+        reader.Read(8);
+        reader.ReadVarBytes();
+    }
+
+    auto body = data.subspan(body_begin, pos - body_begin);
+
+    // Inscription script is the second to last item of a taproot script path witness
+    std::vector<std::span<const uint8_t>> scripts;
+    if (segwit) {
+        for (uint64_t i = 0; i < vin_count; ++i) {
+            uint64_t stack_size = reader.ReadCompactSize();
+            std::span<const uint8_t> prev_item, item;
+            for (uint64_t n = 0; n < stack_size; ++n) {
+                prev_item = item;
+                item = reader.ReadVarBytes();
+            }
+            if (stack_size >= 2) scripts.emplace_back(prev_item);
+        }
+    }
+
+    auto locktime = reader.Read(4);
+
+    // Transaction id is only hashed when an inscription is found
+    auto get_txid = [&]() {
+        uint256 hash;
+        CHash256().Write(version).Write(body).Write(locktime).Finalize(hash);
+        return hash.GetHex();
+    };
+
+    std::string txid;
+    size_t index = 0;
+    for (const auto& script: scripts) {
+        ParseScriptInscriptions(script, get_txid, txid, index, res);
+    }
 }
 
+std::vector<InscriptionView> ParseInscriptions(std::span<const uint8_t> raw_tx)
+{
+    std::vector<InscriptionView> res;
+    size_t pos = 0;
+    ParseInscriptions(raw_tx, pos, res);
+    if (pos != raw_tx.size()) throw InscriptionFormatError("extra data after transaction");
+    return res;
+}
 
-std::list<Inscription> ParseInscriptions(const string &hex_tx)
+std::vector<InscriptionView> ParseInscriptions(const CTransaction& tx)
 {
-    std::list<Inscription> res;
-    auto tx = DecodeHexTx(hex_tx);
+    std::vector<InscriptionView> res;
+    auto get_txid = [&tx]() { return tx.GetHash().GetHex(); };
 
+    std::string txid;
+    size_t index = 0;
     for (const auto& in: tx.vin) {
-        if (in.scriptWitness.stack.size() < 2) continue;
-
         const auto& witness_stack = in.scriptWitness.stack;
-        CScript script(witness_stack[witness_stack.size() - 2].begin(), witness_stack[witness_stack.size() - 2].end());
+        if (witness_stack.size() < 2) continue;
 
-        CScript::const_iterator it = script.begin();
+        ParseScriptInscriptions(witness_stack[witness_stack.size() - 2], get_txid, txid, index, res);
+    }
 
-        while (it != script.end()) {
-            try {
-                auto envelope_tags = ParseEnvelopeScript(script, it);
-                res.emplace_back(move((tx.GetHash().GetHex() + "i") += std::to_string(res.size())), move(envelope_tags));
-            } catch(...) { /*Ignore errors but skip adding inscription*/}
-        }
+    return res;
+}
+
+std::list<Inscription> ParseInscriptions(const string &hex_tx)
+{
+    CTransaction tx(DecodeHexTx(hex_tx));
+
+    std::list<Inscription> res;
+    for (const auto& view: ParseInscriptions(tx)) {
+        res.emplace_back(view);
     }
 
     return res;
@@ -2,6 +2,9 @@
 
 #include <contract_builder.hpp>
 #include <string>
+#include <string_view>
+#include <span>
+#include <vector>
 
 #include "common.hpp"
 #include "inscription_common.hpp"
@@ -19,6 +22,17 @@ public:
 
 std::list<std::pair<l15::bytevector, l15::bytevector>> ParseEnvelopeScript(const CScript& script, CScript::const_iterator& it);
 
+// Envelope tags borrowed from the parsed script. Content is kept as the sequence of its push data chunks.
+struct EnvelopeData
+{
+    std::vector<std::pair<std::span<const uint8_t>, std::span<const uint8_t>>> tags;
+    std::vector<std::span<const uint8_t>> content;
+};
+
+EnvelopeData ParseEnvelopeScript(std::span<const uint8_t> script, size_t& pos);
+
+
+class InscriptionView;
 
 class Inscription
 {
@@ -36,6 +50,7 @@ public:
     Inscription() = default;
 
     explicit Inscription(std::string inscription_id, std::list<std::pair<l15::bytevector, l15::bytevector>>&& tagged_data);
+    explicit Inscription(const InscriptionView& view);
 
     Inscription(const Inscription& ) = default;
     Inscription(Inscription&& ) noexcept = default;
@@ -81,6 +96,80 @@ public:
     }
 };
 
+// Inscription with the data borrowed from a transaction or a block, which must outlive the view.
+// Content and metadata stay split into script push chunks until they are requested as a whole.
+class InscriptionView
+{
+    std::string m_inscription_id;
+    std::span<const uint8_t> m_content_type;
+    std::vector<std::span<const uint8_t>> m_content;
+    CAmount m_ord_shift = 0;
+    std::string m_collection_id;
+    std::vector<std::span<const uint8_t>> m_metadata;
+    std::span<const uint8_t> m_content_encoding;
+    std::string m_delegate_id;
+    std::optional<std::span<const uint8_t>> m_rune_commitment;
+
+    static l15::bytevector Join(const std::vector<std::span<const uint8_t>>& chunks);
+
+public:
+    InscriptionView(std::string inscription_id, EnvelopeData&& envelope);
+
+    InscriptionView(const InscriptionView& ) = default;
+    InscriptionView(InscriptionView&& ) noexcept = default;
+
+    InscriptionView& operator=(const InscriptionView&) = default;
+    InscriptionView& operator=(InscriptionView&&) noexcept = default;
+
+    const std::string& GetInscriptionId() const
+    { return m_inscription_id; }
+
+    std::string_view GetContentType() const
+    { return {reinterpret_cast<const char*>(m_content_type.data()), m_content_type.size()}; }
+
+    const std::vector<std::span<const uint8_t>>& GetContentChunks() const
+    { return m_content; }
+
+    size_t GetContentSize() const;
+
+    l15::bytevector GetContent() const
+    { return Join(m_content); }
+
+    CAmount GetOrdShift() const
+    { return m_ord_shift; }
+
+    bool HasParent() const
+    { return !m_collection_id.empty(); }
+
+    const std::string& GetCollectionId() const
+    { return m_collection_id; }
+
+    l15::bytevector GetMetadata() const
+    { return Join(m_metadata); }
+
+    std::string_view GetContentEncoding() const
+    { return {reinterpret_cast<const char*>(m_content_encoding.data()), m_content_encoding.size()}; }
+
+    const std::string& GetDelegateId() const
+    { return m_delegate_id; }
+
+    bool HasRuneCommitment() const
+    { return m_rune_commitment.has_value(); }
+
+    std::span<const uint8_t> GetRuneCommitment() const
+    {
+        if (!m_rune_commitment) throw InscriptionError("no rune");
+        return *m_rune_commitment;
+    }
+};
+
+// Appends inscriptions of the serialized transaction starting at pos and moves pos next to the transaction
+void ParseInscriptions(std::span<const uint8_t> data, size_t& pos, std::vector<InscriptionView>& res);
+
+// Returned views borrow raw_tx or the witness of tx
+std::vector<InscriptionView> ParseInscriptions(std::span<const uint8_t> raw_tx);
+std::vector<InscriptionView> ParseInscriptions(const CTransaction& tx);
+
 std::list<Inscription> ParseInscriptions(const std::string& hex_tx);
 
 } // utxord
@@ -0,0 +1,114 @@
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "streams.h"
+#include "crypto/common.h"
+
+#include "inscription_scanner.hpp"
+#include "block_file.hpp"
+
+namespace utxord {
+
+namespace {
+
+class MappedFile
+{
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw InscriptionError("cannot open block file: " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw InscriptionError("cannot stat block file: " + path);
+        }
+
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size) {
+            void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw InscriptionError("cannot map block file: " + path);
+            }
+            madvise(addr, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const uint8_t*>(addr);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    { if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size); }
+
+    std::span<const uint8_t> Data() const
+    { return {m_data, m_size}; }
+};
+
+}
+
+std::vector<InscriptionView> InscriptionBlockScanner::ParseBlock(std::span<const uint8_t> block)
+{
+    if (block.size() < BLOCK_HEADER_SIZE) throw InscriptionFormatError("block is truncated");
+
+    SpanReader reader(block.subspan(BLOCK_HEADER_SIZE));
+    uint64_t tx_count;
+    try {
+        tx_count = ReadCompactSize(reader);
+    }
+    catch (const std::ios_base::failure& e) {
+        throw InscriptionFormatError(std::string("block transaction count: ") + e.what());
+    }
+
+    std::vector<InscriptionView> res;
+    for (size_t pos = block.size() - reader.size(); tx_count; --tx_count) {
+        ParseInscriptions(block, pos, res);
+    }
+    return res;
+}
+
+void InscriptionBlockScanner::ScanBlocks(std::span<const uint8_t> data, const block_handler_t& handler)
+{
+    const auto magic = BlockFileMagic(m_chain);
+
+    std::vector<std::span<const uint8_t>> blocks;
+    for (size_t pos = 0; data.size() - pos >= BLOCK_FILE_HEADER_SIZE; ) {
+        auto header = data.subspan(pos, BLOCK_FILE_HEADER_SIZE);
+        // blk*.dat files are preallocated and zero filled at the end
+        if (std::all_of(header.begin(), header.begin() + magic.size(), [](uint8_t b) { return b == 0; })) break;
+        if (!std::equal(magic.begin(), magic.end(), header.begin())) throw InscriptionFormatError("block file magic");
+
+        uint32_t size = ReadLE32(header.data() + magic.size());
+        pos += BLOCK_FILE_HEADER_SIZE;
+        if (data.size() - pos < size || size < BLOCK_HEADER_SIZE) throw InscriptionFormatError("block file is truncated");
+
+        blocks.emplace_back(data.subspan(pos, size));
+        pos += size;
+    }
+
+    std::vector<std::vector<InscriptionView>> inscriptions(blocks.size());
+    m_pool.ForEach(blocks.size(), [&](size_t i) { inscriptions[i] = ParseBlock(blocks[i]); });
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        handler(Hash(blocks[i].first(BLOCK_HEADER_SIZE)), inscriptions[i]);
+    }
+}
+
+void InscriptionBlockScanner::ScanFile(const std::string& path, const block_handler_t& handler)
+{
+    MappedFile file(path);
+    ScanBlocks(file.Data(), handler);
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "uint256.h"
+
+#include "contract_builder.hpp"
+#include "inscription.hpp"
+
+namespace utxord {
+
+// Scans Bitcoin Core blk*.dat files for inscriptions.
+// A file is memory mapped and transactions are walked in place w/o deserialization; every witness tapscript is passed
+// to ParseEnvelopeScript() as a span, so inscription content is never copied. Blocks of a file are parsed in parallel
+// and reported in the file order. Note that blk*.dat files are not ordered by height and may contain stale blocks.
+class InscriptionBlockScanner
+{
+    ChainMode m_chain;
+    WorkerPool m_pool;
+
+public:
+    // Inscription views borrow the scanned data, so they are only valid during the handler call
+    typedef std::function<void(const uint256& block_hash, const std::vector<InscriptionView>& inscriptions)> block_handler_t;
+
+    explicit InscriptionBlockScanner(ChainMode chain, size_t threads = std::thread::hardware_concurrency())
+        : m_chain(chain), m_pool(threads) {}
+
+    void ScanFile(const std::string& path, const block_handler_t& handler);
+
+    // Scans data in blk*.dat format: network magic, block size and serialized block
+    void ScanBlocks(std::span<const uint8_t> data, const block_handler_t& handler);
+
+    static std::vector<InscriptionView> ParseBlock(std::span<const uint8_t> block);
+};
+
+}
@@ -0,0 +1,178 @@
+#include "feerate.h"
+
+#include "transaction.hpp"
+#include "rune_distribution.hpp"
+
+namespace utxord {
+
+using l15::FormatAmount;
+
+namespace {
+
+// Rune outputs go first and the rune stone output is added next to the first one, see SimpleTransaction::AddRuneOutputDestination
+uint32_t PartNOut(size_t i)
+{ return static_cast<uint32_t>(i == 0 ? 0 : i + 1); }
+
+}
+
+std::vector<std::shared_ptr<SimpleTransaction>> RuneDistributionBuilder::Build() const
+{
+    if (m_outputs.empty()) throw ContractStateError(SimpleTransaction::name_outputs + " not defined");
+    if (m_rune_inputs.empty()) throw ContractStateError(SimpleTransaction::name_rune_inputs + " not defined");
+
+    auto add_amount = [this](uint128_t& sum, const uint128_t& amount) {
+        if (sum > MAX_UINT128 - amount) throw ContractTermWrongValue("Rune amount overflow " + (std::string)m_rune_id);
+        sum += amount;
+    };
+
+    uint128_t rune_funds = 0;
+    uint128_t rune_payout = 0;
+    for (const auto& in: m_rune_inputs) add_amount(rune_funds, get<1>(in));
+    for (const auto& out: m_outputs) add_amount(rune_payout, get<1>(out));
+    if (rune_funds < rune_payout)
+        throw ContractFundsNotEnough("rune " + (std::string)m_rune_id + ": " + FormatUInt128(rune_funds) + ", required: " + FormatUInt128(rune_payout));
+
+    const CAmount min_change = l15::Dust(DUST_RELAY_TX_FEE);
+    const auto change_dest = P2Address::Construct(m_chain, {}, m_change_addr);
+    const auto rune_change_dest = P2Address::Construct(m_chain, min_change, m_change_addr);
+
+    std::vector<std::shared_ptr<SimpleTransaction>> parts;
+    uint32_t rune_change_nout = 0;
+    size_t next_input = 0;
+    size_t next_output = 0;
+
+    while (next_output < m_outputs.size()) {
+        // Change output is reserved in advance: every part but the last one must have it to fund the next part
+        TxWeight weight;
+        weight.AddOutput(*change_dest);
+        CAmount funds = 0;
+        CAmount payout = 0;
+        uint128_t part_rune_payout = 0;
+
+        std::shared_ptr<IContractOutput> chained_input;
+        std::shared_ptr<IContractOutput> chained_rune_input;
+        if (parts.empty()) {
+            for (const auto& in: m_rune_inputs) {
+                const auto& dest = get<0>(in)->Destination();
+                weight.AddInput(dest->DummyScriptSig(), dest->DummyWitness());
+                funds += dest->Amount();
+            }
+        }
+        else {
+            chained_rune_input = MakeContractObject<ContractOutput>(parts.back(), rune_change_nout);
+            weight.AddInput(rune_change_dest->DummyScriptSig(), rune_change_dest->DummyWitness());
+            funds += chained_rune_input->Destination()->Amount();
+
+            auto change = parts.back()->ChangeOutput();
+            chained_input = MakeContractObject<ContractOutput>(parts.back(), change->NOut());
+            weight.AddInput(change->Destination()->DummyScriptSig(), change->Destination()->DummyWitness());
+            funds += change->Amount();
+        }
+
+        size_t part_inputs_begin = next_input;
+        size_t part_outputs_begin = next_output;
+        RuneStoneDestination runestone(m_chain);
+
+        for (; next_output < m_outputs.size(); ++next_output) {
+            const auto& [dest, rune_amount] = m_outputs[next_output];
+            size_t part_count = next_output - part_outputs_begin;
+
+            RuneStoneDestination next_runestone = runestone;
+            next_runestone.op_dictionary.emplace(m_rune_id, std::make_tuple(rune_amount, PartNOut(part_count)));
+            uint128_t next_rune_payout = part_rune_payout + rune_amount;
+
+            TxWeight next_weight = weight;
+            next_weight.AddOutput(*dest);
+            CAmount next_payout = payout + dest->Amount();
+
+            // Rune change is only needed while the part does not spend all the runes it gets
+            RuneStoneDestination trial_runestone = next_runestone;
+            TxWeight trial_weight = next_weight;
+            CAmount trial_payout = next_payout;
+            if (next_rune_payout < rune_funds) {
+                trial_runestone.op_dictionary.emplace(m_rune_id, std::make_tuple(rune_funds - next_rune_payout, PartNOut(part_count + 1)));
+                trial_weight.AddOutput(*rune_change_dest);
+                trial_payout += rune_change_dest->Amount();
+            }
+
+            if (trial_runestone.PackedSize() > RUNESTONE_MAX_SIZE) {
+                if (next_output == part_outputs_begin)
+                    throw ContractTermWrongValue(SimpleTransaction::name_outputs + '[' + std::to_string(next_output) + "] does not fit " + RuneStoneDestination::type);
+                break;
+            }
+            trial_weight.AddOutput(trial_runestone);
+
+            CAmount next_funds = funds;
+            size_t next_funding = next_input;
+
+            while (next_funds < trial_payout + trial_weight.Fee(m_mining_fee_rate) + min_change && next_funding < m_inputs.size()) {
+                const auto& funding_dest = m_inputs[next_funding]->Destination();
+                next_weight.AddInput(funding_dest->DummyScriptSig(), funding_dest->DummyWitness());
+                trial_weight.AddInput(funding_dest->DummyScriptSig(), funding_dest->DummyWitness());
+                next_funds += funding_dest->Amount();
+                ++next_funding;
+            }
+
+            if (trial_weight.Weight() > m_max_weight) {
+                if (next_output == part_outputs_begin)
+                    throw ContractTermWrongValue(SimpleTransaction::name_outputs + '[' + std::to_string(next_output) + "] does not fit standard transaction weight");
+                break;
+            }
+
+            if (next_funds < trial_payout + trial_weight.Fee(m_mining_fee_rate) + min_change) {
+                // The very last output may be paid w/o change
+                TxWeight changeless_weight = trial_weight;
+                changeless_weight.RemoveOutput(*change_dest);
+                if (next_output + 1 != m_outputs.size() || next_funds < trial_payout + changeless_weight.Fee(m_mining_fee_rate))
+                    throw ContractFundsNotEnough(FormatAmount(next_funds) + ", required: " + FormatAmount(trial_payout + trial_weight.Fee(m_mining_fee_rate) + min_change));
+            }
+
+            runestone = move(next_runestone);
+            weight = next_weight;
+            payout = next_payout;
+            part_rune_payout = next_rune_payout;
+            funds = next_funds;
+            next_input = next_funding;
+        }
+
+        auto part = MakeContractObject<SimpleTransaction>(m_chain);
+        part->MiningFeeRate(m_mining_fee_rate);
+        if (chained_rune_input) {
+            part->AddRuneInput(move(chained_rune_input), m_rune_id, rune_funds);
+            part->AddInput(move(chained_input));
+        }
+        else {
+            for (const auto& [prevout, rune_amount]: m_rune_inputs) {
+                part->AddRuneInput(prevout, m_rune_id, rune_amount);
+            }
+        }
+        for (size_t i = part_inputs_begin; i < next_input; ++i) {
+            part->AddInput(m_inputs[i]);
+        }
+        for (size_t i = part_outputs_begin; i < next_output; ++i) {
+            part->AddRuneOutputDestination(get<0>(m_outputs[i]), m_rune_id, get<1>(m_outputs[i]));
+        }
+
+        rune_funds -= part_rune_payout;
+        if (rune_funds > 0) {
+            part->AddRuneOutputDestination(P2Address::Construct(m_chain, min_change, m_change_addr), m_rune_id, rune_funds);
+            rune_change_nout = part->CountDestinations() - 1;
+        }
+
+        TxWeight final_weight = weight;
+        if (rune_funds > 0) final_weight.AddOutput(*rune_change_dest);
+        final_weight.AddOutput(*part->RuneStoneOutput()->Destination());
+        CAmount final_payout = payout + (rune_funds > 0 ? rune_change_dest->Amount() : 0);
+
+        if (next_output < m_outputs.size() || funds >= final_payout + final_weight.Fee(m_mining_fee_rate) + min_change) {
+            part->AddChangeOutput(m_change_addr);
+            if (!part->ChangeOutput()) throw ContractStateError("rune distribution change output is missing for part " + std::to_string(parts.size()));
+        }
+
+        parts.emplace_back(move(part));
+    }
+
+    return parts;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+
+#include "policy.h"
+
+#include "contract_builder.hpp"
+#include "simple_transaction.hpp"
+#include "runes.hpp"
+
+namespace utxord {
+
+// Splits a rune distribution (i.e. an airdrop) into a chain of transactions with rune stones fitting the OP_RETURN limit.
+// The first part spends all the rune inputs; every next one spends the rune change and the bitcoin change of the previous one.
+// Funding inputs are drawn in the order they are added when the chained change does not cover the part outputs.
+// The largest edict of a part (the rune change as long as the distribution goes on) is encoded as the rune stone pointer
+// and takes no space in the edict list.
+class RuneDistributionBuilder
+{
+    ChainMode m_chain;
+    RuneId m_rune_id;
+    CAmount m_mining_fee_rate;
+    std::string m_change_addr;
+    int64_t m_max_weight;
+
+    std::vector<std::tuple<std::shared_ptr<IContractOutput>, uint128_t>> m_rune_inputs;
+    std::vector<std::shared_ptr<IContractOutput>> m_inputs;
+    std::vector<std::tuple<std::shared_ptr<IContractDestination>, uint128_t>> m_outputs;
+
+public:
+    RuneDistributionBuilder(ChainMode chain, RuneId rune_id, CAmount mining_fee_rate, std::string change_addr, int64_t max_weight = MAX_STANDARD_TX_WEIGHT)
+        : m_chain(chain), m_rune_id(move(rune_id)), m_mining_fee_rate(mining_fee_rate), m_change_addr(move(change_addr)), m_max_weight(max_weight) {}
+
+    void AddRuneInput(std::shared_ptr<IContractOutput> prevout, uint128_t rune_amount)
+    {
+        if (!prevout) throw ContractTermWrongValue(SimpleTransaction::name_rune_inputs + '[' + std::to_string(m_rune_inputs.size()) + ']');
+        m_rune_inputs.emplace_back(move(prevout), rune_amount);
+    }
+
+    void AddRuneUTXO(std::string txid, uint32_t nout, CAmount btc_amount, std::string addr, uint128_t rune_amount)
+    { AddRuneInput(MakeContractObject<UTXO>(m_chain, move(txid), nout, btc_amount, move(addr)), rune_amount); }
+
+    void AddInput(std::shared_ptr<IContractOutput> prevout)
+    {
+        if (!prevout) throw ContractTermWrongValue(IContractBuilder::name_utxo + '[' + std::to_string(m_inputs.size()) + ']');
+        m_inputs.emplace_back(move(prevout));
+    }
+
+    void AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr)
+    { AddInput(MakeContractObject<UTXO>(m_chain, move(txid), nout, amount, move(addr))); }
+
+    void AddRuneOutputDestination(std::shared_ptr<IContractDestination> destination, uint128_t rune_amount)
+    {
+        if (!destination || rune_amount == 0) throw ContractTermWrongValue(SimpleTransaction::name_outputs + '[' + std::to_string(m_outputs.size()) + ']');
+        m_outputs.emplace_back(move(destination), rune_amount);
+    }
+
+    void AddRuneOutput(CAmount btc_amount, std::string addr, uint128_t rune_amount)
+    { AddRuneOutputDestination(P2Address::Construct(m_chain, btc_amount, move(addr)), rune_amount); }
+
+    size_t CountOutputs() const
+    { return m_outputs.size(); }
+
+    // Ready to sign transactions; every next one spends the rune change and the change outputs of the previous one
+    std::vector<std::shared_ptr<SimpleTransaction>> Build() const;
+};
+
+}
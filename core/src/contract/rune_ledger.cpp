@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "streams.h"
+#include "crypto/common.h"
+
+#include "rune_ledger.hpp"
+#include "block_file.hpp"
+
+namespace utxord {
+
+namespace {
+
+uint64_t RelativeHeight(uint64_t height, uint64_t offset)
+{ return (offset > std::numeric_limits<uint64_t>::max() - height) ? std::numeric_limits<uint64_t>::max() : height + offset; }
+
+// Block height committed to the coinbase script (BIP34)
+std::optional<uint64_t> CoinbaseHeight(const CBlock& block)
+{
+    if (block.vtx.empty() || !block.vtx.front()->IsCoinBase()) return {};
+
+    const CScript& script = block.vtx.front()->vin.front().scriptSig;
+    auto it = script.begin();
+    opcodetype op;
+    std::vector<uint8_t> data;
+    if (!script.GetOp(it, op, data)) return {};
+
+    if (op >= OP_1 && op <= OP_16) return CScript::DecodeOP_N(op);
+    if (op > OP_PUSHDATA4) return {};
+    try {
+        int64_t height = CScriptNum(data, false).GetInt64();
+        if (height >= 0) return height;
+    }
+    catch (const scriptnum_error&) {}
+    return {};
+}
+
+}
+
+bool RuneEntry::Mintable(uint64_t height) const
+{
+    if (!terms || !mint_cap || !per_mint_amount) return false;
+    if (mints >= *mint_cap) return false;
+    if (mint_height_start && height < *mint_height_start) return false;
+    if (mint_height_end && height >= *mint_height_end) return false;
+    if (mint_height_offset_start && height < RelativeHeight(id.chain_height, *mint_height_offset_start)) return false;
+    if (mint_height_offset_end && height >= RelativeHeight(id.chain_height, *mint_height_offset_end)) return false;
+    return true;
+}
+
+void RuneLedger::ProcessBlock(std::shared_ptr<const CBlock> block)
+{
+    if (!block) throw ContractTermWrongValue("block");
+
+    uint64_t height = m_height;
+    if (block->hashPrevBlock != m_tip_hash) {
+        auto coinbase_height = CoinbaseHeight(*block);
+        if (!coinbase_height || *coinbase_height <= m_height) return;
+        if (*coinbase_height >= m_height + m_max_pending) throw ContractStateError("block is too far ahead of the tip: " + std::to_string(*coinbase_height));
+        height = *coinbase_height;
+    }
+
+    const uint256 prev_hash = block->hashPrevBlock;
+    const uint256 hash = block->GetHash();
+    auto [begin, end] = m_pending.equal_range(prev_hash);
+    if (std::any_of(begin, end, [&](const auto& pending) { return pending.second.block->GetHash() == hash; })) return;
+
+    m_pending.emplace(prev_hash, PendingBlock{height, move(block)});
+
+    while (auto next = TakeNextBlock()) ConnectBlock(*next);
+
+    // Blocks whose parent did not come before the tip moved on cannot be connected anymore
+    if (m_pending.size() > m_max_pending) {
+        std::erase_if(m_pending, [this](const auto& pending) { return pending.second.height < m_height; });
+    }
+}
+
+std::shared_ptr<const CBlock> RuneLedger::TakeNextBlock()
+{
+    auto [begin, end] = m_pending.equal_range(m_tip_hash);
+    if (begin == end) return nullptr;
+
+    auto best = begin;
+    if (std::next(begin) != end) {
+        size_t best_length = PendingChainLength(begin->second.block->GetHash());
+        bool even = false;
+        for (auto it = std::next(begin); it != end; ++it) {
+            size_t length = PendingChainLength(it->second.block->GetHash());
+            if (length > best_length) {
+                best = it;
+                best_length = length;
+                even = false;
+            }
+            else if (length == best_length) {
+                even = true;
+            }
+        }
+        if (even) return nullptr;
+    }
+
+    auto block = move(best->second.block);
+    m_pending.erase(best);
+    // Competing branches lose
+    DropPending(m_tip_hash);
+    return block;
+}
+
+size_t RuneLedger::PendingChainLength(const uint256& hash) const
+{
+    size_t length = 0;
+    std::vector<std::pair<uint256, size_t>> stack {{hash, 0}};
+    while (!stack.empty()) {
+        auto [block_hash, depth] = stack.back();
+        stack.pop_back();
+        length = std::max(length, depth);
+
+        auto [begin, end] = m_pending.equal_range(block_hash);
+        for (auto it = begin; it != end; ++it) stack.emplace_back(it->second.block->GetHash(), depth + 1);
+    }
+    return length;
+}
+
+void RuneLedger::DropPending(const uint256& prev_hash)
+{
+    std::vector<uint256> stack {prev_hash};
+    while (!stack.empty()) {
+        uint256 block_hash = stack.back();
+        stack.pop_back();
+
+        auto [begin, end] = m_pending.equal_range(block_hash);
+        for (auto it = begin; it != end; ++it) stack.push_back(it->second.block->GetHash());
+        m_pending.erase(begin, end);
+    }
+}
+
+void RuneLedger::ProcessBlockFile(std::istream& in)
+{
+    const auto magic = BlockFileMagic(m_chain);
+    std::array<uint8_t, BLOCK_FILE_HEADER_SIZE> header;
+
+    while (in.read(reinterpret_cast<char*>(header.data()), header.size())) {
+        // blk*.dat files are preallocated and zero filled at the end
+        if (std::all_of(header.begin(), header.begin() + magic.size(), [](uint8_t b) { return b == 0; })) break;
+        if (!std::equal(magic.begin(), magic.end(), header.begin())) throw ContractFormatError("block file magic");
+
+        uint32_t size = ReadLE32(header.data() + magic.size());
+
+        DataStream stream;
+        stream.resize(size);
+        if (!in.read(reinterpret_cast<char*>(stream.data()), size)) throw ContractFormatError("block file is truncated");
+
+        auto block = std::make_shared<CBlock>();
+        stream >> TX_WITH_WITNESS(*block);
+        ProcessBlock(move(block));
+    }
+}
+
+void RuneLedger::ConnectBlock(const CBlock& block)
+{
+    // Rune stone decoding does not depend on the ledger state, so it runs in parallel
+    std::vector<std::optional<RuneStone>> runestones(block.vtx.size());
+    m_pool.ForEach(block.vtx.size(), [&](size_t i) {
+        runestones[i] = ParseRuneStone(*block.vtx[i], m_chain);
+    });
+
+    BlockUndo undo {block.GetHash(), block.hashPrevBlock, {}};
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        ApplyTransaction(*block.vtx[i], static_cast<uint32_t>(i), runestones[i], undo);
+    }
+
+    m_tip_hash = undo.hash;
+    ++m_height;
+
+    m_undo.emplace_back(move(undo));
+    if (m_undo.size() > m_max_reorg_depth) m_undo.pop_front();
+}
+
+void RuneLedger::ApplyTransaction(const CTransaction& tx, uint32_t tx_index, const std::optional<RuneStone>& runestone, BlockUndo& undo)
+{
+    RuneBalances unallocated;
+
+    if (!tx.IsCoinBase()) {
+        for (const auto& in: tx.vin) {
+            auto it = m_balances.find(in.prevout);
+            if (it == m_balances.end()) continue;
+
+            for (const auto& [id, amount]: it->second) unallocated[id] += amount;
+            undo.entries.push_back({UndoOp::SPEND, in.prevout, move(it->second)});
+            m_balances.erase(it);
+        }
+    }
+
+    if (!runestone && unallocated.empty()) return;
+
+    // Flags, fields, edict rune ids and supply are checked by the parser, only the outputs are left to check against the transaction
+    bool cenotaph = runestone && runestone->cenotaph;
+    if (runestone && !cenotaph) {
+        if (runestone->default_output && *runestone->default_output >= tx.vout.size()) cenotaph = true;
+        for (const auto& [id, edict]: runestone->op_dictionary) {
+            if (get<1>(edict) > tx.vout.size()) cenotaph = true;
+        }
+    }
+
+    RuneBalances burned;
+    std::map<uint32_t, RuneBalances> allocated;
+
+    // Mint of a cenotaph is still counted, the minted amount is burned along with the inputs since nothing is allocated
+    if (runestone && runestone->mint_rune_id) {
+        auto rune_it = m_runes.find(*runestone->mint_rune_id);
+        if (rune_it != m_runes.end() && rune_it->second.Mintable(m_height)) {
+            ++rune_it->second.mints;
+            unallocated[rune_it->first] += *rune_it->second.per_mint_amount;
+            undo.entries.push_back({UndoOp::MINT, {}, {}, rune_it->first});
+        }
+    }
+
+    std::optional<RuneId> etched;
+    if (runestone && runestone->HasAction(RuneAction::ETCH)) {
+        // Etching w/o a name gets the reserved one unless it is a cenotaph; explicitly given reserved name is not allowed
+        std::optional<uint128_t> rune_name = runestone->rune;
+        if (rune_name && (*rune_name >= RESERVED_RUNE || m_rune_names.contains(*rune_name)))
+            rune_name.reset();
+        else if (!rune_name && !cenotaph)
+            rune_name = RESERVED_RUNE + ((uint128_t(m_height) << 32) | tx_index);
+
+        // Cenotaph etching creates the rune with zero supply
+        if (rune_name && cenotaph) {
+            RuneEntry entry {.id = RuneId(m_height, tx_index), .rune = *rune_name};
+            etched = entry.id;
+            m_rune_names.emplace(entry.rune, entry.id);
+            m_runes.emplace(entry.id, move(entry));
+            undo.entries.push_back({UndoOp::ETCH, {}, {}, *etched});
+        }
+        else if (rune_name) {
+            RuneEntry entry {
+                .id = RuneId(m_height, tx_index),
+                .rune = *rune_name,
+                .spacers = runestone->spacers.value_or(0),
+                .symbol = runestone->symbol,
+                .divisibility = runestone->divisibility.value_or(0),
+                .premine = runestone->premine_amount.value_or(0),
+                .turbo = runestone->HasAction(RuneAction::TURBO)
+            };
+            if (runestone->HasAction(RuneAction::TERMS)) {
+                entry.terms = true;
+                entry.mint_cap = runestone->mint_cap;
+                entry.per_mint_amount = runestone->per_mint_amount;
+                entry.mint_height_start = runestone->mint_height_start;
+                entry.mint_height_end = runestone->mint_height_end;
+                entry.mint_height_offset_start = runestone->mint_height_offset_start;
+                entry.mint_height_offset_end = runestone->mint_height_offset_end;
+            }
+
+            etched = entry.id;
+            if (entry.premine) unallocated[entry.id] += entry.premine;
+            m_rune_names.emplace(entry.rune, entry.id);
+            m_runes.emplace(entry.id, move(entry));
+            undo.entries.push_back({UndoOp::ETCH, {}, {}, *etched});
+        }
+    }
+
+    if (runestone && !cenotaph) {
+        auto allocate = [&](uint32_t nout, const RuneId& id, uint128_t& balance, uint128_t amount) {
+            amount = std::min(amount, balance);
+            if (!amount) return;
+            balance -= amount;
+            if (tx.vout[nout].scriptPubKey.IsUnspendable()) burned[id] += amount;
+            else allocated[nout][id] += amount;
+        };
+
+        for (const auto& [edict_id, edict]: runestone->op_dictionary) {
+            // Zero rune id refers to the rune etched by this transaction
+            bool etching_edict = edict_id.chain_height == 0 && edict_id.tx_index == 0;
+            if (etching_edict && !etched) continue;
+
+            auto balance_it = unallocated.find(etching_edict ? *etched : edict_id);
+            if (balance_it == unallocated.end()) continue;
+
+            auto& [id, balance] = *balance_it;
+            const auto& [amount, nout] = edict;
+
+            if (nout == tx.vout.size()) {
+                // Split between all the spendable outputs
+                std::vector<uint32_t> outputs;
+                for (uint32_t i = 0; i < tx.vout.size(); ++i) {
+                    if (!tx.vout[i].scriptPubKey.IsUnspendable()) outputs.push_back(i);
+                }
+                if (outputs.empty()) continue;
+
+                if (amount == 0) {
+                    uint128_t share = balance / outputs.size();
+                    uint128_t rest = balance % outputs.size();
+                    for (size_t i = 0; i < outputs.size(); ++i) {
+                        allocate(outputs[i], id, balance, share + (i < rest ? 1 : 0));
+                    }
+                }
+                else {
+                    for (uint32_t out: outputs) allocate(out, id, balance, amount);
+                }
+            }
+            else {
+                allocate(nout, id, balance, amount == 0 ? balance : amount);
+            }
+        }
+    }
+
+    std::optional<uint32_t> pointer;
+    if (!cenotaph) {
+        if (runestone && runestone->default_output) {
+            pointer = *runestone->default_output;
+        }
+        else {
+            for (uint32_t i = 0; i < tx.vout.size(); ++i) {
+                if (!tx.vout[i].scriptPubKey.IsUnspendable()) {
+                    pointer = i;
+                    break;
+                }
+            }
+        }
+        if (pointer && tx.vout[*pointer].scriptPubKey.IsUnspendable()) pointer.reset();
+    }
+
+    for (const auto& [id, balance]: unallocated) {
+        if (!balance) continue;
+        if (pointer) allocated[*pointer][id] += balance;
+        else burned[id] += balance;
+    }
+
+    for (const auto& [id, amount]: burned) {
+        auto rune_it = m_runes.find(id);
+        if (rune_it == m_runes.end()) continue;
+        rune_it->second.burned += amount;
+        undo.entries.push_back({UndoOp::BURN, {}, {}, id, amount});
+    }
+
+    const Txid& txid = tx.GetHash();
+    for (auto& [nout, balances]: allocated) {
+        COutPoint outpoint(txid, nout);
+        m_balances.emplace(outpoint, move(balances));
+        undo.entries.push_back({UndoOp::CREATE, outpoint});
+    }
+}
+
+void RuneLedger::Rollback()
+{
+    if (m_undo.empty()) throw ContractStateError("no undo data to roll back the block at height " + std::to_string(m_height - 1));
+
+    BlockUndo& undo = m_undo.back();
+    for (auto it = undo.entries.rbegin(); it != undo.entries.rend(); ++it) {
+        switch (it->op) {
+        case UndoOp::SPEND:
+            m_balances[it->outpoint] = move(it->balances);
+            break;
+        case UndoOp::CREATE:
+            m_balances.erase(it->outpoint);
+            break;
+        case UndoOp::ETCH:
+            m_rune_names.erase(m_runes.at(it->rune_id).rune);
+            m_runes.erase(it->rune_id);
+            break;
+        case UndoOp::MINT:
+            --m_runes.at(it->rune_id).mints;
+            break;
+        case UndoOp::BURN:
+            m_runes.at(it->rune_id).burned -= it->amount;
+            break;
+        }
+    }
+
+    m_tip_hash = undo.prev_hash;
+    --m_height;
+    m_undo.pop_back();
+}
+
+const RuneEntry* RuneLedger::GetRune(const RuneId& id) const
+{
+    auto it = m_runes.find(id);
+    return it != m_runes.end() ? &it->second : nullptr;
+}
+
+std::optional<RuneId> RuneLedger::LookupRune(uint128_t rune) const
+{
+    auto it = m_rune_names.find(rune);
+    return it != m_rune_names.end() ? std::optional<RuneId>(it->second) : std::nullopt;
+}
+
+const RuneBalances* RuneLedger::GetBalances(const COutPoint& outpoint) const
+{
+    auto it = m_balances.find(outpoint);
+    return it != m_balances.end() ? &it->second : nullptr;
+}
+
+}
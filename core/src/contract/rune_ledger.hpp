@@ -0,0 +1,134 @@
+#pragma once
+
+#include <deque>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "primitives/block.h"
+#include "util/hasher.h"
+
+#include "contract_builder.hpp"
+#include "runes.hpp"
+
+namespace utxord {
+
+typedef std::map<RuneId, uint128_t> RuneBalances;
+
+struct RuneEntry
+{
+    RuneId id;
+    uint128_t rune = 0;
+    uint32_t spacers = 0;
+    std::optional<wchar_t> symbol;
+    uint8_t divisibility = 0;
+    uint128_t premine = 0;
+    bool turbo = false;
+
+    // Mint Terms
+    bool terms = false;
+    std::optional<uint128_t> mint_cap;
+    std::optional<uint128_t> per_mint_amount;
+    std::optional<uint64_t> mint_height_start;
+    std::optional<uint64_t> mint_height_end;
+    std::optional<uint64_t> mint_height_offset_start;
+    std::optional<uint64_t> mint_height_offset_end;
+
+    uint128_t mints = 0;
+    uint128_t burned = 0;
+
+    bool Mintable(uint64_t height) const;
+};
+
+// Rune balances ledger fed with raw blocks in chain order.
+// Rune stones of a block are decoded in parallel, then etchings, mints, edicts and burns are applied transaction by transaction.
+// Undo data of the recent blocks is kept, so the tip can be rolled back on reorg.
+// Rune name commitments are not checked: an etching is accepted when the name is not taken yet.
+class RuneLedger
+{
+    enum class UndoOp: uint8_t { SPEND, CREATE, ETCH, MINT, BURN };
+
+    struct UndoEntry
+    {
+        UndoOp op;
+        COutPoint outpoint;
+        RuneBalances balances;
+        RuneId rune_id;
+        uint128_t amount = 0;
+    };
+
+    struct BlockUndo
+    {
+        uint256 hash;
+        uint256 prev_hash;
+        std::vector<UndoEntry> entries;
+    };
+
+    ChainMode m_chain;
+    uint64_t m_height;
+    uint256 m_tip_hash;
+    size_t m_max_reorg_depth;
+
+    std::unordered_map<COutPoint, RuneBalances, SaltedOutpointHasher> m_balances;
+    std::map<RuneId, RuneEntry> m_runes;
+    std::map<uint128_t, RuneId> m_rune_names;
+
+    struct PendingBlock
+    {
+        uint64_t height;
+        std::shared_ptr<const CBlock> block;
+    };
+
+    std::deque<BlockUndo> m_undo;
+    // Blocks which came ahead of their parent (blk*.dat files are not ordered by height) keyed by the parent hash
+    std::unordered_multimap<uint256, PendingBlock, SaltedUint256Hasher> m_pending;
+    size_t m_max_pending;
+
+    WorkerPool m_pool;
+
+    std::shared_ptr<const CBlock> TakeNextBlock();
+    size_t PendingChainLength(const uint256& hash) const;
+    void DropPending(const uint256& prev_hash);
+    void ConnectBlock(const CBlock& block);
+    void ApplyTransaction(const CTransaction& tx, uint32_t tx_index, const std::optional<RuneStone>& runestone, BlockUndo& undo);
+
+public:
+    // first_height and prev_block_hash define the point where the ledger starts, i.e. the first rune block.
+    // max_pending limits how far ahead of the tip (in blocks) a block may come.
+    explicit RuneLedger(ChainMode chain, uint64_t first_height = 0, uint256 prev_block_hash = uint256(), size_t max_reorg_depth = 100, size_t max_pending = 2048)
+        : m_chain(chain), m_height(first_height), m_tip_hash(prev_block_hash), m_max_reorg_depth(max_reorg_depth), m_max_pending(max_pending) {}
+
+    RuneLedger(const RuneLedger&) = delete;
+    RuneLedger& operator=(const RuneLedger&) = delete;
+
+    // Connects the block if it extends the tip, otherwise keeps it until its parent is connected.
+    // Of several children of the tip the one with the longest chain of descendants is connected and the others are dropped;
+    // while the chains are even the choice is deferred. A block which can no longer extend the chain by its height (BIP34)
+    // is dropped, so blocks of a competing branch have to be preceded with Rollback() to the fork point.
+    void ProcessBlock(std::shared_ptr<const CBlock> block);
+
+    // Reads blocks stored in Bitcoin Core blk*.dat format: network magic, block size and serialized block
+    void ProcessBlockFile(std::istream& in);
+
+    // Disconnects the tip block
+    void Rollback();
+
+    // Height of the next block to connect
+    uint64_t Height() const
+    { return m_height; }
+
+    const uint256& TipHash() const
+    { return m_tip_hash; }
+
+    size_t CountPendingBlocks() const
+    { return m_pending.size(); }
+
+    const RuneEntry* GetRune(const RuneId& id) const;
+    std::optional<RuneId> LookupRune(uint128_t rune) const;
+    const RuneBalances* GetBalances(const COutPoint& outpoint) const;
+};
+
+}
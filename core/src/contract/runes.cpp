@@ -5,9 +5,11 @@
 #include "transaction.hpp"
 #include "contract_error.hpp"
 
-#include <boost/container/flat_map.hpp>
-
+#include <algorithm>
+#include <array>
 #include <functional>
+#include <limits>
+#include <span>
 #include <sstream>
 
 namespace utxord {
@@ -15,17 +17,16 @@ namespace utxord {
 template <typename I>
 uint128_t read_varint(I& i, I end)
 {
+    // LEB128: little endian groups of 7 bits, the high bit marks continuation
     uint128_t value = 0;
-
-    for(; (*i & 0x080) != 0 && i != end; ++i) {
-        value = (value * 128) | uint128_t(*i & 0x7f);
-    }
-    if (i == end) throw std::runtime_error("Wrong varint format");
-
-    value = (value * 128) | uint128_t(*i);
-
-    ++i;
-    return value;
+    for (unsigned shift = 0; i != end; shift += 7) {
+        uint8_t byte = *i++;
+        uint128_t bits = byte & 0x7f;
+        if (shift > 121 && (shift >= 128 || (bits >> (128 - shift)) != 0)) throw std::overflow_error("varint is too large");
+        value |= bits << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+    throw std::runtime_error("Wrong varint format");
 }
 
 template <typename INT>
@@ -34,12 +35,6 @@ bytevector write_varint(INT n)
     bytevector varint;
     varint.reserve(sizeof n);
 
-    // for ( ;n > 0x7F; n = n / 0x80u - 1) {
-    //     uint8_t little7bits = static_cast<uint8_t>(n % 0x80u);
-    //     varint.push_back(varint.empty() ? little7bits : (little7bits | 0x80u));
-    // }
-    // varint.push_back(varint.empty() ? static_cast<uint8_t>(n) : (static_cast<uint8_t>(n) | 0x80u));
-    // return {varint.rbegin(), varint.rend()};
     for ( ;n > 0x7F; n /= 128) {
         uint8_t little7bits = static_cast<uint8_t>(n % 128);
         varint.push_back(little7bits | 0x80u);
@@ -50,6 +45,7 @@ bytevector write_varint(INT n)
 
 
 template uint128_t read_varint(bytevector::const_iterator&, bytevector::const_iterator);
+template uint128_t read_varint(const uint8_t*&, const uint8_t*);
 template bytevector write_varint(uint128_t n);
 template bytevector write_varint(uint64_t n);
 template bytevector write_varint(uint32_t n);
@@ -57,17 +53,180 @@ template bytevector write_varint(uint8_t n);
 
 namespace {
 
-using namespace boost::multiprecision;
+const char *RUNE_TEST_HEADER = "RUNE_TEST";
 
-#ifndef DEBUG
-using int136_t = number<cpp_int_backend<128, 136, signed_magnitude, unchecked, void> >;
-#else
-using int136_t = number<debug_adaptor<cpp_int_backend<128, 136, signed_magnitude, unchecked, void>>>;
-#endif
+const uint64_t POW10[] = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+                          1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+                          100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+                          1000000000000000000ull, 10000000000000000000ull};
+const size_t UINT64_DEC_DIGITS = 19;
 
-const char *RUNE_TEST_HEADER = "RUNE_TEST";
-const char *RUNE_HEADER = "RUNE";
+uint128_t ReadUInt128(const UniValue& val, const std::function<std::string()>& lazy_name)
+{
+    try {
+        return ParseUInt128(val.getValStr());
+    }
+    catch (...) {
+        std::throw_with_nested(ContractTermWrongValue(lazy_name()));
+    }
+}
+
+// Rune stone is encoded directly into the fixed buffer of maximal allowed size.
+// Bytes beyond the limit are only counted to report the actual size of a too large rune stone.
+class RuneStoneWriter
+{
+    std::array<uint8_t, RUNESTONE_MAX_SIZE> m_buf;
+    size_t m_size = 0;
+public:
+    void Byte(uint8_t b)
+    {
+        if (m_size < m_buf.size()) m_buf[m_size] = b;
+        ++m_size;
+    }
+
+    template <typename INT>
+    void VarInt(INT n)
+    {
+        for (; n > 0x7F; n >>= 7) Byte(static_cast<uint8_t>(n & 0x7F) | 0x80u);
+        Byte(static_cast<uint8_t>(n));
+    }
+
+    template <typename INT>
+    void Field(RuneTag tag, INT n)
+    {
+        Byte(static_cast<uint8_t>(tag));
+        VarInt(n);
+    }
+
+    size_t Size() const { return m_size; }
+    bytevector Data() const { return {m_buf.begin(), m_buf.begin() + std::min(m_size, m_buf.size())}; }
+};
+
+template <typename INT>
+bool Fits(uint128_t v)
+{ return v <= uint128_t(std::numeric_limits<INT>::max()); }
+
+// Tag/value pairs of a rune stone in the order of appearance.
+// Known fields are taken once per protocol; an even tag left over (duplicated, invalid or w/o the enabling flag) makes a cenotaph.
+class RuneStoneFields
+{
+    std::multimap<uint128_t, uint128_t> m_fields;
+public:
+    void Add(uint128_t tag, uint128_t value)
+    { m_fields.emplace(tag, value); }
+
+    // Takes the first value of the tag unless it is above the max
+    std::optional<uint128_t> Take(RuneTag tag, uint128_t max = MAX_UINT128)
+    {
+        auto it = m_fields.lower_bound((uint8_t)tag);
+        if (it == m_fields.end() || it->first != (uint8_t)tag || it->second > max) return {};
+
+        uint128_t v = it->second;
+        m_fields.erase(it);
+        return v;
+    }
+
+    template <typename INT>
+    std::optional<INT> Take(RuneTag tag, INT max = std::numeric_limits<INT>::max())
+    {
+        auto v = Take(tag, uint128_t(max));
+        return v ? std::optional<INT>(static_cast<INT>(*v)) : std::nullopt;
+    }
+
+    // Takes the first two values of the tag as block height and tx index
+    std::optional<RuneId> TakeRuneId(RuneTag tag)
+    {
+        auto block_it = m_fields.lower_bound((uint8_t)tag);
+        if (block_it == m_fields.end() || block_it->first != (uint8_t)tag) return {};
+        auto tx_it = std::next(block_it);
+        if (tx_it == m_fields.end() || tx_it->first != (uint8_t)tag) return {};
+
+        const uint128_t& block = block_it->second;
+        const uint128_t& tx = tx_it->second;
+        if (!Fits<uint64_t>(block) || !Fits<uint32_t>(tx) || (block == 0 && tx != 0)) return {};
+
+        RuneId id(static_cast<uint64_t>(block), static_cast<uint32_t>(tx));
+        m_fields.erase(block_it, std::next(tx_it));
+        return id;
+    }
+
+    bool HasEvenTag() const
+    { return std::any_of(m_fields.begin(), m_fields.end(), [](const auto& field) { return field.first % 2 == 0; }); }
+};
+
+// Applies the delta encoded edict rune id, fails on overflow and on non zero tx index at zero block
+bool NextRuneId(RuneId& id, uint128_t block_delta, uint128_t tx)
+{
+    if (!Fits<uint64_t>(block_delta) || !Fits<uint32_t>(tx)) return false;
 
+    uint128_t block = id.chain_height + block_delta;
+    if (block_delta == 0) tx += id.tx_index;
+    if (!Fits<uint64_t>(block) || !Fits<uint32_t>(tx) || (block == 0 && tx != 0)) return false;
+
+    id = {static_cast<uint64_t>(block), static_cast<uint32_t>(tx)};
+    return true;
+}
+
+// Borrows the push data of the next script op w/o copying it
+bool GetPushData(const CScript& script, CScript::const_iterator& it, opcodetype& op, std::span<const uint8_t>& data)
+{
+    auto start = it;
+    if (!script.GetOp(it, op)) return false;
+
+    if (op > OP_PUSHDATA4) {
+        data = {};
+        return true;
+    }
+
+    size_t header = (op < OP_PUSHDATA1) ? 1 : (op == OP_PUSHDATA1) ? 2 : (op == OP_PUSHDATA2) ? 3 : 5;
+    data = {&*start + header, static_cast<size_t>(it - start) - header};
+    return true;
+}
+
+}
+
+std::string FormatUInt128(uint128_t n)
+{
+    // 128 bit division is done once per 19 decimal digits, the rest is 64 bit arithmetic
+    char buf[40];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+
+    auto put = [&p](uint64_t chunk, bool pad) {
+        char* chunk_end = p;
+        do {
+            *--p = static_cast<char>('0' + chunk % 10);
+            chunk /= 10;
+        } while (chunk);
+        if (pad) while (chunk_end - p < static_cast<ptrdiff_t>(UINT64_DEC_DIGITS)) *--p = '0';
+    };
+
+    while (n > std::numeric_limits<uint64_t>::max()) {
+        put(static_cast<uint64_t>(n % POW10[UINT64_DEC_DIGITS]), true);
+        n /= POW10[UINT64_DEC_DIGITS];
+    }
+    put(static_cast<uint64_t>(n), false);
+
+    return {p, end};
+}
+
+uint128_t ParseUInt128(std::string_view str)
+{
+    if (str.empty()) throw ContractFormatError("empty number");
+
+    uint128_t res = 0;
+    for (size_t pos = 0; pos < str.size(); pos += UINT64_DEC_DIGITS) {
+        auto chunk_str = str.substr(pos, UINT64_DEC_DIGITS);
+        uint64_t chunk = 0;
+        for (char c: chunk_str) {
+            if (c < '0' || c > '9') throw ContractFormatError("wrong number: " + std::string(str));
+            chunk = chunk * 10 + (c - '0');
+        }
+        uint64_t scale = POW10[chunk_str.size()];
+        if (res > (MAX_UINT128 - chunk) / scale) throw std::overflow_error("number is too large: " + std::string(str));
+        res = res * scale + chunk;
+    }
+    return res;
 }
 
 const char* RuneId::name_chain_height = "block";
@@ -92,75 +251,6 @@ const char* RuneStoneDestination::name_flags = "flags";
 const char* RuneStoneDestination::name_op_dictionary = "op_dictionary";
 
 
-tag_map_t RuneStone::tag_map = {
-    {RuneTag::FLAGS, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        r.action_flags = read_varint(p, end);
-    }},
-    {RuneTag::RUNE, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        r.rune = read_varint(p, end);
-    }},
-    {RuneTag::PREMINE_AMOUNT, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        r.premine_amount = read_varint(p, end);
-    }},
-    {RuneTag::MINT_CAP, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        r.mint_cap = read_varint(p, end);
-    }},
-    {RuneTag::PER_MINT_AMOUNT, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        r.per_mint_amount = read_varint(p, end);
-    }},
-    {RuneTag::MINT_HEIGHT_START, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint64_t>::max()) throw std::overflow_error("mint_height_start");
-        r.mint_height_start = static_cast<uint64_t>(v);
-    }},
-    {RuneTag::MINT_HEIGHT_END, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint64_t>::max()) throw std::overflow_error("mint_height_end");
-        r.mint_height_end = static_cast<uint64_t>(v);
-    }},
-    {RuneTag::MINT_OFFSET_START, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint64_t>::max()) throw std::overflow_error("mint_height_offset_start");
-        r.mint_height_offset_start = static_cast<uint64_t>(v);
-    }},
-    {RuneTag::MINT_OFFSET_END, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint64_t>::max()) throw std::overflow_error("mint_height_offset_end");
-        r.mint_height_offset_end = static_cast<uint64_t>(v);
-    }},
-    {RuneTag::POINTER, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint32_t>::max()) throw std::overflow_error("default_output");
-        r.default_output = static_cast<uint32_t>(v);
-    }},
-    {RuneTag::MINT, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (r.mint_rune_id) {
-            if (v > std::numeric_limits<uint32_t>::max()) throw std::overflow_error("mint_rune_id.tx_index");
-            r.mint_rune_id->tx_index = static_cast<uint32_t>(v);
-        }
-        else {
-            if (v > std::numeric_limits<uint64_t>::max()) throw std::overflow_error("mint_rune_id.chain_height");
-            r.mint_rune_id.emplace(static_cast<uint64_t>(v), 0);
-        }
-    }},
-    {RuneTag::DIVISIBILITY, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint8_t>::max()) throw std::overflow_error("divisibility");
-        r.divisibility= static_cast<uint8_t>(v);
-    }},
-    {RuneTag::SPACERS, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<uint32_t>::max()) throw std::overflow_error("spacers");
-        r.spacers = static_cast<uint32_t>(v);
-    }},
-    {RuneTag::SYMBOL, [](RuneStone& r, bytevector::const_iterator& p, bytevector::const_iterator end){
-        uint128_t v = read_varint(p, end);
-        if (v > std::numeric_limits<wchar_t>::max()) throw std::overflow_error("symbol");
-        r.symbol = static_cast<wchar_t>(v);
-    }},
-};
-
 bytevector RuneStoneDestination::Commit() const
 {
     if (!rune) throw ContractTermMissing(name_rune);
@@ -175,194 +265,154 @@ bytevector RuneStoneDestination::Commit() const
 }
 
 
-void RuneStone::Unpack(const bytevector& data)
+void RuneStone::Unpack(std::span<const uint8_t> data)
 {
-    auto p = data.begin();
-    while(p != data.end() && *p != (uint8_t)RuneTag::BODY) {
-        if (p+1 == data.end()) throw ContractFormatError("RuneStone length: " + std::to_string(data.size()));
-
-        RuneTag tag = (RuneTag)*p++;
-
-        auto tag_it = tag_map.find(tag);
-
-        if (tag_it != tag_map.end())
-            try {
-                tag_it->second(*this, p, data.end());
-            }
-            catch(...) {
-                std::throw_with_nested(ContractFormatError("RuneStone tag " + std::to_string((int)tag)));
-            }
-        else
-            try {
-                read_varint(p, data.end()); // just to skip unknown tag value
-            }
-            catch(...){}
-    }
-
-    if (p != data.end()) {
-
-        if (*p != (uint8_t)RuneTag::BODY) throw ContractFormatError("Wrong RuneStone value after tags: " + std::to_string((int) *p));
-
-        RuneId id;
-        for (++p; p != data.end();) {
-            try {
-                uint128_t chain_height = read_varint(p, data.end());
-                uint128_t tx_number = read_varint(p, data.end());
-                uint128_t amount = read_varint(p, data.end());
-                uint128_t output = read_varint(p, data.end());
-
-
-                id += {static_cast<uint32_t>(chain_height), static_cast<uint32_t>(tx_number)};
-
-                op_dictionary.emplace(id, std::make_tuple(amount, static_cast<uint32_t>(output)));
-            }
-            catch(...) {
-                std::throw_with_nested(ContractFormatError("RuneStone dictionary"));
+    std::vector<uint128_t> integers;
+    integers.reserve(data.size());
+    try {
+        for (const uint8_t* p = data.data(), *end = p + data.size(); p != end; )
+            integers.push_back(read_varint(p, end));
+    }
+    catch (...) {
+        // Malformed varint: nothing is taken from the rune stone
+        *this = RuneStone();
+        cenotaph = true;
+        return;
+    }
+
+    RuneStoneFields fields;
+    for (size_t i = 0; i < integers.size(); i += 2) {
+        if (integers[i] == (uint8_t)RuneTag::BODY) {
+            RuneId id;
+            for (size_t j = i + 1; j < integers.size(); j += 4) {
+                if (j + 4 > integers.size() || !NextRuneId(id, integers[j], integers[j + 1]) || !Fits<uint32_t>(integers[j + 3])) {
+                    cenotaph = true;
+                    break;
+                }
+                op_dictionary.emplace(id, std::make_tuple(integers[j + 2], static_cast<uint32_t>(integers[j + 3])));
             }
+            break;
+        }
+        if (i + 1 == integers.size()) {
+            // Truncated field
+            cenotaph = true;
+            break;
+        }
+        fields.Add(integers[i], integers[i + 1]);
+    }
+
+    action_flags = fields.Take(RuneTag::FLAGS).value_or(0);
+
+    if (HasAction(RuneAction::ETCH)) {
+        divisibility = fields.Take<uint8_t>(RuneTag::DIVISIBILITY, MAX_DIVISIBILITY);
+        premine_amount = fields.Take(RuneTag::PREMINE_AMOUNT);
+        rune = fields.Take(RuneTag::RUNE);
+        spacers = fields.Take<uint32_t>(RuneTag::SPACERS, MAX_SPACERS);
+        // Symbol is a Unicode scalar value, i.e. not a surrogate
+        if (auto v = fields.Take<uint32_t>(RuneTag::SYMBOL, 0x10FFFF); v && (*v < 0xD800 || *v > 0xDFFF))
+            symbol = static_cast<wchar_t>(*v);
+
+        if (HasAction(RuneAction::TERMS)) {
+            mint_cap = fields.Take(RuneTag::MINT_CAP);
+            per_mint_amount = fields.Take(RuneTag::PER_MINT_AMOUNT);
+            mint_height_start = fields.Take<uint64_t>(RuneTag::MINT_HEIGHT_START);
+            mint_height_end = fields.Take<uint64_t>(RuneTag::MINT_HEIGHT_END);
+            mint_height_offset_start = fields.Take<uint64_t>(RuneTag::MINT_OFFSET_START);
+            mint_height_offset_end = fields.Take<uint64_t>(RuneTag::MINT_OFFSET_END);
         }
-    }
-}
-
-bytevector RuneStone::Pack() const
-{
-    bytevector res;
-    bytevector buf;
-
-    if (action_flags != 0) {
-        buf = write_varint(action_flags);
-        res.push_back((uint8_t)RuneTag::FLAGS);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (rune) {
-        buf = write_varint(*rune);
-        res.push_back((uint8_t)RuneTag::RUNE);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (spacers.value_or(0)) {
-        buf = write_varint(*spacers);
-        res.push_back((uint8_t)RuneTag::SPACERS);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (symbol) {
-        buf = write_varint(*symbol);
-        res.push_back((uint8_t)RuneTag::SYMBOL);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (divisibility.value_or(0)) {
-        buf = write_varint(*divisibility);
-        res.push_back((uint8_t)RuneTag::DIVISIBILITY);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (premine_amount) {
-        buf = write_varint(*premine_amount);
-        res.push_back((uint8_t)RuneTag::PREMINE_AMOUNT);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (mint_cap) {
-        buf = write_varint(*mint_cap);
-        res.push_back((uint8_t)RuneTag::MINT_CAP);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
-
-    if (per_mint_amount) {
-        buf = write_varint(*per_mint_amount);
-        res.push_back((uint8_t)RuneTag::PER_MINT_AMOUNT);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
 
-    if (mint_height_start) {
-        buf = write_varint(*mint_height_start);
-        res.push_back((uint8_t)RuneTag::MINT_HEIGHT_START);
-        res.insert(res.end(), buf.begin(), buf.end());
+        // Whole supply has to fit 128 bit, so balances never overflow
+        uint128_t premine = premine_amount.value_or(0);
+        uint128_t amount = per_mint_amount.value_or(0);
+        if (amount && mint_cap.value_or(0) > (MAX_UINT128 - premine) / amount) cenotaph = true;
     }
 
-    if (mint_height_end) {
-        buf = write_varint(*mint_height_end);
-        res.push_back((uint8_t)RuneTag::MINT_HEIGHT_END);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
+    mint_rune_id = fields.TakeRuneId(RuneTag::MINT);
+    default_output = fields.Take<uint32_t>(RuneTag::POINTER);
 
-    if (mint_height_offset_start) {
-        buf = write_varint(*mint_height_offset_start);
-        res.push_back((uint8_t)RuneTag::MINT_OFFSET_START);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
+    const uint128_t known_flags = (uint128_t(1) << (uint8_t)RuneAction::ETCH)
+                                | (uint128_t(1) << (uint8_t)RuneAction::TERMS)
+                                | (uint128_t(1) << (uint8_t)RuneAction::TURBO);
+    if (action_flags & ~known_flags) cenotaph = true;
 
-    if (mint_height_offset_end) {
-        buf = write_varint(*mint_height_offset_end);
-        res.push_back((uint8_t)RuneTag::MINT_OFFSET_END);
-        res.insert(res.end(), buf.begin(), buf.end());
-    }
+    // Odd tags left over are safe to ignore
+    if (fields.HasEvenTag()) cenotaph = true;
+}
 
-    if (mint_rune_id) {
-        buf = write_varint(mint_rune_id->chain_height);
-        res.push_back((uint8_t)RuneTag::MINT);
-        res.insert(res.end(), buf.begin(), buf.end());
+namespace {
 
-        buf = write_varint(mint_rune_id->tx_index);
-        res.push_back((uint8_t)RuneTag::MINT);
-        res.insert(res.end(), buf.begin(), buf.end());
+void WriteRuneStone(const RuneStone& r, RuneStoneWriter& res)
+{
+    if (r.action_flags != 0) res.Field(RuneTag::FLAGS, r.action_flags);
+    if (r.rune) res.Field(RuneTag::RUNE, *r.rune);
+    if (r.spacers.value_or(0)) res.Field(RuneTag::SPACERS, *r.spacers);
+    if (r.symbol) res.Field(RuneTag::SYMBOL, static_cast<uint32_t>(*r.symbol));
+    if (r.divisibility.value_or(0)) res.Field(RuneTag::DIVISIBILITY, *r.divisibility);
+    if (r.premine_amount) res.Field(RuneTag::PREMINE_AMOUNT, *r.premine_amount);
+    if (r.mint_cap) res.Field(RuneTag::MINT_CAP, *r.mint_cap);
+    if (r.per_mint_amount) res.Field(RuneTag::PER_MINT_AMOUNT, *r.per_mint_amount);
+    if (r.mint_height_start) res.Field(RuneTag::MINT_HEIGHT_START, *r.mint_height_start);
+    if (r.mint_height_end) res.Field(RuneTag::MINT_HEIGHT_END, *r.mint_height_end);
+    if (r.mint_height_offset_start) res.Field(RuneTag::MINT_OFFSET_START, *r.mint_height_offset_start);
+    if (r.mint_height_offset_end) res.Field(RuneTag::MINT_OFFSET_END, *r.mint_height_offset_end);
+
+    if (r.mint_rune_id) {
+        res.Field(RuneTag::MINT, r.mint_rune_id->chain_height);
+        res.Field(RuneTag::MINT, r.mint_rune_id->tx_index);
     }
 
     uint128_t max_amount = 0;
     uint32_t max_amount_nout = 0;
-    if (default_output) {
-        buf = write_varint(*default_output);
-        res.push_back((uint8_t)RuneTag::POINTER);
-        res.insert(res.end(), buf.begin(), buf.end());
+    if (r.default_output) {
+        res.Field(RuneTag::POINTER, *r.default_output);
     }
     else {
-        for (const auto& entry: op_dictionary) {
+        for (const auto& entry: r.op_dictionary) {
             if (get<0>(entry.second) > max_amount) {
                 max_amount = get<0>(entry.second);
                 max_amount_nout = get<1>(entry.second);
             }
         }
-        if (max_amount > 0) {
-            buf = write_varint(max_amount_nout);
-            res.push_back((uint8_t)RuneTag::POINTER);
-            res.insert(res.end(), buf.begin(), buf.end());
-        }
+        if (max_amount > 0) res.Field(RuneTag::POINTER, max_amount_nout);
     }
 
-    if ((!op_dictionary.empty()) && (default_output || op_dictionary.size() > 1)) { // Skip the dictionary with single entry in favor of the default output
+    if ((!r.op_dictionary.empty()) && (r.default_output || r.op_dictionary.size() > 1)) { // Skip the dictionary with single entry in favor of the default output
         RuneId id;
-        res.push_back((uint8_t)RuneTag::BODY);
-        for (const auto& entry: op_dictionary) {
+        res.Byte((uint8_t)RuneTag::BODY);
+        for (const auto& entry: r.op_dictionary) {
 
             if (max_amount > 0 && max_amount_nout == get<1>(entry.second)) // Skip the entry in favor of the default_output
                 continue;
 
             id = entry.first - id;
-            buf = write_varint(id.chain_height);
-            res.insert(res.end(), buf.begin(), buf.end());
-
-            buf = write_varint(id.tx_index);
-            res.insert(res.end(), buf.begin(), buf.end());
-
-            buf = write_varint(get<0>(entry.second));
-            res.insert(res.end(), buf.begin(), buf.end());
-
-            buf = write_varint(get<1>(entry.second));
-            res.insert(res.end(), buf.begin(), buf.end());
+            res.VarInt(id.chain_height);
+            res.VarInt(id.tx_index);
+            res.VarInt(get<0>(entry.second));
+            res.VarInt(get<1>(entry.second));
 
             id = entry.first;
         }
     }
+}
 
-    if (res.size() > 80) {
-        std::ostringstream errbuf;
-        errbuf << RuneStoneDestination::type << " is too large: " << res.size();
-        throw ContractTermWrongValue(errbuf.str());
-    }
+}
 
-    return res;
+size_t RuneStone::PackedSize() const
+{
+    RuneStoneWriter res;
+    WriteRuneStone(*this, res);
+    return res.Size();
+}
+
+bytevector RuneStone::Pack() const
+{
+    RuneStoneWriter res;
+    WriteRuneStone(*this, res);
+
+    if (res.Size() > RUNESTONE_MAX_SIZE)
+        throw ContractTermWrongValue(std::string(RuneStoneDestination::type) + " is too large: " + std::to_string(res.Size()));
+
+    return res.Data();
 }
 
 std::string Rune::RuneText(const std::string& space) const
@@ -387,15 +437,15 @@ UniValue RuneStoneDestination::MakeJson() const
     UniValue res(UniValue::VOBJ);
     res.pushKV(name_type, type);
     res.pushKV(name_amount, m_amount);
-    res.pushKV(name_flags, (std::ostringstream() << action_flags).view());
+    res.pushKV(name_flags, FormatUInt128(action_flags));
 
-    if (rune) res.pushKV(name_rune, (std::ostringstream() << *rune).view());
+    if (rune) res.pushKV(name_rune, FormatUInt128(*rune));
     if (symbol) res.pushKV(name_symbol, (uint32_t)*symbol);
     if (spacers) res.pushKV(name_spacers, *spacers);
     if (divisibility) res.pushKV(name_divisibility, *divisibility);
-    if (premine_amount) res.pushKV(name_premine_amount, (std::ostringstream() << *premine_amount).view());
-    if (mint_cap) res.pushKV(name_mint_cap, (std::ostringstream() << *mint_cap).view());
-    if (per_mint_amount) res.pushKV(name_per_mint_amount, (std::ostringstream() << *per_mint_amount).view());
+    if (premine_amount) res.pushKV(name_premine_amount, FormatUInt128(*premine_amount));
+    if (mint_cap) res.pushKV(name_mint_cap, FormatUInt128(*mint_cap));
+    if (per_mint_amount) res.pushKV(name_per_mint_amount, FormatUInt128(*per_mint_amount));
     if (mint_height_start) res.pushKV(name_mint_height_start, *mint_height_start);
     if (mint_height_end) res.pushKV(name_mint_height_end, *mint_height_end);
     if (mint_height_offset_start) res.pushKV(name_mint_height_offset_start, *mint_height_offset_start);
@@ -418,8 +468,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
 
     {   const UniValue& val = json[name_flags];
         if (val.isNull()) throw ContractTermMissing(move((lazy_name() += '.') += name_flags));
-            uint128_t r;
-            std::istringstream(val.getValStr()) >> r;
+            uint128_t r = ReadUInt128(val, [&](){ return (lazy_name() += '.') += name_flags; });
             if (action_flags) {
                 if (action_flags != r) throw ContractTermMismatch(move((lazy_name() += '.') += name_flags));
             }
@@ -428,8 +477,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
     }
     {   const UniValue& val = json[name_rune];
         if (!val.isNull()) {
-            uint128_t r;
-            std::istringstream(val.getValStr()) >> r;
+            uint128_t r = ReadUInt128(val, [&](){ return (lazy_name() += '.') += name_rune; });
             if (rune) {
                 if (*rune != r) throw ContractTermMismatch(move((lazy_name() += '.') += name_rune));
             }
@@ -462,8 +510,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
     }
     {   const UniValue& val = json[name_premine_amount];
         if (!val.isNull()) {
-            uint128_t r;
-            std::istringstream(val.getValStr()) >> r;
+            uint128_t r = ReadUInt128(val, [&](){ return (lazy_name() += '.') += name_premine_amount; });
             if (premine_amount) {
                 if (*premine_amount != r) throw ContractTermMismatch(move((lazy_name() += '.') += name_premine_amount));
             }
@@ -472,8 +519,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
     }
     {   const UniValue& val = json[name_mint_cap];
         if (!val.isNull()) {
-            uint128_t r;
-            std::istringstream(val.getValStr()) >> r;
+            uint128_t r = ReadUInt128(val, [&](){ return (lazy_name() += '.') += name_mint_cap; });
             if (mint_cap) {
                 if (*mint_cap != r) throw ContractTermMismatch(move((lazy_name() += '.') += name_mint_cap));
             }
@@ -482,8 +528,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
     }
     {   const UniValue& val = json[name_per_mint_amount];
         if (!val.isNull()) {
-            uint128_t r;
-            std::istringstream(val.getValStr()) >> r;
+            uint128_t r = ReadUInt128(val, [&](){ return (lazy_name() += '.') += name_per_mint_amount; });
             if (per_mint_amount) {
                 if (*per_mint_amount != r) throw ContractTermMismatch(move((lazy_name() += '.') += name_per_mint_amount));
             }
@@ -555,7 +600,7 @@ void RuneStoneDestination::ReadJson(const UniValue &json, const std::function<st
 
 std::shared_ptr<IContractDestination> RuneStoneDestination::Construct(ChainMode chain, const UniValue &json, const std::function<std::string()>& lazy_name)
 {
-    return std::make_shared<RuneStoneDestination>(chain, json, lazy_name);
+    return MakeContractObject<RuneStoneDestination>(chain, json, lazy_name);
 }
 
 UniValue RuneStoneDestination::MakeOpDictionaryJson(const std::multimap<RuneId, std::tuple<uint128_t, uint32_t>>& op_dictionary)
@@ -563,7 +608,7 @@ UniValue RuneStoneDestination::MakeOpDictionaryJson(const std::multimap<RuneId,
     UniValue opsVal(UniValue::VARR);
     for (const auto& op: op_dictionary) {
         UniValue opVal = op.first.MakeJson();
-        opVal.pushKV(name_amount, (std::ostringstream() << get<0>(op.second)).view());
+        opVal.pushKV(name_amount, FormatUInt128(get<0>(op.second)));
         opVal.pushKV(IContractBuilder::name_nout, get<1>(op.second));
 
         opsVal.push_back(move(opVal));
@@ -584,8 +629,7 @@ void RuneStoneDestination::ReadOpDictionaryJson(const UniValue &val, std::multim
         if (opVal[name_amount].isNull()) throw ContractTermMissing((std::ostringstream() << lazy_name()  << '[' << i << "]." << name_amount).str());
         if (opVal[IContractBuilder::name_nout].isNull()) throw ContractTermMissing((std::ostringstream() << lazy_name() << '[' << i << "]." << IContractBuilder::name_nout).str());
 
-        uint128_t amount;
-        std::istringstream(opVal[name_amount].getValStr()) >> amount;
+        uint128_t amount = ReadUInt128(opVal[name_amount], [&](){ return lazy_name() + '[' + std::to_string(i) + "]." + name_amount; });
 
         if (dict_empty) {
             op_dictionary.emplace(id, std::make_tuple(move(amount), opVal[IContractBuilder::name_nout].getInt<uint32_t>()));
@@ -600,68 +644,100 @@ void RuneStoneDestination::ReadOpDictionaryJson(const UniValue &val, std::multim
     }
 }
 
-std::optional<RuneStone> ParseRuneStone(const string &hex_tx, ChainMode chain)
+namespace {
+
+template <typename TX>
+std::optional<RuneStone> ParseTxRuneStone(const TX& tx, ChainMode chain)
 {
     std::optional<RuneStone> res;
-    auto tx = l15::DecodeHexTx(hex_tx);
 
     for (const auto& out: tx.vout) {
-        if (out.scriptPubKey.front() != OP_RETURN) continue;
+        if (out.scriptPubKey.empty() || out.scriptPubKey.front() != OP_RETURN) continue;
 
         auto it = out.scriptPubKey.begin() + 1;
 
         opcodetype op;
-        bytevector data;
-
-        if (out.scriptPubKey.GetOp(it, op, data)) {
-            if (chain != MAINNET && op == 9 && std::equal(data.begin(), data.end(), RUNE_TEST_HEADER)) {
-                if (out.scriptPubKey.GetOp(it, op, data)) {
-                    res.emplace();
-                    res->Unpack(data);
-                    break;
+        std::span<const uint8_t> data;
+
+        if (GetPushData(out.scriptPubKey, it, op, data)) {
+            if (op == OP_13) {
+                // Payload is borrowed from the script unless it is split into several pushes
+                std::span<const uint8_t> payload;
+                bytevector joined;
+                for (size_t i = 0; it != out.scriptPubKey.end(); ++i) {
+                    // Opcode or truncated push in the payload makes a cenotaph
+                    if (!GetPushData(out.scriptPubKey, it, op, data) || op > OP_PUSHDATA4) {
+                        res.emplace();
+                        res->cenotaph = true;
+                        return res;
+                    }
+                    if (i == 0) {
+                        payload = data;
+                    }
+                    else {
+                        if (joined.empty()) joined.assign(payload.begin(), payload.end());
+                        joined.insert(joined.end(), data.begin(), data.end());
+                        payload = joined;
+                    }
                 }
+                res.emplace();
+                res->Unpack(payload);
+                break;
             }
-            else if (chain == MAINNET && op == 4 && std::equal(data.begin(), data.end(), RUNE_HEADER)) {
-                if (out.scriptPubKey.GetOp(it, op, data)) {
-                    res.emplace();
-                    res->Unpack(data);
-                    break;
-                }
+            else if (chain != MAINNET && op == 9 && std::equal(data.begin(), data.end(), RUNE_TEST_HEADER)) {
+                // Legacy test network header, mainnet rune stone is recognized by OP_13 only
+                res.emplace();
+                if (GetPushData(out.scriptPubKey, it, op, data) && op <= OP_PUSHDATA4) res->Unpack(data);
+                else res->cenotaph = true;
+                break;
             }
         }
     }
     return res;
 }
 
-uint128_t EncodeRune(const std::string &text_rune)
+}
+
+std::optional<RuneStone> ParseRuneStone(const string &hex_tx, ChainMode chain)
+{
+    return ParseTxRuneStone(l15::DecodeHexTx(hex_tx), chain);
+}
+
+std::optional<RuneStone> ParseRuneStone(const CTransaction& tx, ChainMode chain)
 {
-    static const int136_t MAX_RUNE = std::numeric_limits<uint128_t>::max();
+    return ParseTxRuneStone(tx, chain);
+}
 
+uint128_t EncodeRune(const std::string &text_rune)
+{
     if (text_rune.empty()) throw ContractFormatError("cannot encode empty string as Rune");
 
-    int136_t n = -1;
-
-    for (auto ch: text_rune ) {
+    uint128_t n = 0;
+    for (size_t i = 0; i < text_rune.size(); ++i) {
+        char ch = text_rune[i];
         if (ch < 'A' || ch > 'Z') throw ContractFormatError("wrong letter to encode as Rune: '" + std::to_string(ch) + "'");
 
-        n = (n + 1) * 26;
-        n += ch - 'A';
-
-        if (n > MAX_RUNE) throw ContractFormatError("Rune is too large");
+        unsigned digit = ch - 'A';
+        if (i > 0) {
+            // n = (n + 1) * 26 + digit has to fit 128 bit
+            if (n > (MAX_UINT128 - digit) / 26 - 1) throw ContractFormatError("Rune is too large");
+            n = (n + 1) * 26;
+        }
+        n += digit;
     }
 
-    return uint128_t(n);
+    return n;
 }
 
 std::string DecodeRune(uint128_t n)
 {
-    std::ostringstream buf;
+    std::string res;
+    res.reserve(28);
     for ( ; n > 25; n = n / 26 - 1) {
-        uint128_t idx = n % 26;
-        buf.put((char) ('A' + idx));
+        res.push_back(static_cast<char>('A' + static_cast<unsigned>(n % 26)));
     }
-    buf.put((char)('A' + n));
-    return std::string(buf.view().rbegin(), buf.view().rend());
+    res.push_back(static_cast<char>('A' + static_cast<unsigned>(n)));
+    return {res.rbegin(), res.rend()};
 }
 
 std::string AddSpaces(const std::string& text_rune, uint32_t spacers, const std::string& space)
@@ -5,17 +5,26 @@
 
 #include <optional>
 #include <tuple>
+#include <span>
+#include <string_view>
 
 namespace utxord {
 
 const uint8_t MAX_DIVISIBILITY = 38;
 const uint32_t MAX_SPACERS = 0x7fff;
+const size_t RUNESTONE_MAX_SIZE = 80;
+// The first reserved rune name: AAAAAAAAAAAAAAAAAAAAAAAAAAA. Etching without a name gets RESERVED_RUNE + (block << 32 | tx)
+const uint128_t RESERVED_RUNE = (uint128_t(0x4d10cef280da966ull) << 64) | 0xfa0704602570a3d6ull;
 
 template <typename I>
 uint128_t read_varint(I& i, I end);
 template <typename INT>
 bytevector write_varint(INT n);
 
+// Decimal conversion of rune numbers w/o iostreams
+std::string FormatUInt128(uint128_t n);
+uint128_t ParseUInt128(std::string_view str);
+
 uint128_t EncodeRune(const std::string& text_rune);
 std::string DecodeRune(uint128_t rune);
 
@@ -44,13 +53,12 @@ enum class RuneTag: uint8_t
     NOP = 127,
 };
 
-typedef boost::container::flat_map<RuneTag, std::function<void(struct RuneStone&, bytevector::const_iterator&, bytevector::const_iterator)>> tag_map_t;
-
 enum class RuneAction: uint8_t
 {
     ETCH = 0,
     TERMS = 1,
-    BURN = 127
+    TURBO = 2,
+    BURN = 127 // Not a valid action: the flag makes a cenotaph as any other unknown one
 };
 
 struct RuneId: IJsonSerializable
@@ -94,7 +102,7 @@ struct RuneId: IJsonSerializable
 
 struct RuneStone
 {
-    uint128_t action_flags;
+    uint128_t action_flags = 0;
 
     std::optional<uint32_t> spacers;
     std::optional<uint128_t> rune;
@@ -116,12 +124,16 @@ struct RuneStone
 
     std::multimap<RuneId, std::tuple<uint128_t, uint32_t>> op_dictionary; // rune_id -> {rune_amount, nout}
 
+    // Set by Unpack() for a malformed rune stone: the well-formed fields are still taken since mint and etching apply
+    bool cenotaph = false;
+
     void AddAction(RuneAction action) { action_flags |= (uint128_t(1) << (uint8_t)action); }
+    bool HasAction(RuneAction action) const { return (action_flags & (uint128_t(1) << (uint8_t)action)) != 0; }
 
     bytevector Pack() const;
-    void Unpack(const bytevector& data);
-
-    static tag_map_t tag_map;
+    // Encoded size w/o the limit check, so a caller may check if one more edict fits
+    size_t PackedSize() const;
+    void Unpack(std::span<const uint8_t> data);
 };
 
 class RuneStoneDestination: public IContractDestination, public RuneStone
@@ -167,7 +179,7 @@ public:
     const char* Type() const override
     { return type; }
 
-    void Amount(CAmount amount) override { m_amount = amount; }
+    void Amount(CAmount amount) override { m_amount = amount; BumpContractGeneration(); }
     CAmount Amount() const final { return m_amount; }
 
     std::string Address() const override { return {}; }
@@ -246,6 +258,8 @@ public:
 };
 
 
+// Returns nullopt if the transaction has no rune stone; a malformed one is returned with the cenotaph flag set
 std::optional<RuneStone> ParseRuneStone(const std::string& hex_tx, ChainMode chain);
+std::optional<RuneStone> ParseRuneStone(const CTransaction& tx, ChainMode chain);
 
 }
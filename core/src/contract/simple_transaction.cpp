@@ -39,22 +39,27 @@ const char* SimpleTransaction::s_versions = "[2,3,4,5]";
 const std::string& SimpleTransaction::GetContractName() const
 { return val_simple_transaction; }
 
+std::tuple<CScript, std::vector<bytevector>> SimpleTransaction::DummyInput(const std::string& params) const
+{
+    if (params.find("p2wpkh_utxo") != std::string::npos)
+        return {CScript(), { bytevector(72), bytevector(33) }};
+    else if (params.find("p2pkh_utxo") != std::string::npos)
+        return {CScript() << signature() << compressed_pubkey().as_vector(), {}};
+    else
+        return {CScript(), { signature() }};
+}
+
 CMutableTransaction SimpleTransaction::MakeTx(const std::string& params) const
 {
     CMutableTransaction tx;
 
     if (m_inputs.empty()) {
         tx.vin.emplace_back(Txid(), 0);
-        if (params.find("p2wpkh_utxo"))
-            tx.vin.back().scriptWitness.stack = P2WPKH(chain(), 0, "").DummyWitness();
-        else if (params.find("p2pkh_utxo"))
-            tx.vin.back().scriptSig = P2PKH(chain(), 0, "").DummyScriptSig();
-        else
-            tx.vin.back().scriptWitness.stack = P2TR(chain(), 0, "").DummyWitness();
+        std::tie(tx.vin.back().scriptSig, tx.vin.back().scriptWitness.stack) = DummyInput(params);
     }
     else {
         for (const auto &input: m_inputs) {
-            tx.vin.emplace_back(Txid::FromUint256(uint256S(input.output->TxID())), input.output->NOut(), input.scriptSig);
+            tx.vin.emplace_back(input.output->OutPoint(), input.scriptSig);
             tx.vin.back().scriptWitness.stack = input.witness;
             if (tx.vin.back().scriptWitness.stack.empty()) {
                 tx.vin.back().scriptWitness.stack = input.output->Destination()->DummyWitness();
@@ -80,7 +85,7 @@ void SimpleTransaction::AddRuneInput(std::shared_ptr<IContractOutput> prevout, R
 
 void SimpleTransaction::AddRuneUTXO(std::string txid, uint32_t nout, CAmount btc_amount, std::string addr, RuneId runeid, uint128_t rune_amount)
 {
-    AddRuneInput(std::make_shared<UTXO>(chain(), move(txid), nout, btc_amount, move(addr)), move(runeid), move(rune_amount));
+    AddRuneInput(MakeContractObject<UTXO>(chain(), move(txid), nout, btc_amount, move(addr)), move(runeid), move(rune_amount));
 }
 
 void SimpleTransaction::AddRuneOutput(CAmount btc_amount, std::string addr, RuneId runeid, uint128_t rune_amount)
@@ -100,12 +105,13 @@ void SimpleTransaction::AddRuneOutputDestination(std::shared_ptr<IContractDestin
         if (!rune_stone) throw ContractTermMismatch("Not RuneStone output: " + std::to_string(*m_runestone_nout));
     }
     else {
-        rune_stone = std::make_shared<RuneStoneDestination>(chain());
+        rune_stone = MakeContractObject<RuneStoneDestination>(chain());
         m_outputs.push_back(rune_stone);
         m_runestone_nout = m_outputs.size() - 1;
     }
 
     rune_stone->op_dictionary.emplace(move(runeid), std::make_tuple(move(rune_amount), transfer_nout));
+    ResetTxCache();
 }
 
 void SimpleTransaction::BurnRune(RuneId runeid, uint128_t rune_amount)
@@ -116,12 +122,13 @@ void SimpleTransaction::BurnRune(RuneId runeid, uint128_t rune_amount)
         if (!rune_stone) throw ContractStateError("Not a RuneStone output: " + std::to_string(*m_runestone_nout));
     }
     else {
-        rune_stone = std::make_shared<RuneStoneDestination>(chain());
+        rune_stone = MakeContractObject<RuneStoneDestination>(chain());
         m_outputs.push_back(rune_stone);
         m_runestone_nout = m_outputs.size() - 1;
     }
 
     rune_stone->op_dictionary.emplace(move(runeid), std::make_tuple(move(rune_amount), *m_runestone_nout));
+    ResetTxCache();
 }
 
 void SimpleTransaction::AddChangeOutput(std::string addr)
@@ -129,6 +136,7 @@ void SimpleTransaction::AddChangeOutput(std::string addr)
     if (!m_mining_fee_rate) throw ContractStateError(name_mining_fee_rate + " not defined");
 
     if (m_change_nout) {
+        if (m_weight) m_weight->RemoveOutput(*m_outputs[*m_change_nout]);
         m_outputs.erase(m_outputs.begin() + *m_change_nout);
         m_change_nout.reset();
     }
@@ -144,21 +152,25 @@ void SimpleTransaction::AddChangeOutput(std::string addr)
         m_change_nout = m_outputs.size() - 1;
     }
     else {
-       m_outputs.pop_back();
+        if (m_weight) m_weight->RemoveOutput(*m_outputs.back());
+        m_outputs.pop_back();
     }
+    ResetTx();
 }
 
 void SimpleTransaction::DropChangeOutput()
 {
     if (m_change_nout) {
+        if (m_weight) m_weight->RemoveOutput(*m_outputs[*m_change_nout]);
         m_outputs.erase(m_outputs.begin() + *m_change_nout);
         m_change_nout.reset();
+        ResetTx();
     }
 }
 
 
 void SimpleTransaction::PartialSign(const KeyRegistry &master_key, const string &key_filter_tag, uint32_t nin) {
-    CMutableTransaction tx = MakeTx("");
+    const CMutableTransaction& tx = GetTx();
 
     std::vector<CTxOut> spent_outs;
     spent_outs.reserve(m_inputs.size());
@@ -172,7 +184,8 @@ void SimpleTransaction::PartialSign(const KeyRegistry &master_key, const string
     auto dest = inputIt->output->Destination();
     auto signer = dest->LookupKey(master_key, key_filter_tag);
 
-    signer->SignInput(*inputIt, tx, spent_outs, SIGHASH_ALL);
+    signer->SignInput(*inputIt, TxSigningContext(tx, move(spent_outs)), SIGHASH_ALL);
+    ResetTxCache();
 }
 
 void SimpleTransaction::Sign(const KeyRegistry &master_key, const std::string& key_filter_tag)
@@ -180,7 +193,7 @@ void SimpleTransaction::Sign(const KeyRegistry &master_key, const std::string& k
     if (m_inputs.empty()) throw ContractStateError(std::string(name_utxo) + " not defined");
     if (m_outputs.empty()) throw ContractStateError(name_outputs + " not defined");
 
-    CMutableTransaction tx = MakeTx("");
+    const CMutableTransaction& tx = GetTx();
 
     std::vector<CTxOut> spent_outs;
     spent_outs.reserve(m_inputs.size());
@@ -188,16 +201,25 @@ void SimpleTransaction::Sign(const KeyRegistry &master_key, const std::string& k
         spent_outs.emplace_back(input.output->Destination()->TxOutput());
     }
 
-    for(auto& input: m_inputs) {
-        auto dest = input.output->Destination();
-        auto signer = dest->LookupKey(master_key, key_filter_tag);
-        signer->SignInput(input, tx, spent_outs, SIGHASH_ALL);
+    TxSigningContext ctx(tx, move(spent_outs));
+
+    // Key lookup goes through the registry cache, so it stays serial
+    std::vector<std::shared_ptr<ISigner>> signers = SignerCache(master_key, key_filter_tag).Signers(m_inputs);
+
+    try {
+        ForEachInput(m_inputs.size(), [&](size_t i) { signers[i]->SignInput(m_inputs[i], ctx, SIGHASH_ALL); });
     }
+    catch (...) {
+        // Some inputs may already be signed
+        ResetTxCache();
+        throw;
+    }
+    ResetTxCache();
 }
 
 std::vector<std::string> SimpleTransaction::RawTransactions() const
 {
-    return {l15::EncodeHexTx(MakeTx("")) };
+    return {l15::EncodeHexTx(GetTx()) };
 }
 
 UniValue SimpleTransaction::MakeJson(uint32_t version, TxPhase phase) const
@@ -240,6 +262,8 @@ UniValue SimpleTransaction::MakeJson(uint32_t version, TxPhase phase) const
 
 void SimpleTransaction::ReadJson(const UniValue& contract, TxPhase phase)
 {
+    ResetTxCache();
+
     uint32_t version = contract[name_version].getInt<uint32_t>();
     if (version != s_protocol_version &&
         version != s_protocol_version_no_nested_segwit_sign &&
@@ -304,17 +328,21 @@ CAmount SimpleTransaction::GetMinFundingAmount(const std::string& params) const
     if (!m_mining_fee_rate) throw ContractStateError(name_mining_fee_rate + " not defined");
 
     CAmount total_out = std::accumulate(m_outputs.begin(), m_outputs.end(), 0, [](CAmount s, const auto& d) { return s + d->Amount(); });
-    return l15::CalculateTxFee(*m_mining_fee_rate, MakeTx(params)) + total_out;
+    return CalculateWholeFee(params) + total_out;
 }
 
-void SimpleTransaction::CheckContractTerms(uint32_t version, TxPhase phase) const
+const TxWeight& SimpleTransaction::GetWeight() const
 {
-#ifndef DEBUG
-    using int136_t = boost::multiprecision::number<boost::multiprecision::cpp_int_backend<128, 136, boost::multiprecision::signed_magnitude, boost::multiprecision::unchecked, void>>;
-#else
-    using int136_t = boost::multiprecision::number<boost::multiprecision::debug_adaptor<boost::multiprecision::cpp_int_backend<128, 136, boost::multiprecision::signed_magnitude, boost::multiprecision::unchecked, void>>>;
-#endif
+    if (!m_weight) {
+        m_weight.emplace();
+        for (const auto& input: m_inputs) m_weight->AddInput(input);
+        for (const auto& out: m_outputs) m_weight->AddOutput(*out);
+    }
+    return *m_weight;
+}
 
+void SimpleTransaction::CheckContractTerms(uint32_t version, TxPhase phase) const
+{
     if (m_runestone_nout || !m_rune_inputs.empty()) {
         std::shared_ptr<RuneStoneDestination> rune_stone;
         if (m_runestone_nout) {
@@ -323,12 +351,19 @@ void SimpleTransaction::CheckContractTerms(uint32_t version, TxPhase phase) cons
         }
         else throw ContractStateError("RuneStone");
 
-        std::map<RuneId, int136_t> balances;
-
-        std::for_each(m_rune_inputs.begin(), m_rune_inputs.end(), [&balances](const auto& rune_in){ balances[rune_in.first] += get<0>(rune_in.second); });
-        std::for_each(rune_stone->op_dictionary.begin(), rune_stone->op_dictionary.end(), [&balances](const auto& rune_out) { balances[rune_out.first] -= get<0>(rune_out.second); });
-        for (const auto& bal: balances) {
-            if (bal.second != 0) throw ContractTermWrongValue((std::ostringstream() << "Non zero rune balance " << (std::string)bal.first << ": " << bal.second).str());
+        // Inputs and outputs are summed up separately, so an overflow check replaces wider signed arithmetic
+        std::map<RuneId, std::pair<uint128_t, uint128_t>> balances; // rune_id -> {input amount, output amount}
+        auto add_amount = [](const RuneId& id, uint128_t& sum, const uint128_t& amount) {
+            if (sum > MAX_UINT128 - amount) throw ContractTermWrongValue("Rune amount overflow " + (std::string)id);
+            sum += amount;
+        };
+
+        std::for_each(m_rune_inputs.begin(), m_rune_inputs.end(), [&](const auto& rune_in){ add_amount(rune_in.first, balances[rune_in.first].first, get<0>(rune_in.second)); });
+        std::for_each(rune_stone->op_dictionary.begin(), rune_stone->op_dictionary.end(), [&](const auto& rune_out) { add_amount(rune_out.first, balances[rune_out.first].second, get<0>(rune_out.second)); });
+        for (const auto& [id, bal]: balances) {
+            if (bal.first != bal.second)
+                throw ContractTermWrongValue("Non zero rune balance " + (std::string)id + ": " +
+                                             (bal.first > bal.second ? FormatUInt128(bal.first - bal.second) : '-' + FormatUInt128(bal.second - bal.first)));
         }
     }
 
@@ -356,7 +391,15 @@ TxPhase SimpleTransaction::ParsePhase(const std::string& str)
 
 CAmount SimpleTransaction::CalculateWholeFee(const string &params) const
 {
-    return l15::CalculateTxFee(*m_mining_fee_rate, MakeTx(params));
+    if (!m_mining_fee_rate) throw ContractStateError(name_mining_fee_rate + " not defined");
+
+    if (m_inputs.empty()) {
+        TxWeight weight = GetWeight();
+        auto [scriptSig, witness] = DummyInput(params);
+        weight.AddInput(scriptSig, witness);
+        return weight.Fee(*m_mining_fee_rate);
+    }
+    return GetWeight().Fee(*m_mining_fee_rate);
 }
 
 void SimpleTransaction::CheckSig() const
@@ -365,10 +408,10 @@ void SimpleTransaction::CheckSig() const
     spent_outs.reserve(m_inputs.size());
     std::transform(m_inputs.begin(), m_inputs.end(), cex::smartinserter(spent_outs, spent_outs.end()), [](const auto& txin){ return txin.output->Destination()->TxOutput(); });
 
-    CMutableTransaction tx = MakeTx("");
-    for (const auto &input: m_inputs) {
-        VerifyTxSignature(chain(), input.output->Destination()->Address(), tx, input.nin, spent_outs);
-    }
+    TxSigningContext ctx(GetTx(), move(spent_outs));
+    ForEachInput(m_inputs.size(), [&](size_t i) {
+        VerifyTxSignature(chain(), m_inputs[i].output->Destination()->Address(), ctx, m_inputs[i].nin);
+    });
 }
 
 } // l15::utxord
@@ -33,6 +33,57 @@ private:
 
     std::multimap<RuneId, std::tuple<uint128_t, uint32_t>> m_rune_inputs; // rune_id -> {rune_amount, nin}
 
+    // Built transaction and its txid are cached until inputs, outputs or witnesses are changed.
+    // Output amounts may be changed through the destinations and input outpoints may be changed by a parent contract,
+    // so the cached tx is re-validated against them once the contract generation moves.
+    mutable std::optional<CMutableTransaction> m_tx;
+    mutable std::optional<Txid> m_txid;
+    mutable uint64_t m_tx_generation = 0;
+    // Weight is updated in place when an input or output is added or removed, so fee calculation does not build the transaction
+    mutable std::optional<TxWeight> m_weight;
+
+    void ResetTx() const
+    {
+        // Contracts spending this one may have cached its txid
+        if (m_tx || m_txid) BumpContractGeneration();
+        m_tx.reset();
+        m_txid.reset();
+    }
+
+    void ResetTxCache()
+    {
+        ResetTx();
+        m_weight.reset();
+    }
+
+    bool TxTermsChanged() const
+    {
+        for (size_t i = 0; i < m_outputs.size(); ++i) {
+            if (m_tx->vout[i].nValue != m_outputs[i]->Amount()) return true;
+        }
+        for (size_t i = 0; i < m_inputs.size(); ++i) {
+            if (m_tx->vin[i].prevout != m_inputs[i].output->OutPoint()) return true;
+        }
+        return false;
+    }
+
+    const CMutableTransaction& GetTx() const
+    {
+        if (m_tx && m_tx_generation != ContractGeneration()) {
+            uint64_t generation = ContractGeneration();
+            if (TxTermsChanged()) ResetTx();
+            else m_tx_generation = generation;
+        }
+        if (!m_tx) {
+            m_tx_generation = ContractGeneration();
+            m_tx = MakeTx("");
+        }
+        return *m_tx;
+    }
+
+    const TxWeight& GetWeight() const;
+    std::tuple<CScript, std::vector<bytevector>> DummyInput(const std::string& params) const;
+
 public:
     explicit SimpleTransaction(ChainMode chain) : ContractBuilder(chain) {}
     SimpleTransaction(const SimpleTransaction&) = default;
@@ -62,10 +113,12 @@ public:
     {
         if (!prevout) throw ContractTermWrongValue(name_utxo + '[' + std::to_string(m_inputs.size()) + ']');
         m_inputs.emplace_back(chain(), m_inputs.size(), move(prevout));
+        ResetTx();
+        if (m_weight) m_weight->AddInput(m_inputs.back());
     }
 
     void AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr)
-    { AddInput(std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr))); }
+    { AddInput(MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr))); }
 
     void AddRuneInput(std::shared_ptr<IContractOutput> prevout, RuneId runeid, uint128_t rune_amount);
     void AddRuneUTXO(std::string txid, uint32_t nout, CAmount btc_amount, std::string addr, RuneId runeid, uint128_t rune_amount);
@@ -77,6 +130,8 @@ public:
     {
         if (!destination) throw ContractTermWrongValue(name_outputs + '[' + std::to_string(m_outputs.size()) + ']');
         m_outputs.emplace_back(move(destination));
+        ResetTx();
+        if (m_weight) m_weight->AddOutput(*m_outputs.back());
     }
 
     void AddRuneOutputDestination(std::shared_ptr<IContractDestination> destination, RuneId runeid, uint128_t rune_amount);
@@ -84,12 +139,16 @@ public:
     void BurnRune(RuneId runeid, uint128_t rune_amount);
 
     const std::vector<TxInput>& Inputs() const { return m_inputs; }
-    std::vector<TxInput>& Inputs() { return m_inputs; }
+    void SetInputWitness(uint32_t nin, size_t i, bytevector data)
+    {
+        m_inputs.at(nin).witness.Set(i, move(data));
+        ResetTxCache();
+    }
     std::vector<std::shared_ptr<IContractOutput>> Outputs() const
     {
         std::vector<std::shared_ptr<IContractOutput>> outputs(m_outputs.size());
-        for (auto [dest, i]: std::ranges::views::zip(m_outputs, std::ranges::views::iota(0))) {
-            outputs[i] = std::make_shared<UTXO>(chain(), TxID(), i, dest);
+        for (uint32_t i = 0; i < m_outputs.size(); ++i) {
+            outputs[i] = MakeContractObject<UTXO>(chain(), *this, i);
         }
         return outputs;
     }
@@ -112,7 +171,14 @@ public:
     void ReadJson(const UniValue& json, TxPhase phase) override;
 
     std::string TxID() const override
-    { return MakeTx("").GetHash().GetHex(); }
+    { return TxHash().GetHex(); }
+
+    Txid TxHash() const override
+    {
+        const CMutableTransaction& tx = GetTx();
+        if (!m_txid) m_txid = tx.GetHash();
+        return *m_txid;
+    }
 
     uint32_t CountDestinations() const override
     { return m_outputs.size(); }
@@ -123,14 +189,14 @@ public:
     std::shared_ptr<IContractOutput> ChangeOutput() const
     {
         return m_change_nout
-            ? std::make_shared<UTXO>(chain(), TxID(), *m_change_nout, m_outputs[*m_change_nout])
+            ? MakeContractObject<UTXO>(chain(), *this, *m_change_nout)
             : std::shared_ptr<IContractOutput>();
     }
 
     std::shared_ptr<IContractOutput> RuneStoneOutput() const
     {
         return m_runestone_nout
-            ? std::make_shared<UTXO>(chain(), TxID(), *m_runestone_nout, m_outputs[*m_runestone_nout])
+            ? MakeContractObject<UTXO>(chain(), *this, *m_runestone_nout)
             : std::shared_ptr<IContractOutput>();
     }
 
@@ -217,7 +217,7 @@ CMutableTransaction SwapInscriptionBuilder::MakeSwapTx(bool with_funds_in) const
 
     CMutableTransaction swap_tx = GetSwapTxTemplate();
 
-    swap_tx.vin[0].prevout = COutPoint(Txid::FromUint256(uint256S(m_ord_input->output->TxID())), m_ord_input->output->NOut());
+    swap_tx.vin[0].prevout = m_ord_input->output->OutPoint();
     if (m_ord_input->witness) {
         swap_tx.vin[0].scriptWitness.stack = m_ord_input->witness;
     }
@@ -294,14 +294,14 @@ CMutableTransaction SwapInscriptionBuilder::GetFundsCommitTxTemplate(bool segwit
     else {
         for (const auto &utxo: m_fund_inputs) {
             if (commitTpl.vin.size() > utxo.nin) {
-                commitTpl.vin[utxo.nin].prevout = COutPoint(Txid::FromUint256(uint256S(utxo.output->TxID())), utxo.output->NOut());
+                commitTpl.vin[utxo.nin].prevout = utxo.output->OutPoint();
                 if (utxo.witness)
                     commitTpl.vin[utxo.nin].scriptWitness.stack = utxo.witness;
             }
             else {
                 if (utxo.nin > commitTpl.vin.size()) throw ContractError(name_funds + " are inconsistent");
 
-                commitTpl.vin.emplace_back(Txid::FromUint256(uint256S(utxo.output->TxID())), utxo.output->NOut());
+                commitTpl.vin.emplace_back(utxo.output->OutPoint());
 
                 if (utxo.witness)
                     commitTpl.vin[utxo.nin].scriptWitness.stack = utxo.witness;
@@ -372,8 +372,12 @@ void SwapInscriptionBuilder::SignFundsCommitment(const KeyRegistry &master_key,
         spent_outs.emplace_back(fund.output->Destination()->TxOutput());
     }
 
+    TxSigningContext ctx(commit_tx, move(spent_outs));
+    auto signers = SignerCache(master_key, key_filter).Signers(m_fund_inputs);
+
+    auto signer_it = signers.begin();
     for (auto& utxo: m_fund_inputs) {
-        utxo.output->Destination()->LookupKey(master_key, key_filter)->SignInput(utxo, commit_tx, spent_outs, SIGHASH_ALL);
+        (*signer_it++)->SignInput(utxo, ctx, SIGHASH_ALL);
     }
 }
 
@@ -757,12 +761,12 @@ std::vector<std::pair<CAmount,CMutableTransaction>> SwapInscriptionBuilder::GetT
 
 void SwapInscriptionBuilder::OrdUTXO(string txid, uint32_t nout, CAmount amount, std::string addr)
 {
-    m_ord_input.emplace(chain(), 0, std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    m_ord_input.emplace(chain(), 0, MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
 }
 
 void SwapInscriptionBuilder::AddFundsUTXO(string txid, uint32_t nout, CAmount amount, std::string addr)
 {
-    m_fund_inputs.emplace_back(chain(), m_fund_inputs.size(), std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    m_fund_inputs.emplace_back(chain(), m_fund_inputs.size(), MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
 }
 
 CMutableTransaction SwapInscriptionBuilder::CreatePayoffTxTemplate() const {
@@ -808,16 +812,12 @@ void SwapInscriptionBuilder::CheckFundsCommitSig() const
     std::ranges::transform(m_fund_inputs, cex::smartinserter(spent_outs, spent_outs.end()),
                            [](const TxInput& in){ return in.output->Destination()->TxOutput(); });
 
-    if (mFundsCommitTx) {
-        for (const auto& in: m_fund_inputs) {
-            VerifyTxSignature(chain(), in.output->Destination()->Address(), *mFundsCommitTx, in.nin, std::vector<CTxOut>(spent_outs));
-        }
-    }
-    else {
-        CMutableTransaction swap_tx(MakeFundsCommitTx());
-        for (const auto& in: m_fund_inputs) {
-            VerifyTxSignature(chain(), in.output->Destination()->Address(), swap_tx, in.nin, std::vector<CTxOut>(spent_outs));
-        }
+    std::optional<CMutableTransaction> commit_tx;
+    if (!mFundsCommitTx) commit_tx.emplace(MakeFundsCommitTx());
+
+    TxSigningContext ctx(mFundsCommitTx ? *mFundsCommitTx : *commit_tx, move(spent_outs));
+    for (const auto& in: m_fund_inputs) {
+        VerifyTxSignature(chain(), in.output->Destination()->Address(), ctx, in.nin);
     }
 }
 
@@ -913,13 +913,13 @@ std::string SwapInscriptionBuilder::RawTransaction(SwapPhase phase, uint32_t n)
 std::shared_ptr<IContractOutput> SwapInscriptionBuilder::InscriptionOutput() const
 {
     auto tx = GetPayoffTx();
-    return std::make_shared<UTXO>(chain(), tx.GetHash().GetHex(), 0, tx.vout.front().nValue, *m_ord_payoff_addr);
+    return MakeContractObject<UTXO>(chain(), tx.GetHash().GetHex(), 0, tx.vout.front().nValue, *m_ord_payoff_addr);
 }
 
 std::shared_ptr<IContractOutput> SwapInscriptionBuilder::FundsOutput() const
 {
     auto tx = GetSwapTx();
-    return std::make_shared<UTXO>(chain(), tx.GetHash().GetHex(), 1, tx.vout[1].nValue, *m_funds_payoff_addr);
+    return MakeContractObject<UTXO>(chain(), tx.GetHash().GetHex(), 1, tx.vout[1].nValue, *m_funds_payoff_addr);
 }
 
 std::shared_ptr<IContractOutput> SwapInscriptionBuilder::ChangeOutput() const
@@ -928,7 +928,7 @@ std::shared_ptr<IContractOutput> SwapInscriptionBuilder::ChangeOutput() const
     if (mChange) {
         auto commitTx = GetFundsCommitTx();
         if (commitTx.vout.size() > 1) {
-            res = std::make_shared<UTXO>(chain(), commitTx.GetHash().GetHex(), 1, mChange);
+            res = MakeContractObject<UTXO>(chain(), commitTx.GetHash().GetHex(), 1, mChange);
         }
     }
     return res;
@@ -72,7 +72,7 @@ CMutableTransaction TrustlessSwapInscriptionBuilder::MakeSwapTx() const
     swap_tx.vin.reserve(m_swap_inputs.size());
 
     for (const auto& input: m_swap_inputs) {
-        swap_tx.vin.emplace_back(Txid::FromUint256(uint256S(input.output->TxID())), input.output->NOut());
+        swap_tx.vin.emplace_back(input.output->OutPoint());
         if (input.witness)
             swap_tx.vin.back().scriptWitness.stack = input.witness;
         else
@@ -217,9 +217,9 @@ void TrustlessSwapInscriptionBuilder::SignMarketSwap(const KeyRegistry &masterKe
         if (m_swap_inputs.size() != 1) throw ContractStateError(name_swap_inputs + " has inconsistent size: " + std::to_string(m_swap_inputs.size()));
 
         m_swap_inputs.front().nin = 2;
-        m_swap_inputs.emplace_back(chain(), 0, std::make_shared<ContractOutput>(mCommitBuilder, 0));
-        m_swap_inputs.emplace_back(chain(), 1, std::make_shared<ContractOutput>(mCommitBuilder, 1));
-        m_swap_inputs.emplace_back(chain(), 3, std::make_shared<ContractOutput>(mCommitBuilder, 2));
+        m_swap_inputs.emplace_back(chain(), 0, MakeContractObject<ContractOutput>(mCommitBuilder, 0));
+        m_swap_inputs.emplace_back(chain(), 1, MakeContractObject<ContractOutput>(mCommitBuilder, 1));
+        m_swap_inputs.emplace_back(chain(), 3, MakeContractObject<ContractOutput>(mCommitBuilder, 2));
         std::sort(m_swap_inputs.begin(), m_swap_inputs.end());
     }
     if (m_swap_inputs.size() < 4) throw ContractStateError(name_swap_inputs + " has inconsistent size: " + std::to_string(m_swap_inputs.size()));
@@ -250,13 +250,13 @@ void TrustlessSwapInscriptionBuilder::SignFundsSwap(const KeyRegistry &master_ke
         spent_outs.emplace_back(input.output->Destination()->TxOutput());
     }
 
+    TxSigningContext ctx(swap_tx, move(spent_outs));
+    SignerCache signer_cache(master_key, key_filter);
+
     for(auto& input: m_swap_inputs) {
         if (input.nin == 2) continue; // Skip ORD input
 
-        auto dest = input.output->Destination();
-        auto keypair = dest->LookupKey(master_key, key_filter);
-
-        keypair->SignInput(input, swap_tx, spent_outs, SIGHASH_ALL);
+        signer_cache.Signer(*input.output->Destination())->SignInput(input, ctx, SIGHASH_ALL);
     }
 
     if (mSwapTx) mSwapTx.reset();
@@ -450,12 +450,12 @@ void TrustlessSwapInscriptionBuilder::ReadJson(const UniValue &contract, utxord:
 
     {   const auto& val = contract[name_ord_commit];
         if (!val.isNull()) {
-            mOrdCommitBuilder = std::make_shared<SimpleTransaction>(chain(), val);
+            mOrdCommitBuilder = MakeContractObject<SimpleTransaction>(chain(), val);
         }
     }
     {   const auto& val = contract[name_funds];
         if (!val.isNull()) {
-            mCommitBuilder = std::make_shared<SimpleTransaction>(chain(), val);
+            mCommitBuilder = MakeContractObject<SimpleTransaction>(chain(), val);
         }
     }
     {   const auto& val = contract[name_swap_inputs];
@@ -491,19 +491,19 @@ void TrustlessSwapInscriptionBuilder::CommitOrdinal(std::string txid, uint32_t n
 {
     if (mOrdCommitBuilder) throw ContractStateError(name_ord_commit + " already defined");
 
-    mOrdCommitBuilder = std::make_shared<SimpleTransaction>(chain());
+    mOrdCommitBuilder = MakeContractObject<SimpleTransaction>(chain());
     mOrdCommitBuilder->MiningFeeRate(GetMiningFeeRate());
 
     //mOrdCommitBuilder->AddOutput(std::make_shared<P2TR>(bech32().GetChainMode(), ParseAmount(amount), bech32().Encode(get<0>(OrdSwapTapRoot()))));
 
-    mOrdCommitBuilder->AddInput(std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    mOrdCommitBuilder->AddInput(MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
 }
 
 void TrustlessSwapInscriptionBuilder::FundCommitOrdinal(std::string txid, uint32_t nout, CAmount amount, std::string addr, std::string change_addr)
 {
     if (!mOrdCommitBuilder) throw ContractStateError(name_ord_commit + " not defined, call CommitOrdinal(...) first");
 
-    mOrdCommitBuilder->AddInput(std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    mOrdCommitBuilder->AddInput(MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
     if (mOrdCommitBuilder->Outputs().size() > 2) {
         mOrdCommitBuilder->Outputs().pop_back();
     }
@@ -518,7 +518,7 @@ void TrustlessSwapInscriptionBuilder::CommitFunds(std::string txid, uint32_t nou
     if (!m_ord_price) throw ContractStateError(name_ord_price + " not defined");
 
     if (!mCommitBuilder) {
-        mCommitBuilder = std::make_shared<SimpleTransaction>(chain());
+        mCommitBuilder = MakeContractObject<SimpleTransaction>(chain());
         mCommitBuilder->MiningFeeRate(GetMiningFeeRate());
 
         mCommitBuilder->AddOutputDestination(P2Address::Construct(chain(), {} , addr));
@@ -538,7 +538,7 @@ void TrustlessSwapInscriptionBuilder::CommitFunds(std::string txid, uint32_t nou
     mCommitBuilder->DropChangeOutput();
 
     uint32_t i = mCommitBuilder->Inputs().size();
-    mCommitBuilder->AddInput(std::make_shared<UTXO>(chain(), move(txid), nout, amount, addr));
+    mCommitBuilder->AddInput(MakeContractObject<UTXO>(chain(), move(txid), nout, amount, addr));
 
     try {
         CAmount commit_fee = mCommitBuilder->CalculateWholeFee("") + TAPROOT_VOUT_VSIZE;
@@ -594,7 +594,7 @@ void TrustlessSwapInscriptionBuilder::BuildOrdCommit()
     mOrdCommitBuilder->AddOutput(mOrdCommitBuilder->Inputs().front().output->Destination()->Amount(), Bech32(BTC, chain()).Encode(get<0>(ordSwapTapRoot)));
     mOrdCommitBuilder->AddChangeOutput(change_addr);
 
-    m_swap_inputs.emplace_back(chain(), 0, std::make_shared<ContractOutput>(mOrdCommitBuilder, 0));
+    m_swap_inputs.emplace_back(chain(), 0, MakeContractObject<ContractOutput>(mOrdCommitBuilder, 0));
     m_swap_inputs.front().witness.Set(0, signature());
     m_swap_inputs.front().witness.Set(1, bytevector(65));
     m_swap_inputs.front().witness.Set(2, bytevector(script.begin(), script.end()));
@@ -627,7 +627,7 @@ void TrustlessSwapInscriptionBuilder::Brick1SwapUTXO(string txid, uint32_t nout,
         m_swap_inputs.front().nin = 2;
     }
 
-    m_swap_inputs.emplace_back(chain(), 0, std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    m_swap_inputs.emplace_back(chain(), 0, MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
     std::sort(m_swap_inputs.begin(), m_swap_inputs.end());
 }
 
@@ -640,7 +640,7 @@ void TrustlessSwapInscriptionBuilder::Brick2SwapUTXO(string txid, uint32_t nout,
         m_swap_inputs.front().nin = 2;
     }
 
-    m_swap_inputs.emplace_back(chain(), 1, std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    m_swap_inputs.emplace_back(chain(), 1, MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
     std::sort(m_swap_inputs.begin(), m_swap_inputs.end());
 }
 
@@ -653,7 +653,7 @@ void TrustlessSwapInscriptionBuilder::AddMainSwapUTXO(std::string txid, uint32_t
         m_swap_inputs.front().nin = 2;
     }
 
-    m_swap_inputs.emplace_back(chain(), m_swap_inputs.back().nin + 1, std::make_shared<UTXO>(chain(), move(txid), nout, amount, move(addr)));
+    m_swap_inputs.emplace_back(chain(), m_swap_inputs.back().nin + 1, MakeContractObject<UTXO>(chain(), move(txid), nout, amount, move(addr)));
     std::sort(m_swap_inputs.begin(), m_swap_inputs.end());
 }
 
@@ -663,36 +663,22 @@ void TrustlessSwapInscriptionBuilder::CheckOrdSwapSig() const
     spent_outs.reserve(m_swap_inputs.size());
     std::transform(m_swap_inputs.begin(), m_swap_inputs.end(), cex::smartinserter(spent_outs, spent_outs.end()), [](const auto& txin){ return txin.output->Destination()->TxOutput(); });
     CScript ordSwapScript = OrdSwapScript();
-    if (mSwapTx) {
-        for (const auto &input: m_swap_inputs) {
-            if ((m_swap_inputs.size() == 1 && input.nin == 0) || (m_swap_inputs.size() != 1 && input.nin == 2)) {
-                if (!input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
-                    VerifyTxSignature(*m_market_script_pk, input.witness[0], *mSwapTx, input.nin, spent_outs, ordSwapScript);
-                }
-                if (!input.witness[1].empty() && !l15::IsZeroArray(input.witness[1])) {
-                    VerifyTxSignature(*m_ord_script_pk, input.witness[1], *mSwapTx, input.nin, spent_outs, ordSwapScript);
-                }
-            } else {
-                if (input.witness && !input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
-                    VerifyTxSignature(chain(), input.output->Destination()->Address(), *mSwapTx, input.nin, spent_outs);
-                }
+
+    std::optional<CMutableTransaction> swap_tx;
+    if (!mSwapTx) swap_tx.emplace(MakeSwapTx());
+
+    TxSigningContext ctx(mSwapTx ? *mSwapTx : *swap_tx, move(spent_outs));
+    for (const auto &input: m_swap_inputs) {
+        if ((m_swap_inputs.size() == 1 && input.nin == 0) || (m_swap_inputs.size() != 1 && input.nin == 2)) {
+            if (!input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
+                VerifyTxSignature(*m_market_script_pk, input.witness[0], ctx, input.nin, ordSwapScript);
             }
-        }
-    }
-    else {
-        CMutableTransaction swap_tx = MakeSwapTx();
-        for (const auto &input: m_swap_inputs) {
-            if ((m_swap_inputs.size() == 1 && input.nin == 0) || (m_swap_inputs.size() != 1 && input.nin == 2)) {
-                if (!input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
-                    VerifyTxSignature(*m_market_script_pk, input.witness[0], swap_tx, input.nin, spent_outs, ordSwapScript);
-                }
-                if (!input.witness[1].empty() && !l15::IsZeroArray(input.witness[1])) {
-                    VerifyTxSignature(*m_ord_script_pk, input.witness[1], swap_tx, input.nin, spent_outs, ordSwapScript);
-                }
-            } else {
-                if (input.witness && !input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
-                    VerifyTxSignature(chain(), input.output->Destination()->Address(), swap_tx, input.nin, spent_outs);
-                }
+            if (!input.witness[1].empty() && !l15::IsZeroArray(input.witness[1])) {
+                VerifyTxSignature(*m_ord_script_pk, input.witness[1], ctx, input.nin, ordSwapScript);
+            }
+        } else {
+            if (input.witness && !input.witness[0].empty() && !l15::IsZeroArray(input.witness[0])) {
+                VerifyTxSignature(chain(), input.output->Destination()->Address(), ctx, input.nin);
             }
         }
     }
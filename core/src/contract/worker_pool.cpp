@@ -0,0 +1,101 @@
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "worker_pool.hpp"
+
+namespace utxord {
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    if (threads > 1) {
+        m_threads.reserve(threads - 1);
+        for (size_t i = 1; i < threads; ++i) {
+            m_threads.emplace_back([this] { Work(); });
+        }
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread: m_threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Work()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;
+            task = move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::ForEach(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0) return;
+
+    if (m_threads.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::vector<std::exception_ptr> errors;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    state->errors.resize(count);
+
+    auto process = [state, count, &task] {
+        size_t i;
+        while ((i = state->next.fetch_add(1)) < count) {
+            try {
+                task(i);
+            }
+            catch (...) {
+                state->errors[i] = std::current_exception();
+            }
+            if (state->done.fetch_add(1) + 1 == count) {
+                std::unique_lock lock(state->mutex);
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(m_threads.size(), count - 1);
+    {
+        std::unique_lock lock(m_mutex);
+        for (size_t i = 0; i < helpers; ++i) m_tasks.emplace_back(process);
+    }
+    m_cv.notify_all();
+
+    process();
+
+    {
+        std::unique_lock lock(state->mutex);
+        state->cv.wait(lock, [&] { return state->done.load() == count; });
+    }
+
+    for (const auto& error: state->errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+}
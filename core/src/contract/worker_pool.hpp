@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace utxord {
+
+// Fixed size thread pool used to spread independent per-input work (signing, signature checks) across cores.
+// ForEach() blocks until all the items are processed; the calling thread takes part in processing.
+class WorkerPool
+{
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+
+    void Work();
+public:
+    explicit WorkerPool(size_t threads = std::thread::hardware_concurrency());
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    // Number of threads processing ForEach() items including the calling one
+    size_t Concurrency() const
+    { return m_threads.size() + 1; }
+
+    // Calls task(i) for each i in [0, count). If some tasks throw then the exception of the lowest i is rethrown
+    // once all the items are done, so the outcome does not depend on scheduling.
+    void ForEach(size_t count, const std::function<void(size_t)>& task);
+};
+
+}
@@ -51,19 +51,28 @@ std::string GetTaprootAddress(const std::string& chain_mode, const std::string&
     throw l15::IllegalArgument(std::string("chain_mode: ") + chain_mode);
 }
 
-std::string GetAddress(const std::string& chain_mode, const bytevector& pubkeyscript)
+namespace {
+
+ChainMode ParseChainMode(const std::string& chain_mode)
 {
-    ChainMode chain = l15::MAINNET;
-    if (chain_mode == "testnet" || chain_mode == "signet") chain = l15::TESTNET;
-    else if (chain_mode == "regtest") chain = l15::REGTEST;
-    else if (chain_mode != "mainnet") throw l15::IllegalArgument(std::string("chain_mode: " + chain_mode));
+    if (chain_mode == "mainnet") return l15::MAINNET;
+    if (chain_mode == "testnet" || chain_mode == "signet") return l15::TESTNET;
+    if (chain_mode == "regtest") return l15::REGTEST;
+    throw l15::IllegalArgument(std::string("chain_mode: " + chain_mode));
+}
 
+std::pair<ScriptType, std::string> GetScriptAddress(ChainMode chain, const CScript& script)
+{
     int witver;
     bytevector witnessprogram;
-    CScript script(pubkeyscript.begin(), pubkeyscript.end());
     bool segwit =  script.IsWitnessProgram(witver, witnessprogram);
     if (segwit) {
-        return Bech32(l15::BTC, chain).Encode(witnessprogram, witver == 0 ? bech32::Encoding::BECH32 : bech32::Encoding::BECH32M);
+        ScriptType type = ScriptType::WITNESS_UNKNOWN;
+        if (witver == 0 && witnessprogram.size() == 20) type = ScriptType::P2WPKH;
+        else if (witver == 0 && witnessprogram.size() == 32) type = ScriptType::P2WSH;
+        else if (witver == 1 && witnessprogram.size() == 32) type = ScriptType::P2TR;
+
+        return {type, Bech32(l15::BTC, chain).Encode(witnessprogram, witver == 0 ? bech32::Encoding::BECH32 : bech32::Encoding::BECH32M)};
     }
 
     if (script.IsPayToScriptHash()) {
@@ -71,7 +80,7 @@ std::string GetAddress(const std::string& chain_mode, const bytevector& pubkeysc
             script[1] == 0x14 &&
             script[22] == OP_EQUAL); */
 
-        return l15::Base58(chain).Encode(std::span(script.begin()+2, script.begin() + 22), l15::SCRIPT_HASH);
+        return {ScriptType::P2SH, l15::Base58(chain).Encode(std::span(script.begin()+2, script.begin() + 22), l15::SCRIPT_HASH)};
     }
 
     // IsPayToPublicKeyHash
@@ -82,10 +91,20 @@ std::string GetAddress(const std::string& chain_mode, const bytevector& pubkeysc
         script[23] == OP_EQUALVERIFY &&
         script[24] == OP_CHECKSIG) {
 
-        return l15::Base58(chain).Encode(std::span(script.begin()+3, script.begin() + 23), l15::PUB_KEY_HASH);
+        return {ScriptType::P2PKH, l15::Base58(chain).Encode(std::span(script.begin()+3, script.begin() + 23), l15::PUB_KEY_HASH)};
     }
 
-    return "";
+    if (script.IsUnspendable()) return {ScriptType::NULL_DATA, {}};
+
+    return {ScriptType::NONSTANDARD, {}};
+}
+
+}
+
+std::string GetAddress(const std::string& chain_mode, const bytevector& pubkeyscript)
+{
+    ChainMode chain = ParseChainMode(chain_mode);
+    return GetScriptAddress(chain, CScript(pubkeyscript.begin(), pubkeyscript.end())).second;
 }
 
 bool IsSamePubkeyAddress(ChainMode chain, const bytevector& pubkey, const std::string& addr)
@@ -118,4 +137,43 @@ bool IsSamePubkeyAddress(ChainMode chain, const bytevector& pubkey, const std::s
     return res;
 }
 
+TxAnalysis AnalyzeTransaction(ChainMode chain, const CTransaction& tx)
+{
+    TxAnalysis res;
+    res.txid = tx.GetHash().GetHex();
+    res.wtxid = tx.GetWitnessHash().GetHex();
+
+    auto inscriptions = ParseInscriptions(tx);
+    res.inscriptions.reserve(inscriptions.size());
+    for (const auto& view: inscriptions) {
+        res.inscriptions.emplace_back(view);
+    }
+
+    res.runestone = ParseRuneStone(tx, chain);
+    res.cenotaph = res.runestone && res.runestone->cenotaph;
+
+    res.outputs.reserve(tx.vout.size());
+    for (const auto& out: tx.vout) {
+        auto [type, address] = GetScriptAddress(chain, out.scriptPubKey);
+        res.outputs.push_back({out.nValue, type, move(address)});
+    }
+
+    return res;
+}
+
+TxAnalysis AnalyzeTransaction(const std::string& chain_mode, const std::string& hex_tx)
+{ return AnalyzeTransaction(ParseChainMode(chain_mode), CTransaction(l15::DecodeHexTx(hex_tx))); }
+
+std::vector<TxAnalysis> AnalyzeTransactions(const std::string& chain_mode, const std::vector<std::string>& hex_txs)
+{
+    ChainMode chain = ParseChainMode(chain_mode);
+
+    std::vector<TxAnalysis> res;
+    res.reserve(hex_txs.size());
+    for (const auto& hex_tx: hex_txs) {
+        res.emplace_back(AnalyzeTransaction(chain, CTransaction(l15::DecodeHexTx(hex_tx))));
+    }
+    return res;
+}
+
 }
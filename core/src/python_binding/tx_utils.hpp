@@ -1,10 +1,15 @@
 #pragma once
 
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "common.hpp"
 #include "utils.hpp"
 
+#include "inscription.hpp"
+#include "runes.hpp"
+
 namespace utxord {
 
 using l15::ChainMode;
@@ -16,5 +21,29 @@ std::string GetTaprootAddress(const std::string& chain_mode, const std::string&
 std::string GetAddress(const std::string& chain_mode, const l15::bytevector& pubkeyscript);
 bool IsSamePubkeyAddress(ChainMode chain, const l15::bytevector& pubkey, const std::string& address);
 
+enum class ScriptType: uint8_t { NONSTANDARD, P2PKH, P2SH, P2WPKH, P2WSH, P2TR, WITNESS_UNKNOWN, NULL_DATA };
+
+struct TxOutputInfo
+{
+    CAmount amount = 0;
+    ScriptType type = ScriptType::NONSTANDARD;
+    std::string address;
+};
+
+struct TxAnalysis
+{
+    std::string txid;
+    std::string wtxid;
+    std::vector<Inscription> inscriptions;
+    std::optional<RuneStone> runestone;
+    bool cenotaph = false;
+    std::vector<TxOutputInfo> outputs;
+};
+
+// Collects inscriptions, rune stone and output addresses of a transaction decoded once
+TxAnalysis AnalyzeTransaction(ChainMode chain, const CTransaction& tx);
+TxAnalysis AnalyzeTransaction(const std::string& chain_mode, const std::string& hex_tx);
+std::vector<TxAnalysis> AnalyzeTransactions(const std::string& chain_mode, const std::vector<std::string>& hex_txs);
+
 } // l15
 
@@ -18,9 +18,12 @@ static PyObject* pError;
 %apply int64_t { CAmount }
 
 %template(StringVector) std::vector<std::string>;
+%template(AmountVector) std::vector<int64_t>;
 
 %apply std::vector<std::string> { l15::stringvector };
 %apply const std::vector<std::string>& { const l15::stringvector& };
+%apply std::vector<int64_t> { std::vector<CAmount> };
+%apply const std::vector<int64_t>& { const std::vector<CAmount>& };
 
 %{
 
@@ -39,6 +42,8 @@ static PyObject* pError;
 #include "common_error.hpp"
 #include "inscription.hpp"
 #include "simple_transaction.hpp"
+#include "coin_selection.hpp"
+#include "bulk_payout.hpp"
 
 using namespace utxord;
 using namespace l15;
@@ -78,6 +83,7 @@ using namespace l15::core;
 %catches(utxord::ContractError) utxord::CreateInscriptionBuilder::OrdOutput(CAmount amount, std::string addr);
 %catches(utxord::ContractError) utxord::CreateInscriptionBuilder::AuthorFee(CAmount amount, std::string addr);
 %catches(utxord::ContractError) utxord::CreateInscriptionBuilder::AddUTXO(std::string txid, uint32_t nout, CAmount amount, std::string addr);
+%catches(utxord::ContractError) utxord::CreateInscriptionBuilder::DataFromFile(std::string content_type, const std::string& path);
 %catches(utxord::ContractError) utxord::CreateInscriptionBuilder::GetMinFundingAmount(const std::string& params) const;
 
 %catches(utxord::ContractFundsNotEnough, utxord::ContractError,
@@ -313,6 +319,13 @@ using namespace l15::core;
 %ignore utxord::OpReturnDestination::name_data;
 %ignore utxord::UTXO::type;
 
+%ignore utxord::TxSigningContext;
+%ignore utxord::WorkerPool;
+%ignore utxord::SignerCache;
+%ignore utxord::TxWeight;
+%ignore utxord::IContractBuilder::WorkerThreads;
+%ignore utxord::IContractBuilder::ParseContract;
+
 %ignore utxord::SimpleTransaction::ReadJson;
 %ignore utxord::SimpleTransaction::MakeJson;
 
@@ -325,6 +338,17 @@ using namespace l15::core;
 %ignore utxord::TrustlessSwapInscriptionBuilder::ReadJson;
 %ignore utxord::TrustlessSwapInscriptionBuilder::MakeJson;
 
+%ignore utxord::EnvelopeData;
+%ignore utxord::InscriptionView;
+%ignore utxord::ParseEnvelopeScript(std::span<const uint8_t>, size_t&);
+%ignore utxord::Inscription::Inscription(const InscriptionView&);
+%ignore utxord::ParseInscriptions(std::span<const uint8_t>, size_t&, std::vector<InscriptionView>&);
+%ignore utxord::ParseInscriptions(std::span<const uint8_t>);
+%ignore utxord::ParseInscriptions(const CTransaction&);
+
+%ignore utxord::TxAnalysis::runestone;
+%ignore utxord::AnalyzeTransaction(ChainMode, const CTransaction&);
+
 %typemap(out) CMutableTransaction (PyObject* obj)
 %{
     obj = PyDict_New();
@@ -425,10 +449,15 @@ using namespace l15::core;
 %include "swap_inscription.hpp"
 %include "trustless_swap_inscription.hpp"
 %include "simple_transaction.hpp"
+%include "coin_selection.hpp"
+%include "bulk_payout.hpp"
 %include "transaction.hpp"
 %include "inscription.hpp"
 
 %template(InscriptionList) std::list<utxord::Inscription>;
+%template(InscriptionVector) std::vector<utxord::Inscription>;
+%template(TxOutputInfoVector) std::vector<utxord::TxOutputInfo>;
+%template(TxAnalysisVector) std::vector<utxord::TxAnalysis>;
 
 
 %init %{
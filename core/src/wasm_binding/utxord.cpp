@@ -360,17 +360,13 @@ public:
 
     void SetMintCap(const char* v)
     {
-        uint128_t numval;
-        std::istringstream valstream(v);
-        valstream >> numval;
+        uint128_t numval = ParseUInt128(v);
         utxord::Rune::MintCap().emplace(numval);
     }
 
     void SetAmountPerMint(const char* v)
     {
-        uint128_t numval;
-        std::istringstream valstream(v);
-        valstream >> numval;
+        uint128_t numval = ParseUInt128(v);
         utxord::Rune::AmountPerMint().emplace(numval);
     }
 
@@ -420,9 +416,7 @@ public:
     {
         static RuneStoneDestination cache;
 
-        uint128_t numamount;
-        std::istringstream amountstream(amount);
-        amountstream >> numamount;
+        uint128_t numamount = ParseUInt128(amount);
 
         std::shared_ptr<utxord::RuneStoneDestination> ptr =
                 std::make_shared<utxord::RuneStoneDestination>(mode, utxord::Rune::EtchAndMint(numamount, nout));
@@ -627,10 +621,7 @@ public:
         RuneId runeid;
         runeid.ReadJson(runeIdVal, []{ return "rune_id_json"; });
 
-        uint128_t amount;
-        std::istringstream buf;
-        buf.str(rune_amount);
-        buf >> amount;
+        uint128_t amount = ParseUInt128(rune_amount);
 
         m_ptr->AddRuneInput(prevout->Share(), move(runeid), move(amount));
     }
@@ -642,10 +633,7 @@ public:
         RuneId runeid;
         runeid.ReadJson(runeIdVal, []{ return "rune_id_json"; });
 
-        uint128_t amount;
-        std::istringstream buf;
-        buf.str(rune_amount);
-        buf >> amount;
+        uint128_t amount = ParseUInt128(rune_amount);
 
         m_ptr->AddRuneUTXO(move(txid), nout, ParseAmount(btc_amount), move(addr), move(runeid), move(amount));
     }
@@ -663,10 +651,7 @@ public:
         RuneId runeid;
         runeid.ReadJson(runeIdVal, []{ return "rune_id_json"; });
         
-        uint128_t amount;
-        std::istringstream buf;
-        buf.str(rune_amount);
-        buf >> amount;
+        uint128_t amount = ParseUInt128(rune_amount);
         
         m_ptr->AddRuneOutput(ParseAmount(btc_amount), move(addr), move(runeid), move(amount));
     }
@@ -678,10 +663,7 @@ public:
         RuneId runeid;
         runeid.ReadJson(runeIdVal, []{ return "rune_id_json"; });
 
-        uint128_t amount;
-        std::istringstream buf;
-        buf.str(rune_amount);
-        buf >> amount;
+        uint128_t amount = ParseUInt128(rune_amount);
         
         m_ptr->AddRuneOutputDestination(out->Share(), move(runeid), move(amount));
     }
@@ -693,10 +675,7 @@ public:
         RuneId runeid;
         runeid.ReadJson(runeIdVal, []{ return "rune_id_json"; });
 
-        uint128_t amount;
-        std::istringstream buf;
-        buf.str(rune_amount);
-        buf >> amount;
+        uint128_t amount = ParseUInt128(rune_amount);
 
         m_ptr->BurnRune(move(runeid), move(amount));
     }
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <vector>
 #include <tuple>
+#include <memory_resource>
 
 #define CATCH_CONFIG_RUNNER
 #include "catch/catch.hpp"
@@ -15,10 +16,11 @@
 #include "inscription.hpp"
 
 #include "contract_builder.hpp"
+#include "transaction.hpp"
 
 #include "policy/policy.h"
 
-//#include "test_case_wrapper.hpp"
+#include "test_case_wrapper.hpp"
 #include "univalue.h"
 #include "script_merkle_tree.hpp"
 
@@ -287,6 +289,37 @@ TEST_CASE("dust_limit")
     CHECK_THROWS_AS(P2Address::Construct(MAINNET, 329, p2sh_addr), ContractTermWrongValue);
 }
 
+TEST_CASE("serialize_hex_tx")
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 1));
+    tx.vin.back().scriptWitness.stack.emplace_back(64, 0x11);
+    tx.vin.back().scriptWitness.stack.emplace_back(100000, 0x22);
+    tx.vout.emplace_back(546, Bech32(BTC, MAINNET).PubKeyScript(p2tr_addr));
+
+    CHECK(SerializeHexTx(tx) == EncodeHexTx(tx));
+
+    tx.vin.back().scriptWitness.stack.clear();
+    CHECK(SerializeHexTx(tx) == EncodeHexTx(tx));
+}
+
+TEST_CASE("p2address_pubkeyscript")
+{
+    Bech32 bech(BTC, MAINNET);
+    CHECK(P2Address::Construct(MAINNET, 546, p2tr_addr)->PubKeyScript() == bech.PubKeyScript(p2tr_addr));
+    CHECK(P2Address::Construct(MAINNET, 546, p2wpkh_addr)->PubKeyScript() == bech.PubKeyScript(p2wpkh_addr));
+
+    auto [pkh_type, pkh] = Base58(MAINNET).Decode(p2pkh_addr);
+    CHECK(P2Address::Construct(MAINNET, 546, p2pkh_addr)->PubKeyScript() == (CScript() << OP_DUP << OP_HASH160 << pkh << OP_EQUALVERIFY << OP_CHECKSIG));
+
+    auto [sh_type, sh] = Base58(MAINNET).Decode(p2sh_addr);
+    CHECK(P2Address::Construct(MAINNET, 546, p2sh_addr)->PubKeyScript() == (CScript() << OP_HASH160 << sh << OP_EQUAL));
+
+    auto dest = P2Address::Construct(MAINNET, 546, p2tr_addr);
+    CHECK_NOTHROW(dest->Amount(330));
+    CHECK_THROWS_AS(dest->Amount(329), ContractTermWrongValue);
+}
+
 TEST_CASE("p2address")
 {
     std::string p2tr_addr = "bc1pp5t2a3j6fl8v7785szxeyhk8dpqksas7w5ta9j8caysn5ud8l68qcey6ak";
@@ -306,3 +339,166 @@ TEST_CASE("p2address")
     CHECK(p2tr->Address() == addr);
 }
 
+static const std::string seed = "b37f263befa23efb352f0ba45a5e452363963fabc64c946a75df155244630ebaa1ac8056b873e79232486d5dd36809f8925c9c5ac8322f5380940badc64cc6fe";
+
+TEST_CASE("binary_serialization")
+{
+    OfflineKeys keys(REGTEST, seed);
+
+    SimpleTransaction tx_contract(keys.chain());
+    tx_contract.MiningFeeRate(1000);
+    for (uint32_t i = 0; i < 3; ++i) {
+        tx_contract.AddUTXO(FakeTxid(i + 1), i, 10000, (i % 2) ? keys.p2tr(0, 0, i) : keys.p2wpkh(0, 0, i));
+    }
+    tx_contract.AddOutput(15000, keys.p2tr(1, 0, 0));
+    tx_contract.AddChangeOutput(keys.p2tr(0, 1, 1));
+    REQUIRE_NOTHROW(tx_contract.Sign(keys.keyreg(), "fund"));
+
+    std::string json = tx_contract.Serialize(tx_contract.GetVersion(), TX_SIGNATURE);
+    bytevector binary;
+    REQUIRE_NOTHROW(binary = tx_contract.SerializeBinary(tx_contract.GetVersion(), TX_SIGNATURE));
+    CHECK(binary.size() < json.size());
+
+    SimpleTransaction tx_contract1(keys.chain());
+    REQUIRE_NOTHROW(tx_contract1.DeserializeBinary(binary, TX_SIGNATURE));
+    CHECK(tx_contract1.Serialize(tx_contract.GetVersion(), TX_SIGNATURE) == json);
+    CHECK(tx_contract1.TxID() == tx_contract.TxID());
+
+    bytevector truncated(binary.begin(), binary.end() - 1);
+    SimpleTransaction tx_contract2(keys.chain());
+    CHECK_THROWS_AS(tx_contract2.DeserializeBinary(truncated, TX_SIGNATURE), ContractFormatError);
+}
+
+TEST_CASE("binary_params")
+{
+    UniValue params(UniValue::VOBJ);
+    params.pushKV("text", "x");
+    params.pushKV("pk", "00ab");
+    UniValue root(UniValue::VOBJ);
+    root.pushKV(IContractBuilder::name_contract_type, "test");
+    root.pushKV(IContractBuilder::name_params, move(params));
+
+    const bytevector content = {0x00, 0x01, 0xff};
+    bytevector binary;
+    REQUIRE_NOTHROW(binary = IContractBuilder::PackBinary(root, {{"content", content}}));
+
+    std::vector<std::pair<std::string, bytevector>> binary_values;
+    UniValue unpacked;
+    REQUIRE_NOTHROW(unpacked = IContractBuilder::UnpackBinary(binary, {"content"}, binary_values));
+    CHECK(unpacked[IContractBuilder::name_params]["text"].get_str() == "x");
+    CHECK(unpacked[IContractBuilder::name_params]["pk"].get_str() == "00ab");
+    CHECK(unpacked[IContractBuilder::name_params]["content"].isNull());
+    REQUIRE(binary_values.size() == 1);
+    CHECK(binary_values.front().first == "content");
+    CHECK(binary_values.front().second == content);
+
+    // Byte string of a param which is not listed as binary is restored as hex
+    binary_values.clear();
+    REQUIRE_NOTHROW(unpacked = IContractBuilder::UnpackBinary(binary, {}, binary_values));
+    CHECK(binary_values.empty());
+    CHECK(unpacked[IContractBuilder::name_params]["content"].get_str() == "0001ff");
+}
+
+TEST_CASE("witness_json")
+{
+    UniValue json;
+    REQUIRE(json.read(R"(["00ab", "FF", ""])"));
+
+    WitnessStack witness;
+    REQUIRE_NOTHROW(witness.ReadJson(json, [](){ return "witness"; }));
+    REQUIRE(witness.size() == 3);
+    CHECK(witness[0] == bytevector{0x00, 0xab});
+    CHECK(witness[1] == bytevector{0xff});
+    CHECK(witness[2].empty());
+
+    CHECK_NOTHROW(witness.ReadJson(json, [](){ return "witness"; }));
+
+    UniValue other;
+    REQUIRE(other.read(R"(["00ac"])"));
+    CHECK_THROWS_AS(witness.ReadJson(other, [](){ return "witness"; }), ContractTermMismatch);
+
+    UniValue wrong;
+    REQUIRE(wrong.read(R"(["0g"])"));
+    WitnessStack witness1;
+    CHECK_THROWS_AS(witness1.ReadJson(wrong, [](){ return "witness"; }), ContractTermWrongFormat);
+}
+
+TEST_CASE("streaming_parse")
+{
+    const std::string json = R"({"contract_type":"test","params":{"a":[1,-2,{"b":null}],"fee":0.00001000,"flag":true,"content":"00ABff","text":"x"}})";
+
+    std::vector<std::pair<std::string, bytevector>> binary_values;
+    UniValue root;
+    REQUIRE_NOTHROW(root = IContractBuilder::ParseContract(json, {"content"}, binary_values));
+
+    UniValue expected;
+    REQUIRE(expected.read(json));
+    const UniValue& params = root[IContractBuilder::name_params];
+    CHECK(params["a"].write() == expected[IContractBuilder::name_params]["a"].write());
+    CHECK(params["fee"].getValStr() == "0.00001000");
+    CHECK(params["flag"].get_bool());
+    CHECK(params["text"].get_str() == "x");
+    CHECK(params["content"].isNull());
+
+    REQUIRE(binary_values.size() == 1);
+    CHECK(binary_values.front().first == "content");
+    CHECK(binary_values.front().second == bytevector{0x00, 0xab, 0xff});
+
+    binary_values.clear();
+    CHECK(IContractBuilder::ParseContract(R"({"params":{"a":1})", {"content"}, binary_values).isNull());
+    CHECK_THROWS_AS(IContractBuilder::ParseContract(R"({"params":{"content":"0g"}})", {"content"}, binary_values), ContractTermWrongValue);
+}
+
+namespace {
+
+class CountingResource : public std::pmr::memory_resource
+{
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    { std::pmr::new_delete_resource()->deallocate(p, bytes, alignment); }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    { return this == &other; }
+public:
+    size_t allocations = 0;
+};
+
+}
+
+TEST_CASE("contract_memory_scope")
+{
+    OfflineKeys keys(REGTEST, seed);
+
+    SimpleTransaction tx_contract(keys.chain());
+    tx_contract.MiningFeeRate(1000);
+    tx_contract.AddUTXO("c8bd1d5d3b2b7a2e4e8e5d0f2f6d9a3c1b4a5e6f708192a3b4c5d6e7f8091a2b", 0, 10000, keys.p2tr(0, 0, 1));
+    tx_contract.AddOutput(5000, keys.p2tr(1, 0, 0));
+    tx_contract.AddChangeOutput(keys.p2tr(0, 1, 1));
+    REQUIRE_NOTHROW(tx_contract.Sign(keys.keyreg(), "fund"));
+    std::string json = tx_contract.Serialize(tx_contract.GetVersion(), TX_SIGNATURE);
+
+    auto arena = std::make_shared<CountingResource>();
+    std::weak_ptr<CountingResource> arena_ref = arena;
+    std::shared_ptr<IContractOutput> escaped_input;
+    {
+        SimpleTransaction tx_contract1(keys.chain());
+        tx_contract1.MemoryArena(move(arena));
+        REQUIRE_NOTHROW(tx_contract1.Deserialize(json, TX_SIGNATURE));
+        CHECK(!ContractMemoryScope::Arena());
+
+        // input UTXO, its destination and two output destinations
+        CHECK(arena_ref.lock()->allocations == 4);
+        CHECK(tx_contract1.Serialize(tx_contract.GetVersion(), TX_SIGNATURE) == json);
+
+        escaped_input = tx_contract1.Inputs().front().output;
+    }
+    // Objects escaped the builder keep the arena alive
+    REQUIRE(!arena_ref.expired());
+    CHECK(escaped_input->Destination()->Address() == keys.p2tr(0, 0, 1));
+
+    escaped_input.reset();
+    CHECK(arena_ref.expired());
+}
@@ -172,6 +172,131 @@ TEST_CASE("simple_inscribe")
 }
 
 
+TEST_CASE("inscription_script_cache")
+{
+    CreateInscriptionBuilder inscription(w->chain(), INSCRIPTION);
+    REQUIRE_NOTHROW(inscription.MarketFee(0, w->p2tr(0,0,1)));
+    REQUIRE_NOTHROW(inscription.MiningFeeRate(3000));
+    REQUIRE_NOTHROW(inscription.OrdOutput(546, w->p2tr(0,0,0)));
+    REQUIRE_NOTHROW(inscription.ChangeAddress(w->p2tr(0,0,1)));
+    REQUIRE_NOTHROW(inscription.InscribeScriptPubKey(w->derive(86,0,0,0).GetSchnorrKeyPair().GetPubKey()));
+    REQUIRE_NOTHROW(inscription.InscribeInternalPubKey(w->derive(86,4,0,0).GetSchnorrKeyPair().GetPubKey()));
+    REQUIRE_NOTHROW(inscription.AddUTXO(std::string(64, '1'), 0, 1000000, w->p2wpkh(0,0,0)));
+    REQUIRE_NOTHROW(inscription.Data("text/plain", bytevector(100, 'a')));
+
+    CAmount small_fee = inscription.CalculateMiningFeeAmount();
+    std::string small_id = inscription.MakeInscriptionId();
+    CHECK(inscription.MakeInscriptionId() == small_id);
+
+    // Every setter the inscription script depends on has to drop the cached script and taproot
+    REQUIRE_NOTHROW(inscription.Data("text/plain", bytevector(10000, 'a')));
+    CHECK(inscription.CalculateMiningFeeAmount() > small_fee);
+    CHECK(inscription.MakeInscriptionId() != small_id);
+
+    REQUIRE_NOTHROW(inscription.Data("text/plain", bytevector(100, 'a')));
+    CHECK(inscription.CalculateMiningFeeAmount() == small_fee);
+    CHECK(inscription.MakeInscriptionId() == small_id);
+
+    REQUIRE_NOTHROW(inscription.InscribeInternalPubKey(w->derive(86,4,0,1).GetSchnorrKeyPair().GetPubKey()));
+    CHECK(inscription.MakeInscriptionId() != small_id);
+}
+
+
+namespace {
+
+// CBOR text string which takes exactly the given size along with its header
+bytevector MetaDataOfSize(size_t size)
+{
+    for (size_t header: {1, 2, 3}) {
+        bytevector cbor = nlohmann::json::to_cbor(std::string(size - header, 'm'));
+        if (cbor.size() == size) return cbor;
+    }
+    throw std::invalid_argument("metadata size: " + std::to_string(size));
+}
+
+}
+
+TEST_CASE("inscription_fee_solver")
+{
+    auto content_size = GENERATE(0, 75, 76, 255, 256, 520, 521, 1040, 65536);
+    auto metadata_size = GENERATE(0, 300, 700);
+
+    CreateInscriptionBuilder inscription(w->chain(), INSCRIPTION);
+    REQUIRE_NOTHROW(inscription.MarketFee(1000, w->p2tr(0,0,1)));
+    REQUIRE_NOTHROW(inscription.MiningFeeRate(3000));
+    REQUIRE_NOTHROW(inscription.OrdOutput(546, w->p2tr(0,0,0)));
+    REQUIRE_NOTHROW(inscription.ChangeAddress(w->p2tr(0,0,1)));
+    REQUIRE_NOTHROW(inscription.InscribeScriptPubKey(w->derive(86,0,0,0).GetSchnorrKeyPair().GetPubKey()));
+    REQUIRE_NOTHROW(inscription.InscribeInternalPubKey(w->derive(86,4,0,0).GetSchnorrKeyPair().GetPubKey()));
+    REQUIRE_NOTHROW(inscription.Data("text/plain", bytevector(content_size, 'a')));
+    if (metadata_size) REQUIRE_NOTHROW(inscription.MetaData(MetaDataOfSize(metadata_size)));
+
+    CAmount missing = inscription.CalculateMissingAmount(w->p2tr(0,0,0));
+    REQUIRE(missing > inscription.CalculateMissingAmount(""));
+
+    // Funds which leave a dust change are spent to the inscription output
+    auto dust_change = GENERATE(0, 100);
+    REQUIRE_NOTHROW(inscription.AddUTXO(std::string(64, '1'), 0, missing + dust_change, w->p2tr(0,0,0)));
+    CHECK(inscription.CalculateMissingAmount("") == 0);
+
+    CAmount mining_fee = inscription.CalculateMiningFeeAmount();
+
+    REQUIRE_NOTHROW(inscription.SignCommit(w->keyreg(), "fund"));
+    REQUIRE_NOTHROW(inscription.SignInscription(w->keyreg(), "inscribe"));
+
+    stringvector rawtxs;
+    REQUIRE_NOTHROW(rawtxs = inscription.RawTransactions());
+
+    CMutableTransaction commitTx, genesisTx;
+    REQUIRE(DecodeHexTx(commitTx, rawtxs[0]));
+    REQUIRE(DecodeHexTx(genesisTx, rawtxs[1]));
+
+    CHECK(commitTx.vout.size() == 1);
+    CHECK(CalculateTxFee(3000, commitTx) + CalculateTxFee(3000, genesisTx) == mining_fee);
+    CHECK(commitTx.vout[0].nValue - genesisTx.vout[0].nValue - genesisTx.vout[1].nValue == CalculateTxFee(3000, genesisTx) + dust_change);
+}
+
+
+TEST_CASE("inscription_quote")
+{
+    auto content_size = GENERATE(0, 100, 521, 65536);
+    auto metadata_size = GENERATE(0, 700);
+    std::vector<CAmount> fee_rates = {1000, 3000, 12345};
+
+    InscriptionQuoteParams params;
+    params.content_type_size = 10;
+    params.content_size = content_size;
+    params.metadata_size = metadata_size;
+    params.change = false;
+    params.market_fee = 1000;
+
+    InscriptionQuote quote = CreateInscriptionBuilder::Quote(params, fee_rates);
+    REQUIRE(quote.total_cost.size() == fee_rates.size());
+
+    // The quote has to match the funds a builder requires for the same terms with one taproot input
+    for (size_t i = 0; i < fee_rates.size(); ++i) {
+        CreateInscriptionBuilder inscription(w->chain(), INSCRIPTION);
+        REQUIRE_NOTHROW(inscription.MarketFee(1000, w->p2tr(0,0,1)));
+        REQUIRE_NOTHROW(inscription.MiningFeeRate(fee_rates[i]));
+        REQUIRE_NOTHROW(inscription.OrdOutput(546, w->p2tr(0,0,0)));
+        REQUIRE_NOTHROW(inscription.ChangeAddress(w->p2tr(0,0,1)));
+        REQUIRE_NOTHROW(inscription.InscribeScriptPubKey(w->derive(86,0,0,0).GetSchnorrKeyPair().GetPubKey()));
+        REQUIRE_NOTHROW(inscription.InscribeInternalPubKey(w->derive(86,4,0,0).GetSchnorrKeyPair().GetPubKey()));
+        REQUIRE_NOTHROW(inscription.Data("text/plain", bytevector(content_size, 'a')));
+        if (metadata_size) REQUIRE_NOTHROW(inscription.MetaData(MetaDataOfSize(metadata_size)));
+
+        CHECK(quote.total_cost[i] == inscription.CalculateMissingAmount(w->p2tr(0,0,0)));
+    }
+
+    params.change = true;
+    params.collection = true;
+    InscriptionQuote collection_quote = CreateInscriptionBuilder::Quote(params, fee_rates);
+    CHECK(collection_quote.commit_vsize == quote.commit_vsize + 2 * 43);
+    CHECK(collection_quote.genesis_vsize > quote.genesis_vsize);
+    CHECK(collection_quote.total_cost.back() > quote.total_cost.back());
+}
+
+
 TEST_CASE("inscribe")
 {
     std::string destination_addr = w->btc().GetNewAddress();
@@ -7,6 +7,8 @@
 #include "nlohmann/json.hpp"
 
 #include "util/translation.h"
+#include "streams.h"
+#include "crypto/common.h"
 
 #include "inscription_common.hpp"
 #include "inscription.hpp"
@@ -18,6 +20,8 @@
 #include "mnemonic.hpp"
 #include "psbt.hpp"
 #include "create_inscription.hpp"
+#include "inscription_scanner.hpp"
+#include "block_file.hpp"
 
 const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
 
@@ -93,6 +97,101 @@ TEST_CASE("parsehex")
     std::list<Inscription> inscriptions;
     REQUIRE_NOTHROW(inscriptions = ParseInscriptions(std::get<0>(condition)));
     REQUIRE(inscriptions.size() == std::get<1>(condition));
+
+    bytevector raw_tx = unhex<bytevector>(std::get<0>(condition));
+    std::vector<InscriptionView> views;
+    REQUIRE_NOTHROW(views = ParseInscriptions(raw_tx));
+    REQUIRE(views.size() == inscriptions.size());
+
+    auto inscription_it = inscriptions.begin();
+    for (const auto& view: views) {
+        CHECK(view.GetInscriptionId() == inscription_it->GetIscriptionId());
+        CHECK(view.GetContentType() == inscription_it->GetContentType());
+        CHECK(view.GetContentSize() == inscription_it->GetContent().size());
+        CHECK(view.GetContent() == inscription_it->GetContent());
+        ++inscription_it;
+    }
+
+    CTransaction tx(DecodeHexTx(std::get<0>(condition)));
+    CHECK(ParseInscriptions(tx).size() == inscriptions.size());
+
+    raw_tx.push_back(0);
+    CHECK_THROWS_AS(ParseInscriptions(raw_tx), InscriptionFormatError);
+}
+
+TEST_CASE("analyzetx")
+{
+    CTransaction tx(DecodeHexTx(tx_hex2));
+
+    TxAnalysis analysis;
+    REQUIRE_NOTHROW(analysis = AnalyzeTransaction("mainnet", tx_hex2));
+
+    CHECK(analysis.txid == tx.GetHash().GetHex());
+    CHECK(analysis.wtxid == tx.GetWitnessHash().GetHex());
+    CHECK_FALSE(analysis.runestone);
+    CHECK_FALSE(analysis.cenotaph);
+
+    auto inscriptions = ParseInscriptions(tx_hex2);
+    REQUIRE(analysis.inscriptions.size() == inscriptions.size());
+    CHECK(analysis.inscriptions.front().GetIscriptionId() == inscriptions.front().GetIscriptionId());
+    CHECK(analysis.inscriptions.front().GetContent() == inscriptions.front().GetContent());
+
+    REQUIRE(analysis.outputs.size() == tx.vout.size());
+    for (size_t i = 0; i < tx.vout.size(); ++i) {
+        const auto& script = tx.vout[i].scriptPubKey;
+        CHECK(analysis.outputs[i].amount == tx.vout[i].nValue);
+        CHECK((analysis.outputs[i].type == ScriptType::P2TR) == IsTaproot(tx.vout[i]));
+        CHECK(analysis.outputs[i].address == GetAddress("mainnet", bytevector(script.begin(), script.end())));
+    }
+
+    std::vector<TxAnalysis> batch;
+    REQUIRE_NOTHROW(batch = AnalyzeTransactions("mainnet", {tx_hex1, tx_hex2, tx_hex3}));
+    REQUIRE(batch.size() == 3);
+    CHECK(batch[1].txid == analysis.txid);
+    CHECK(batch[2].inscriptions.size() == 20);
+
+    CHECK_THROWS_AS(AnalyzeTransaction("unknown", tx_hex2), l15::IllegalArgument);
+}
+
+TEST_CASE("scanblocks")
+{
+    std::vector<std::string> txs = {tx_hex1, tx_hex2, tx_hex3, tx_hex4, tx_hex5};
+
+    CBlock block;
+    for (const auto& hex: txs) block.vtx.emplace_back(MakeTransactionRef(DecodeHexTx(hex)));
+
+    DataStream data;
+    data << TX_WITH_WITNESS(block);
+
+    bytevector blk_file;
+    const auto magic = BlockFileMagic(MAINNET);
+    uint8_t size[4];
+    WriteLE32(size, data.size());
+    blk_file.insert(blk_file.end(), magic.begin(), magic.end());
+    blk_file.insert(blk_file.end(), size, size + sizeof(size));
+    for (size_t i = 0; i < data.size(); ++i) blk_file.push_back(static_cast<uint8_t>(data[i]));
+    // Preallocated file tail
+    blk_file.resize(blk_file.size() + 64, 0);
+
+    std::vector<std::string> expected_ids;
+    for (const auto& hex: txs) {
+        for (const auto& inscription: ParseInscriptions(hex)) expected_ids.emplace_back(inscription.GetIscriptionId());
+    }
+
+    size_t block_count = 0;
+    InscriptionBlockScanner scanner(MAINNET, 2);
+    REQUIRE_NOTHROW(scanner.ScanBlocks(blk_file, [&](const uint256& block_hash, const std::vector<InscriptionView>& inscriptions) {
+        ++block_count;
+        CHECK(block_hash == block.GetHash());
+        REQUIRE(inscriptions.size() == expected_ids.size());
+        for (size_t i = 0; i < inscriptions.size(); ++i) {
+            CHECK(inscriptions[i].GetInscriptionId() == expected_ids[i]);
+        }
+    }));
+    CHECK(block_count == 1);
+
+    blk_file[0] ^= 0xff;
+    CHECK_THROWS_AS(scanner.ScanBlocks(blk_file, [](const uint256&, const std::vector<InscriptionView>&) {}), InscriptionFormatError);
 }
 
 //static const std::string txid_multi = "3909230ce028376a7da9bbe888dc91707690d9a3c6130380d19f6fad7f7380d7";
@@ -14,6 +14,10 @@
 
 #include "../testlib/test_case_wrapper.hpp"
 #include "runes.hpp"
+#include "rune_ledger.hpp"
+#include "rune_distribution.hpp"
+#include "streams.h"
+#include "crypto/common.h"
 using namespace l15;
 using namespace l15::core;
 using namespace utxord;
@@ -108,7 +112,7 @@ TEST_CASE("encode")
             readrunetest{uint128_t(51), "AZ"},
             readrunetest{uint128_t(52), "BA"},
             readrunetest{uint128_t(702), "AAA"},
-            readrunetest{std::numeric_limits<uint128_t>::max(), "BCGDENLQRQWDSLRUGSNLBTMFIJAV"}
+            readrunetest{MAX_UINT128, "BCGDENLQRQWDSLRUGSNLBTMFIJAV"}
         );
 
     SECTION("Decode") {
@@ -157,11 +161,11 @@ TEST_CASE("varint")
             varinttest{0, {0x0u}},
             varinttest{1, {0x1u}},
             varinttest{127, {0x7fu}},
-            varinttest{0, {0x80u, 0x00u}},
-            varinttest{127, {0x80u, 0x7fu}},
-            varinttest{128, {0x81u, 0x00u}}
-            // varinttest{65535, {0x82u, 0xfeu, 0x7fu}},
-            // varinttest{uint128_t(1u) << 32, {0x8Eu, 0xFEu, 0xFEu, 0xFFu, 0x00u}}
+            varinttest{128, {0x80u, 0x01u}},
+            varinttest{300, {0xacu, 0x02u}},
+            varinttest{65535, {0xffu, 0xffu, 0x03u}},
+            varinttest{uint128_t(1u) << 32, {0x80u, 0x80u, 0x80u, 0x80u, 0x10u}},
+            varinttest{MAX_UINT128, {0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0x03u}}
         );
 
     SECTION("read") {
@@ -176,3 +180,705 @@ TEST_CASE("varint")
         CHECK(res == testval.varint);
     }
 }
+
+struct decimaltest
+{
+    uint128_t value;
+    std::string text;
+};
+
+TEST_CASE("varint_wrong")
+{
+    bytevector truncated = {0x80u, 0x80u};
+    bytevector::const_iterator i = truncated.begin();
+    CHECK_THROWS(read_varint(i, truncated.cend()));
+
+    bytevector overflow = {0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0xffu, 0x04u};
+    i = overflow.begin();
+    CHECK_THROWS_AS(read_varint(i, overflow.cend()), std::overflow_error);
+}
+
+TEST_CASE("runestone_pack")
+{
+    RuneStone runestone{};
+    runestone.AddAction(RuneAction::ETCH);
+    runestone.AddAction(RuneAction::TERMS);
+    runestone.rune = EncodeRune("UTXORDRUNESTONE");
+    runestone.spacers = 0x21;
+    runestone.symbol = 0x20BF;
+    runestone.divisibility = 8;
+    runestone.premine_amount = uint128_t(std::numeric_limits<uint64_t>::max()) * 1000;
+    runestone.mint_cap = 100;
+    runestone.mint_height_start = 840000;
+    runestone.mint_rune_id.emplace(840000, 7);
+    runestone.op_dictionary.emplace(RuneId(840000, 7), std::make_tuple(uint128_t(500), 1));
+    runestone.op_dictionary.emplace(RuneId(840001, 2), std::make_tuple(uint128_t(1000), 2));
+
+    bytevector packed;
+    REQUIRE_NOTHROW(packed = runestone.Pack());
+    CHECK(packed.size() <= 80);
+
+    RuneStone unpacked{};
+    REQUIRE_NOTHROW(unpacked.Unpack(std::span<const uint8_t>(packed.data(), packed.size())));
+
+    CHECK(unpacked.action_flags == runestone.action_flags);
+    CHECK(unpacked.rune == runestone.rune);
+    CHECK(unpacked.spacers == runestone.spacers);
+    CHECK(unpacked.symbol == runestone.symbol);
+    CHECK(unpacked.divisibility == runestone.divisibility);
+    CHECK(unpacked.premine_amount == runestone.premine_amount);
+    CHECK(unpacked.mint_cap == runestone.mint_cap);
+    CHECK(unpacked.mint_height_start == runestone.mint_height_start);
+    REQUIRE(unpacked.mint_rune_id);
+    CHECK(unpacked.mint_rune_id->chain_height == 840000);
+    CHECK(unpacked.mint_rune_id->tx_index == 7);
+    CHECK(unpacked.default_output == 2);
+    REQUIRE(unpacked.op_dictionary.size() == 1);
+    CHECK(unpacked.op_dictionary.begin()->first.chain_height == 840000);
+    CHECK(unpacked.op_dictionary.begin()->first.tx_index == 7);
+    CHECK(get<0>(unpacked.op_dictionary.begin()->second) == 500);
+    CHECK(get<1>(unpacked.op_dictionary.begin()->second) == 1);
+
+    for (uint32_t i = 0; i < 10; ++i)
+        runestone.op_dictionary.emplace(RuneId(840002 + i, i), std::make_tuple(MAX_UINT128, i + 3));
+    CHECK_THROWS_AS(runestone.Pack(), ContractTermWrongValue);
+}
+
+namespace {
+
+std::shared_ptr<CBlock> MakeRuneBlock(const uint256& prev_hash, uint64_t height, std::vector<CMutableTransaction> txs)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back(COutPoint());
+    coinbase.vin.back().scriptSig = CScript() << static_cast<int64_t>(height);
+    coinbase.vout.emplace_back(5000000000, CScript() << OP_TRUE);
+
+    auto block = std::make_shared<CBlock>();
+    block->hashPrevBlock = prev_hash;
+    block->vtx.emplace_back(MakeTransactionRef(move(coinbase)));
+    for (auto& tx: txs) block->vtx.emplace_back(MakeTransactionRef(move(tx)));
+    return block;
+}
+
+}
+
+TEST_CASE("rune_ledger")
+{
+    const uint64_t height = 840000;
+    const CScript owner_script = CScript() << OP_1 << bytevector(32, 1);
+    const CScript recipient_script = CScript() << OP_1 << bytevector(32, 2);
+
+    Rune rune("UTXORD•LEDGER•TEST", "•");
+    rune.Divisibility(2);
+
+    CMutableTransaction etch_tx;
+    etch_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 0));
+    etch_tx.vout.emplace_back(546, owner_script);
+    etch_tx.vout.emplace_back(0, RuneStoneDestination(REGTEST, rune.EtchAndMint(1000000, 0)).PubKeyScript());
+    const Txid etch_txid = CTransaction(etch_tx).GetHash();
+
+    auto block1 = MakeRuneBlock(uint256(), height, {etch_tx});
+    const RuneId rune_id(height, 1);
+
+    RuneStone transfer {};
+    transfer.op_dictionary.emplace(rune_id, std::make_tuple(uint128_t(300000), 1));
+    transfer.op_dictionary.emplace(rune_id, std::make_tuple(uint128_t(700000), 0));
+
+    CMutableTransaction transfer_tx;
+    transfer_tx.vin.emplace_back(COutPoint(etch_txid, 0));
+    transfer_tx.vout.emplace_back(546, owner_script);
+    transfer_tx.vout.emplace_back(546, recipient_script);
+    transfer_tx.vout.emplace_back(0, RuneStoneDestination(REGTEST, transfer).PubKeyScript());
+    const Txid transfer_txid = CTransaction(transfer_tx).GetHash();
+
+    auto block2 = MakeRuneBlock(block1->GetHash(), height + 1, {transfer_tx});
+
+    auto check_transferred = [&](const RuneLedger& ledger) {
+        CHECK(ledger.Height() == height + 2);
+        CHECK(ledger.TipHash() == block2->GetHash());
+        CHECK_FALSE(ledger.GetBalances(COutPoint(etch_txid, 0)));
+
+        const RuneBalances* owner = ledger.GetBalances(COutPoint(transfer_txid, 0));
+        REQUIRE(owner);
+        CHECK(owner->at(rune_id) == 700000);
+
+        const RuneBalances* recipient = ledger.GetBalances(COutPoint(transfer_txid, 1));
+        REQUIRE(recipient);
+        CHECK(recipient->at(rune_id) == 300000);
+    };
+
+    SECTION("blocks") {
+        RuneLedger ledger(REGTEST, height);
+
+        // Child block is kept until its parent comes
+        REQUIRE_NOTHROW(ledger.ProcessBlock(block2));
+        CHECK(ledger.Height() == height);
+        CHECK(ledger.CountPendingBlocks() == 1);
+
+        REQUIRE_NOTHROW(ledger.ProcessBlock(block1));
+        CHECK(ledger.CountPendingBlocks() == 0);
+        check_transferred(ledger);
+
+        const RuneEntry* entry = ledger.GetRune(rune_id);
+        REQUIRE(entry);
+        CHECK(entry->premine == 1000000);
+        CHECK(entry->divisibility == 2);
+        REQUIRE(ledger.LookupRune(entry->rune));
+        CHECK(ledger.LookupRune(entry->rune)->tx_index == 1);
+
+        REQUIRE_NOTHROW(ledger.Rollback());
+        CHECK(ledger.Height() == height + 1);
+        CHECK_FALSE(ledger.GetBalances(COutPoint(transfer_txid, 0)));
+        const RuneBalances* etched = ledger.GetBalances(COutPoint(etch_txid, 0));
+        REQUIRE(etched);
+        CHECK(etched->at(rune_id) == 1000000);
+
+        REQUIRE_NOTHROW(ledger.Rollback());
+        CHECK(ledger.Height() == height);
+        CHECK_FALSE(ledger.GetRune(rune_id));
+        CHECK_FALSE(ledger.GetBalances(COutPoint(etch_txid, 0)));
+        CHECK_THROWS_AS(ledger.Rollback(), ContractStateError);
+    }
+
+    SECTION("block_file") {
+        std::stringstream blk_file;
+        for (const auto& block: {block2, block1}) {
+            DataStream data;
+            data << TX_WITH_WITNESS(*block);
+            uint8_t size[4];
+            WriteLE32(size, data.size());
+            blk_file.write("\xfa\xbf\xb5\xda", 4);
+            blk_file.write(reinterpret_cast<const char*>(size), sizeof(size));
+            blk_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+
+        RuneLedger ledger(REGTEST, height);
+        REQUIRE_NOTHROW(ledger.ProcessBlockFile(blk_file));
+        check_transferred(ledger);
+    }
+}
+
+namespace {
+
+CScript RuneStoneScript(const bytevector& payload)
+{ return CScript() << OP_RETURN << OP_13 << payload; }
+
+bytevector Concat(bytevector data, const bytevector& tail)
+{
+    data.insert(data.end(), tail.begin(), tail.end());
+    return data;
+}
+
+}
+
+TEST_CASE("runestone_cenotaph")
+{
+    const uint128_t rune_name = EncodeRune("UTXORDCENOTAPH");
+    const bytevector rune_field = Concat({(uint8_t)RuneTag::RUNE}, write_varint(rune_name));
+    const bytevector etching = Concat({(uint8_t)RuneTag::FLAGS, 1}, rune_field);
+
+    auto unpack = [](const bytevector& payload) {
+        RuneStone runestone{};
+        REQUIRE_NOTHROW(runestone.Unpack(std::span<const uint8_t>(payload.data(), payload.size())));
+        return runestone;
+    };
+
+    SECTION("unknown_even_tag") {
+        RuneStone runestone = unpack(Concat(etching, {24, 1}));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+    }
+
+    SECTION("unknown_odd_tag") {
+        RuneStone runestone = unpack(Concat(etching, {25, 1}));
+        CHECK_FALSE(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+    }
+
+    SECTION("truncated_unknown_tag") {
+        RuneStone runestone = unpack(Concat(etching, {24}));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+    }
+
+    SECTION("wrong_varint") {
+        RuneStone runestone = unpack(Concat(etching, {24, 0x80}));
+        CHECK(runestone.cenotaph);
+        CHECK_FALSE(runestone.rune);
+    }
+
+    SECTION("invalid_field_value") {
+        RuneStone runestone = unpack(Concat(Concat(rune_field, {(uint8_t)RuneTag::FLAGS, 3, (uint8_t)RuneTag::MINT_HEIGHT_START}), write_varint(uint128_t(1) << 64)));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+        CHECK_FALSE(runestone.mint_height_start);
+    }
+
+    SECTION("invalid_odd_field_value") {
+        RuneStone runestone = unpack(Concat(etching, {(uint8_t)RuneTag::DIVISIBILITY, MAX_DIVISIBILITY + 1}));
+        CHECK_FALSE(runestone.cenotaph);
+        CHECK_FALSE(runestone.divisibility);
+    }
+
+    SECTION("duplicated_even_tag") {
+        RuneStone runestone = unpack(Concat(Concat(etching, {(uint8_t)RuneTag::RUNE}), write_varint(rune_name + 1)));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+    }
+
+    SECTION("duplicated_odd_tag") {
+        RuneStone runestone = unpack(Concat(etching, {(uint8_t)RuneTag::DIVISIBILITY, 2, (uint8_t)RuneTag::DIVISIBILITY, 3}));
+        CHECK_FALSE(runestone.cenotaph);
+        CHECK(runestone.divisibility == 2);
+    }
+
+    SECTION("field_without_flag") {
+        auto flags_tag = GENERATE(
+                std::make_tuple(uint8_t(0), RuneTag::RUNE),
+                std::make_tuple(uint8_t(0), RuneTag::PREMINE_AMOUNT),
+                std::make_tuple(uint8_t(1), RuneTag::MINT_CAP),
+                std::make_tuple(uint8_t(1), RuneTag::PER_MINT_AMOUNT),
+                std::make_tuple(uint8_t(1), RuneTag::MINT_HEIGHT_START),
+                std::make_tuple(uint8_t(1), RuneTag::MINT_HEIGHT_END),
+                std::make_tuple(uint8_t(1), RuneTag::MINT_OFFSET_START),
+                std::make_tuple(uint8_t(1), RuneTag::MINT_OFFSET_END),
+                std::make_tuple(uint8_t(2), RuneTag::MINT_CAP));
+        const auto& [flags, tag] = flags_tag;
+
+        RuneStone runestone = unpack({(uint8_t)RuneTag::FLAGS, flags, (uint8_t)tag, 100});
+        CHECK(runestone.cenotaph);
+        CHECK_FALSE(runestone.rune);
+        CHECK_FALSE(runestone.premine_amount);
+        CHECK_FALSE(runestone.mint_cap);
+        CHECK_FALSE(runestone.per_mint_amount);
+        CHECK_FALSE(runestone.mint_height_start);
+        CHECK_FALSE(runestone.mint_height_end);
+        CHECK_FALSE(runestone.mint_height_offset_start);
+        CHECK_FALSE(runestone.mint_height_offset_end);
+    }
+
+    SECTION("turbo_flag") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::FLAGS, 5});
+        CHECK_FALSE(runestone.cenotaph);
+        CHECK(runestone.HasAction(RuneAction::ETCH));
+        CHECK(runestone.HasAction(RuneAction::TURBO));
+    }
+
+    SECTION("unknown_flag") {
+        auto flags = GENERATE(uint128_t(1) << 3, uint128_t(1) << (uint8_t)RuneAction::BURN);
+        RuneStone runestone = unpack(Concat(Concat(rune_field, {(uint8_t)RuneTag::FLAGS}), write_varint(flags | 1)));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.rune == rune_name);
+    }
+
+    SECTION("supply_overflow") {
+        bytevector payload = Concat({(uint8_t)RuneTag::FLAGS, 3, (uint8_t)RuneTag::PREMINE_AMOUNT, 1, (uint8_t)RuneTag::MINT_CAP}, write_varint(MAX_UINT128));
+        payload = Concat(payload, {(uint8_t)RuneTag::PER_MINT_AMOUNT, 1});
+        RuneStone runestone = unpack(payload);
+        CHECK(runestone.cenotaph);
+
+        payload.back() = 0;
+        CHECK_FALSE(unpack(payload).cenotaph);
+    }
+
+    SECTION("mint") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::MINT, 1, (uint8_t)RuneTag::MINT, 2});
+        CHECK_FALSE(runestone.cenotaph);
+        REQUIRE(runestone.mint_rune_id);
+        CHECK(runestone.mint_rune_id->chain_height == 1);
+        CHECK(runestone.mint_rune_id->tx_index == 2);
+    }
+
+    SECTION("mint_single_value") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::MINT, 1});
+        CHECK(runestone.cenotaph);
+        CHECK_FALSE(runestone.mint_rune_id);
+    }
+
+    SECTION("mint_third_value") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::MINT, 1, (uint8_t)RuneTag::MINT, 2, (uint8_t)RuneTag::MINT, 3});
+        CHECK(runestone.cenotaph);
+        REQUIRE(runestone.mint_rune_id);
+        CHECK(runestone.mint_rune_id->tx_index == 2);
+    }
+
+    SECTION("mint_zero_block") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::MINT, 0, (uint8_t)RuneTag::MINT, 1});
+        CHECK(runestone.cenotaph);
+        CHECK_FALSE(runestone.mint_rune_id);
+    }
+
+    SECTION("edict_zero_block") {
+        RuneStone runestone = unpack({(uint8_t)RuneTag::BODY, 0, 1, 100, 0});
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.op_dictionary.empty());
+    }
+
+    SECTION("trailing_edict_integers") {
+        RuneStone runestone = unpack(Concat(etching, {(uint8_t)RuneTag::BODY, 1, 2, 3}));
+        CHECK(runestone.cenotaph);
+        CHECK(runestone.op_dictionary.empty());
+    }
+
+    SECTION("payload_opcode") {
+        CMutableTransaction tx;
+        tx.vout.emplace_back(0, RuneStoneScript(etching) << OP_1);
+
+        std::optional<RuneStone> runestone;
+        REQUIRE_NOTHROW(runestone = ParseRuneStone(CTransaction(tx), REGTEST));
+        REQUIRE(runestone);
+        CHECK(runestone->cenotaph);
+        CHECK_FALSE(runestone->rune);
+    }
+
+    SECTION("truncated_push") {
+        bytevector script_bytes = {OP_RETURN, OP_13, 5, (uint8_t)RuneTag::FLAGS, 1};
+        CMutableTransaction tx;
+        tx.vout.emplace_back(0, CScript(script_bytes.begin(), script_bytes.end()));
+
+        std::optional<RuneStone> runestone;
+        REQUIRE_NOTHROW(runestone = ParseRuneStone(CTransaction(tx), REGTEST));
+        REQUIRE(runestone);
+        CHECK(runestone->cenotaph);
+        CHECK(runestone->action_flags == 0);
+    }
+
+    SECTION("mainnet_header") {
+        CMutableTransaction legacy_tx;
+        legacy_tx.vout.emplace_back(0, CScript() << OP_RETURN << bytevector{'R', 'U', 'N', 'E'} << etching);
+        CHECK_FALSE(ParseRuneStone(CTransaction(legacy_tx), MAINNET));
+
+        CMutableTransaction tx;
+        tx.vout.emplace_back(0, RuneStoneScript(etching));
+        std::optional<RuneStone> runestone = ParseRuneStone(CTransaction(tx), MAINNET);
+        REQUIRE(runestone);
+        CHECK_FALSE(runestone->cenotaph);
+        CHECK(runestone->rune == rune_name);
+    }
+
+    SECTION("no_runestone") {
+        CMutableTransaction tx;
+        tx.vout.emplace_back(0, CScript() << OP_RETURN << bytevector(4, 'u'));
+        CHECK_FALSE(ParseRuneStone(CTransaction(tx), REGTEST));
+    }
+}
+
+TEST_CASE("rune_ledger_cenotaph")
+{
+    const uint64_t height = 840000;
+    const CScript owner_script = CScript() << OP_1 << bytevector(32, 1);
+    const bytevector unknown_even_tag = {24, 1};
+
+    CHECK(RESERVED_RUNE == EncodeRune("AAAAAAAAAAAAAAAAAAAAAAAAAAA"));
+
+    RuneStone etching {};
+    etching.AddAction(RuneAction::ETCH);
+    etching.AddAction(RuneAction::TERMS);
+    etching.rune = EncodeRune("UTXORDCENOTAPHMINT");
+    etching.premine_amount = 1000;
+    etching.mint_cap = 10;
+    etching.per_mint_amount = 100;
+
+    CMutableTransaction etch_tx;
+    etch_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 0));
+    etch_tx.vout.emplace_back(546, owner_script);
+    etch_tx.vout.emplace_back(0, RuneStoneScript(etching.Pack()));
+    const Txid etch_txid = CTransaction(etch_tx).GetHash();
+    const RuneId rune_id(height, 1);
+
+    auto block1 = MakeRuneBlock(uint256(), height, {etch_tx});
+
+    // Cenotaph mint spending the premine
+    RuneStone mint {};
+    mint.mint_rune_id = rune_id;
+
+    CMutableTransaction mint_tx;
+    mint_tx.vin.emplace_back(COutPoint(etch_txid, 0));
+    mint_tx.vout.emplace_back(546, owner_script);
+    mint_tx.vout.emplace_back(0, RuneStoneScript(Concat(mint.Pack(), unknown_even_tag)));
+    const Txid mint_txid = CTransaction(mint_tx).GetHash();
+
+    // Cenotaph etching
+    RuneStone cenotaph_etching {};
+    cenotaph_etching.AddAction(RuneAction::ETCH);
+    cenotaph_etching.rune = EncodeRune("UTXORDCENOTAPHETCH");
+    cenotaph_etching.premine_amount = 500;
+
+    CMutableTransaction cenotaph_etch_tx;
+    cenotaph_etch_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 1));
+    cenotaph_etch_tx.vout.emplace_back(546, owner_script);
+    cenotaph_etch_tx.vout.emplace_back(0, RuneStoneScript(Concat(cenotaph_etching.Pack(), unknown_even_tag)));
+    const Txid cenotaph_etch_txid = CTransaction(cenotaph_etch_tx).GetHash();
+
+    // Etching w/o a rune name, valid and cenotaph
+    RuneStone unnamed_etching {};
+    unnamed_etching.AddAction(RuneAction::ETCH);
+    unnamed_etching.premine_amount = 700;
+
+    CMutableTransaction unnamed_etch_tx;
+    unnamed_etch_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 2));
+    unnamed_etch_tx.vout.emplace_back(546, owner_script);
+    unnamed_etch_tx.vout.emplace_back(0, RuneStoneScript(unnamed_etching.Pack()));
+    const Txid unnamed_etch_txid = CTransaction(unnamed_etch_tx).GetHash();
+
+    CMutableTransaction unnamed_cenotaph_tx;
+    unnamed_cenotaph_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 3));
+    unnamed_cenotaph_tx.vout.emplace_back(546, owner_script);
+    unnamed_cenotaph_tx.vout.emplace_back(0, RuneStoneScript(Concat(unnamed_etching.Pack(), unknown_even_tag)));
+
+    auto block2 = MakeRuneBlock(block1->GetHash(), height + 1, {mint_tx, cenotaph_etch_tx, unnamed_etch_tx, unnamed_cenotaph_tx});
+
+    RuneLedger ledger(REGTEST, height);
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block1));
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block2));
+
+    // Mint is counted and burned along with the spent premine
+    const RuneEntry* minted = ledger.GetRune(rune_id);
+    REQUIRE(minted);
+    CHECK(minted->mints == 1);
+    CHECK(minted->burned == 1100);
+    CHECK_FALSE(ledger.GetBalances(COutPoint(etch_txid, 0)));
+    CHECK_FALSE(ledger.GetBalances(COutPoint(mint_txid, 0)));
+
+    // Cenotaph etching creates the rune with zero supply
+    auto cenotaph_rune_id = ledger.LookupRune(*cenotaph_etching.rune);
+    REQUIRE(cenotaph_rune_id);
+    CHECK(cenotaph_rune_id->chain_height == height + 1);
+    CHECK(cenotaph_rune_id->tx_index == 2);
+    const RuneEntry* cenotaph_rune = ledger.GetRune(*cenotaph_rune_id);
+    REQUIRE(cenotaph_rune);
+    CHECK(cenotaph_rune->premine == 0);
+    CHECK_FALSE(cenotaph_rune->terms);
+    CHECK_FALSE(ledger.GetBalances(COutPoint(cenotaph_etch_txid, 0)));
+
+    // Unnamed etching gets the reserved name, unnamed cenotaph etches nothing
+    const RuneEntry* unnamed_rune = ledger.GetRune(RuneId(height + 1, 3));
+    REQUIRE(unnamed_rune);
+    CHECK(unnamed_rune->rune == RESERVED_RUNE + ((uint128_t(height + 1) << 32) | 3));
+    const RuneBalances* unnamed_balances = ledger.GetBalances(COutPoint(unnamed_etch_txid, 0));
+    REQUIRE(unnamed_balances);
+    CHECK(unnamed_balances->at(RuneId(height + 1, 3)) == 700);
+    CHECK_FALSE(ledger.GetRune(RuneId(height + 1, 4)));
+
+    REQUIRE_NOTHROW(ledger.Rollback());
+    CHECK(minted->mints == 0);
+    CHECK(minted->burned == 0);
+    CHECK_FALSE(ledger.LookupRune(*cenotaph_etching.rune));
+    CHECK_FALSE(ledger.GetRune(RuneId(height + 1, 3)));
+    const RuneBalances* premine = ledger.GetBalances(COutPoint(etch_txid, 0));
+    REQUIRE(premine);
+    CHECK(premine->at(rune_id) == 1000);
+}
+
+TEST_CASE("rune_ledger_flaws")
+{
+    const uint64_t height = 840000;
+    const CScript owner_script = CScript() << OP_1 << bytevector(32, 1);
+
+    // Premine is split between two outputs
+    RuneStone etching {};
+    etching.AddAction(RuneAction::ETCH);
+    etching.rune = EncodeRune("UTXORDLEDGERFLAWS");
+    etching.premine_amount = 1000;
+    etching.default_output = 1;
+    etching.op_dictionary.emplace(RuneId(), std::make_tuple(uint128_t(400), 0));
+
+    CMutableTransaction etch_tx;
+    etch_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 0));
+    etch_tx.vout.emplace_back(546, owner_script);
+    etch_tx.vout.emplace_back(546, owner_script);
+    etch_tx.vout.emplace_back(0, RuneStoneScript(etching.Pack()));
+    const Txid etch_txid = CTransaction(etch_tx).GetHash();
+    const RuneId rune_id(height, 1);
+
+    auto block1 = MakeRuneBlock(uint256(), height, {etch_tx});
+
+    // Etching with the supply above 128 bit is a cenotaph: the spent runes are burned
+    RuneStone overflow {};
+    overflow.AddAction(RuneAction::ETCH);
+    overflow.AddAction(RuneAction::TERMS);
+    overflow.rune = EncodeRune("UTXORDSUPPLYOVERFLOW");
+    overflow.premine_amount = 1;
+    overflow.mint_cap = MAX_UINT128;
+    overflow.per_mint_amount = 1;
+    overflow.op_dictionary.emplace(rune_id, std::make_tuple(uint128_t(400), 0));
+
+    CMutableTransaction overflow_tx;
+    overflow_tx.vin.emplace_back(COutPoint(etch_txid, 0));
+    overflow_tx.vout.emplace_back(546, owner_script);
+    overflow_tx.vout.emplace_back(0, RuneStoneScript(overflow.Pack()));
+    const Txid overflow_txid = CTransaction(overflow_tx).GetHash();
+
+    // Burn flag is not a valid action
+    RuneStone burn {};
+    burn.AddAction(RuneAction::BURN);
+    burn.default_output = 0;
+
+    CMutableTransaction burn_tx;
+    burn_tx.vin.emplace_back(COutPoint(etch_txid, 1));
+    burn_tx.vout.emplace_back(546, owner_script);
+    burn_tx.vout.emplace_back(0, RuneStoneScript(burn.Pack()));
+    const Txid burn_txid = CTransaction(burn_tx).GetHash();
+
+    RuneStone turbo {};
+    turbo.AddAction(RuneAction::ETCH);
+    turbo.AddAction(RuneAction::TURBO);
+    turbo.rune = EncodeRune("UTXORDTURBO");
+
+    CMutableTransaction turbo_tx;
+    turbo_tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 1));
+    turbo_tx.vout.emplace_back(546, owner_script);
+    turbo_tx.vout.emplace_back(0, RuneStoneScript(turbo.Pack()));
+
+    auto block2 = MakeRuneBlock(block1->GetHash(), height + 1, {overflow_tx, burn_tx, turbo_tx});
+
+    RuneLedger ledger(REGTEST, height);
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block1));
+
+    const RuneBalances* balances = ledger.GetBalances(COutPoint(etch_txid, 0));
+    REQUIRE(balances);
+    CHECK(balances->at(rune_id) == 400);
+    balances = ledger.GetBalances(COutPoint(etch_txid, 1));
+    REQUIRE(balances);
+    CHECK(balances->at(rune_id) == 600);
+
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block2));
+
+    const RuneEntry* entry = ledger.GetRune(rune_id);
+    REQUIRE(entry);
+    CHECK(entry->burned == 1000);
+    CHECK_FALSE(ledger.GetBalances(COutPoint(overflow_txid, 0)));
+    CHECK_FALSE(ledger.GetBalances(COutPoint(burn_txid, 0)));
+
+    auto overflow_rune_id = ledger.LookupRune(*overflow.rune);
+    REQUIRE(overflow_rune_id);
+    const RuneEntry* overflow_rune = ledger.GetRune(*overflow_rune_id);
+    REQUIRE(overflow_rune);
+    CHECK(overflow_rune->premine == 0);
+    CHECK_FALSE(overflow_rune->terms);
+
+    auto turbo_rune_id = ledger.LookupRune(*turbo.rune);
+    REQUIRE(turbo_rune_id);
+    CHECK(ledger.GetRune(*turbo_rune_id)->turbo);
+}
+
+TEST_CASE("rune_ledger_fork")
+{
+    const uint64_t height = 840000;
+    const CScript owner_script = CScript() << OP_1 << bytevector(32, 1);
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(Txid::FromUint256(uint256::ONE), 0));
+    tx.vout.emplace_back(546, owner_script);
+
+    auto block1 = MakeRuneBlock(uint256(), height, {});
+    auto block_a2 = MakeRuneBlock(block1->GetHash(), height + 1, {});
+    auto block_b2 = MakeRuneBlock(block1->GetHash(), height + 1, {tx});
+    auto block_b3 = MakeRuneBlock(block_b2->GetHash(), height + 2, {});
+
+    RuneLedger ledger(REGTEST, height, uint256(), 100, 4);
+
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block_a2));
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block_b2));
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block_b2));
+    CHECK(ledger.CountPendingBlocks() == 2);
+
+    // Competing blocks wait for a descendant
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block1));
+    CHECK(ledger.Height() == height + 1);
+    CHECK(ledger.TipHash() == block1->GetHash());
+    CHECK(ledger.CountPendingBlocks() == 2);
+
+    // The longer branch wins, the other is dropped
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block_b3));
+    CHECK(ledger.Height() == height + 3);
+    CHECK(ledger.TipHash() == block_b3->GetHash());
+    CHECK(ledger.CountPendingBlocks() == 0);
+
+    // Stale block is dropped
+    REQUIRE_NOTHROW(ledger.ProcessBlock(block_a2));
+    CHECK(ledger.CountPendingBlocks() == 0);
+
+    auto far_block = MakeRuneBlock(uint256::ONE, height + 7, {});
+    CHECK_THROWS_AS(ledger.ProcessBlock(far_block), ContractStateError);
+    CHECK(ledger.CountPendingBlocks() == 0);
+
+    auto orphan = MakeRuneBlock(uint256::ONE, height + 6, {});
+    REQUIRE_NOTHROW(ledger.ProcessBlock(orphan));
+    CHECK(ledger.CountPendingBlocks() == 1);
+}
+
+TEST_CASE("rune_distribution")
+{
+    const RuneId rune_id(840000, 1);
+    const uint128_t airdrop_amount = 1000000000000ull;
+
+    OfflineKeys keys(REGTEST, hex(seed));
+
+    RuneDistributionBuilder distribution(keys.chain(), rune_id, 3000, keys.p2tr(0, 1, 1));
+    distribution.AddRuneUTXO(FakeTxid(1), 0, 10000, keys.p2tr(0, 0, 0), airdrop_amount * 200);
+    for (uint32_t i = 0; i < 4; ++i) {
+        distribution.AddUTXO(FakeTxid(i + 2), 0, 100000, keys.p2tr(0, 0, i + 1));
+    }
+    for (uint32_t i = 0; i < 100; ++i) {
+        distribution.AddRuneOutput(546, keys.p2tr(1, 0, i), airdrop_amount + i);
+    }
+
+    std::vector<std::shared_ptr<SimpleTransaction>> parts;
+    REQUIRE_NOTHROW(parts = distribution.Build());
+    REQUIRE(parts.size() > 1);
+
+    size_t airdrop_count = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const auto& part = parts[i];
+        if (i > 0) {
+            CHECK(part->Inputs()[0].output->TxID() == parts[i - 1]->TxID());
+            CHECK(part->Inputs()[1].output->TxID() == parts[i - 1]->TxID());
+            CHECK(part->Inputs()[1].output->NOut() == parts[i - 1]->ChangeOutput()->NOut());
+        }
+        if (i + 1 < parts.size()) REQUIRE(part->ChangeOutput());
+
+        REQUIRE(part->RuneStoneOutput());
+        auto runestone = std::dynamic_pointer_cast<RuneStoneDestination>(part->RuneStoneOutput()->Destination());
+        REQUIRE(runestone);
+        CHECK(runestone->Pack().size() <= RUNESTONE_MAX_SIZE);
+        airdrop_count += std::count_if(runestone->op_dictionary.begin(), runestone->op_dictionary.end(),
+                                       [&](const auto& edict) { return get<0>(edict.second) < airdrop_amount * 2; });
+
+        CHECK_NOTHROW(part->CheckContractTerms(part->GetVersion(), TX_TERMS));
+        REQUIRE_NOTHROW(part->Sign(keys.keyreg(), "fund"));
+        CHECK_NOTHROW(part->CheckSig());
+    }
+    CHECK(airdrop_count == 100);
+
+    RuneDistributionBuilder poor_distribution(keys.chain(), rune_id, 3000, keys.p2tr(0, 1, 1));
+    poor_distribution.AddRuneUTXO(FakeTxid(1), 0, 10000, keys.p2tr(0, 0, 0), airdrop_amount);
+    poor_distribution.AddRuneOutput(546, keys.p2tr(1, 0, 0), airdrop_amount + 1);
+    CHECK_THROWS_AS(poor_distribution.Build(), ContractFundsNotEnough);
+}
+
+TEST_CASE("uint128_decimal")
+{
+    auto testval = GENERATE(
+            decimaltest{0, "0"},
+            decimaltest{1, "1"},
+            decimaltest{uint128_t(std::numeric_limits<uint64_t>::max()), "18446744073709551615"},
+            decimaltest{uint128_t(std::numeric_limits<uint64_t>::max()) + 1, "18446744073709551616"},
+            decimaltest{uint128_t(10000000000000000000ull) * 10000000000000000000ull, "100000000000000000000000000000000000000"},
+            decimaltest{MAX_UINT128, "340282366920938463463374607431768211455"}
+        );
+
+    CHECK(FormatUInt128(testval.value) == testval.text);
+    CHECK(ParseUInt128(testval.text) == testval.value);
+}
+
+TEST_CASE("uint128_decimal_wrong")
+{
+    CHECK_THROWS_AS(ParseUInt128(""), ContractFormatError);
+    CHECK_THROWS_AS(ParseUInt128("12a"), ContractFormatError);
+    CHECK_THROWS_AS(ParseUInt128("-1"), ContractFormatError);
+    CHECK_THROWS_AS(ParseUInt128("340282366920938463463374607431768211456"), std::overflow_error);
+
+    CHECK(EncodeRune("BCGDENLQRQWDSLRUGSNLBTMFIJAV") == MAX_UINT128);
+    CHECK_THROWS_AS(EncodeRune("BCGDENLQRQWDSLRUGSNLBTMFIJAW"), ContractFormatError);
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
+#include <numeric>
 
 #define CATCH_CONFIG_RUNNER
 #include "catch/catch.hpp"
@@ -13,10 +14,13 @@
 
 #include "test_case_wrapper.hpp"
 #include "simple_transaction.hpp"
+#include "coin_selection.hpp"
+#include "bulk_payout.hpp"
 
 #include "key.h"
 #include "transaction.hpp"
 #include "policy/policy.h"
+#include "consensus/validation.h"
 
 using namespace l15;
 using namespace l15::core;
@@ -68,7 +72,14 @@ int main(int argc, char* argv[])
     return res;
 }
 
-
+// Adds UTXOs with fake txids alternating P2WPKH and P2TR addresses of the "fund" key type
+template <class BUILDER>
+void AddFakeUTXOs(BUILDER& builder, uint32_t count, CAmount amount)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        builder.AddUTXO(FakeTxid(i + 1), 0, amount, (i % 2) ? w->p2tr(0, 0, i) : w->p2wpkh(0, 0, i));
+    }
+}
 
 struct TestCondition {
     KeyPair keypair;
@@ -350,3 +361,269 @@ TEST_CASE("legacyaddr")
 
     w->confirm(1, tx.GetHash().GetHex());
 }
+
+TEST_CASE("txid_cache")
+{
+    SimpleTransaction tx_contract(w->chain());
+    tx_contract.MiningFeeRate(1000);
+    tx_contract.AddUTXO("c8bd1d5d3b2b7a2e4e8e5d0f2f6d9a3c1b4a5e6f708192a3b4c5d6e7f8091a2b", 0, 10000, w->p2tr(0, 0, 1));
+    tx_contract.AddOutput(5000, w->p2tr(0, 0, 2));
+
+    std::string txid = tx_contract.TxID();
+    CHECK(txid == tx_contract.MakeTx("").GetHash().GetHex());
+    CHECK(tx_contract.TxID() == txid);
+
+    REQUIRE_NOTHROW(tx_contract.AddChangeOutput(w->p2tr(0, 1, 1)));
+    CHECK(tx_contract.TxID() != txid);
+    CHECK(tx_contract.TxID() == tx_contract.MakeTx("").GetHash().GetHex());
+    CHECK(tx_contract.ChangeOutput()->TxID() == tx_contract.TxID());
+
+    txid = tx_contract.TxID();
+    REQUIRE_NOTHROW(tx_contract.DropChangeOutput());
+    CHECK(tx_contract.TxID() != txid);
+
+    // Amount changed through the destination is picked up w/o an explicit reset
+    txid = tx_contract.TxID();
+    REQUIRE_NOTHROW(tx_contract.Destinations().front()->Amount(6000));
+    CHECK(tx_contract.TxID() != txid);
+    CHECK(tx_contract.TxID() == tx_contract.MakeTx("").GetHash().GetHex());
+    REQUIRE_NOTHROW(tx_contract.Destinations().front()->Amount(5000));
+
+    std::string raw_unsigned = tx_contract.RawTransactions().front();
+    REQUIRE_NOTHROW(tx_contract.Sign(w->keyreg(), "fund"));
+    CHECK(tx_contract.RawTransactions().front() != raw_unsigned);
+    CHECK(tx_contract.RawTransactions().front() == EncodeHexTx(tx_contract.MakeTx("")));
+}
+
+TEST_CASE("chained_txid_cache")
+{
+    auto parent = std::make_shared<SimpleTransaction>(w->chain());
+    parent->MiningFeeRate(1000);
+    parent->AddUTXO("c8bd1d5d3b2b7a2e4e8e5d0f2f6d9a3c1b4a5e6f708192a3b4c5d6e7f8091a2b", 0, 20000, w->p2tr(0, 0, 1));
+    parent->AddOutput(10000, w->p2tr(0, 0, 2));
+
+    SimpleTransaction child(w->chain());
+    child.MiningFeeRate(1000);
+    child.AddInput(std::make_shared<ContractOutput>(parent, 0));
+    child.AddOutput(9000, w->p2tr(0, 0, 3));
+
+    std::string child_txid = child.TxID();
+    CHECK(child.MakeTx("").vin.front().prevout.hash == parent->TxHash());
+
+    // Parent is changed after the child has cached its transaction
+    REQUIRE_NOTHROW(parent->AddChangeOutput(w->p2tr(0, 1, 1)));
+    CHECK(child.TxID() != child_txid);
+    CHECK(child.TxID() == child.MakeTx("").GetHash().GetHex());
+    CHECK(child.MakeTx("").vin.front().prevout.hash == parent->TxHash());
+
+    child_txid = child.TxID();
+    REQUIRE_NOTHROW(parent->Destinations().front()->Amount(11000));
+    CHECK(child.TxID() != child_txid);
+    CHECK(child.TxID() == child.MakeTx("").GetHash().GetHex());
+
+    // Signing uses the actual parent txid
+    REQUIRE_NOTHROW(parent->Sign(w->keyreg(), "fund"));
+    REQUIRE_NOTHROW(child.Sign(w->keyreg(), "fund"));
+    CHECK(child.RawTransactions().front() == EncodeHexTx(child.MakeTx("")));
+}
+
+TEST_CASE("parallel_sign")
+{
+    auto make_tx = [](uint32_t n) {
+        SimpleTransaction tx_contract(w->chain());
+        tx_contract.MiningFeeRate(1000);
+        AddFakeUTXOs(tx_contract, n, 10000);
+        tx_contract.AddOutput(5000 * n, w->p2tr(1, 0, 0));
+        tx_contract.AddChangeOutput(w->p2tr(0, 1, 1));
+        return tx_contract;
+    };
+
+    SimpleTransaction serial = make_tx(32);
+    SimpleTransaction parallel = make_tx(32);
+    parallel.WorkerThreads(std::make_shared<WorkerPool>(4));
+
+    REQUIRE_NOTHROW(serial.Sign(w->keyreg(), "fund"));
+    REQUIRE_NOTHROW(parallel.Sign(w->keyreg(), "fund"));
+
+    CHECK(parallel.TxID() == serial.TxID());
+    CHECK_NOTHROW(parallel.CheckSig());
+
+    for (uint32_t i = 0; i < serial.Inputs().size(); i += 2) {
+        // ECDSA signatures are deterministic so P2WPKH witnesses must be the same
+        CHECK(static_cast<const std::vector<bytevector>&>(parallel.Inputs()[i].witness) == static_cast<const std::vector<bytevector>&>(serial.Inputs()[i].witness));
+    }
+
+    parallel.SetInputWitness(5, 0, bytevector(64));
+    CHECK_THROWS(parallel.CheckSig());
+}
+
+TEST_CASE("signer_cache")
+{
+    SimpleTransaction tx_contract(w->chain());
+    tx_contract.MiningFeeRate(1000);
+    for (uint32_t i = 0; i < 6; ++i) {
+        tx_contract.AddUTXO(FakeTxid(i + 1), 0, 10000, (i < 3) ? w->p2tr(0, 0, 3) : w->p2wpkh(0, 0, 3));
+    }
+    tx_contract.AddOutput(30000, w->p2tr(1, 0, 0));
+    tx_contract.AddChangeOutput(w->p2tr(0, 1, 1));
+
+    SignerCache signer_cache(w->keyreg(), "fund");
+    auto signers = signer_cache.Signers(tx_contract.Inputs());
+
+    REQUIRE(signers.size() == 6);
+    CHECK(signers[0] == signers[1]);
+    CHECK(signers[0] == signers[2]);
+    CHECK(signers[3] == signers[5]);
+    CHECK(signers[0] != signers[3]);
+
+    xonly_pubkey pk = w->keyreg().Derive("m/86'/1'/0'/0/3", true).GetSchnorrKeyPair().GetPubKey();
+    CHECK(&signer_cache.SchnorrKey(pk) == &signer_cache.SchnorrKey(pk));
+    CHECK(signer_cache.SchnorrKey(pk).GetPubKey() == pk);
+
+    xonly_pubkey pk1 = w->pubkey(0, 0, 4);
+    REQUIRE_NOTHROW(signer_cache.Resolve({tx_contract.Inputs().front().output->Destination().get()}, {pk, pk1, pk1}));
+    CHECK(signer_cache.SchnorrKey(pk1).GetPubKey() == pk1);
+    CHECK(signer_cache.Signer(*tx_contract.Inputs().front().output->Destination()) == signers[0]);
+
+    REQUIRE_NOTHROW(tx_contract.Sign(w->keyreg(), "fund"));
+    CHECK_NOTHROW(tx_contract.CheckSig());
+}
+
+TEST_CASE("fee_weight")
+{
+    SimpleTransaction tx_contract(w->chain());
+    CHECK_THROWS_AS(tx_contract.CalculateWholeFee(""), ContractStateError);
+
+    tx_contract.MiningFeeRate(3000);
+
+    CHECK(tx_contract.CalculateWholeFee("") == CalculateTxFee(3000, tx_contract.MakeTx("")));
+    CHECK(tx_contract.CalculateWholeFee("p2wpkh_utxo") == CalculateTxFee(3000, tx_contract.MakeTx("p2wpkh_utxo")));
+    CHECK(tx_contract.CalculateWholeFee("p2pkh_utxo") == CalculateTxFee(3000, tx_contract.MakeTx("p2pkh_utxo")));
+    CHECK(tx_contract.CalculateWholeFee("p2pkh_utxo") > tx_contract.CalculateWholeFee("p2wpkh_utxo"));
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        tx_contract.AddUTXO(FakeTxid(i + 1), 0, 10000, (i % 2) ? w->p2tr(0, 0, i) : w->p2wpkh(0, 0, i));
+        tx_contract.AddOutput(1000, w->p2tr(1, 0, i));
+        CHECK(tx_contract.CalculateWholeFee("") == CalculateTxFee(3000, tx_contract.MakeTx("")));
+    }
+
+    REQUIRE_NOTHROW(tx_contract.AddChangeOutput(w->p2wpkh(0, 1, 1)));
+    REQUIRE(tx_contract.ChangeOutput());
+    CHECK(tx_contract.CalculateWholeFee("") == CalculateTxFee(3000, tx_contract.MakeTx("")));
+    CHECK(tx_contract.GetMinFundingAmount("") == 50000);
+
+    REQUIRE_NOTHROW(tx_contract.DropChangeOutput());
+    CHECK(tx_contract.CalculateWholeFee("") == CalculateTxFee(3000, tx_contract.MakeTx("")));
+
+    REQUIRE_NOTHROW(tx_contract.AddChangeOutput(w->p2tr(0, 1, 1)));
+    REQUIRE_NOTHROW(tx_contract.Sign(w->keyreg(), "fund"));
+    CHECK(tx_contract.CalculateWholeFee("") == CalculateTxFee(3000, tx_contract.MakeTx("")));
+}
+
+TEST_CASE("coin_selection")
+{
+    CoinSelector selector(w->chain());
+    for (uint32_t i = 0; i < 200; ++i) {
+        selector.AddUTXO(FakeTxid(i + 1), 0, 1000 + i * 997, (i % 2) ? w->p2tr(0, 0, i) : w->p2wpkh(0, 0, i));
+    }
+    std::string tagged_txid = FakeTxid(1000);
+    selector.AddUTXO(tagged_txid, 0, 10000000, w->p2tr(0, 0, 201), "inscription");
+
+    for (CAmount amount: {546, 20000, 150000, 2000000}) {
+        SimpleTransaction tx_contract(w->chain());
+        tx_contract.MiningFeeRate(3000);
+        tx_contract.AddOutput(amount, w->p2tr(1, 0, 0));
+
+        CoinSelectionResult res;
+        REQUIRE_NOTHROW(res = selector.Fund(tx_contract, w->p2tr(0, 1, 1)));
+
+        CHECK(res.inputs.size() == tx_contract.Inputs().size());
+        CHECK(std::none_of(tx_contract.Inputs().begin(), tx_contract.Inputs().end(), [&](const auto& in) { return in.output->TxID() == tagged_txid; }));
+        CHECK(res.change == (bool)tx_contract.ChangeOutput());
+
+        CAmount in_total = std::accumulate(tx_contract.Inputs().begin(), tx_contract.Inputs().end(), CAmount(0), [](CAmount s, const auto& in) { return s + in.output->Amount(); });
+        CAmount out_total = std::accumulate(tx_contract.Destinations().begin(), tx_contract.Destinations().end(), CAmount(0), [](CAmount s, const auto& d) { return s + d->Amount(); });
+
+        REQUIRE_NOTHROW(tx_contract.Sign(w->keyreg(), "fund"));
+        CHECK(in_total - out_total >= CalculateTxFee(3000, tx_contract.MakeTx("")));
+        CHECK(res.fee >= in_total - out_total);
+    }
+
+    SimpleTransaction tx_contract(w->chain());
+    tx_contract.MiningFeeRate(3000);
+    tx_contract.AddOutput(21000000, w->p2tr(1, 0, 0));
+    CHECK_THROWS_AS(selector.Select(tx_contract, w->p2tr(0, 1, 1)), ContractFundsNotEnough);
+
+    CoinSelectionResult res;
+    REQUIRE_NOTHROW(res = selector.Select(tx_contract, w->p2tr(0, 1, 1), {"inscription"}));
+    CHECK(std::any_of(res.inputs.begin(), res.inputs.end(), [&](const auto& in) { return in->TxID() == tagged_txid; }));
+
+    // Candidate added after the pool has been sorted for this fee rate
+    std::string late_txid = FakeTxid(2000);
+    selector.AddUTXO(late_txid, 0, 30000000, w->p2tr(0, 0, 202));
+    REQUIRE_NOTHROW(res = selector.Select(tx_contract, w->p2tr(0, 1, 1)));
+    CHECK(std::any_of(res.inputs.begin(), res.inputs.end(), [&](const auto& in) { return in->TxID() == late_txid; }));
+}
+
+TEST_CASE("bulk_payout")
+{
+    const int64_t max_weight = 4000;
+    BulkPayoutBuilder payout(w->chain(), 3000, w->p2tr(0, 1, 1), max_weight);
+    AddFakeUTXOs(payout, 4, 100000);
+    for (uint32_t i = 0; i < 100; ++i) {
+        payout.AddOutput(1000 + i, (i % 2) ? w->p2tr(1, 0, i) : w->p2wpkh(1, 0, i));
+    }
+
+    std::vector<std::shared_ptr<SimpleTransaction>> parts;
+    REQUIRE_NOTHROW(parts = payout.Build());
+    REQUIRE(parts.size() > 1);
+
+    size_t payout_count = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const auto& part = parts[i];
+        if (i > 0) {
+            CHECK(part->Inputs().front().output->TxID() == parts[i - 1]->TxID());
+            CHECK(part->Inputs().front().output->NOut() == parts[i - 1]->ChangeOutput()->NOut());
+        }
+        if (i + 1 < parts.size()) REQUIRE(part->ChangeOutput());
+
+        payout_count += part->Destinations().size() - (part->ChangeOutput() ? 1 : 0);
+
+        REQUIRE_NOTHROW(part->Sign(w->keyreg(), "fund"));
+        CHECK_NOTHROW(part->CheckSig());
+        CHECK(GetTransactionWeight(CTransaction(part->MakeTx(""))) <= max_weight);
+    }
+    CHECK(payout_count == 100);
+
+    BulkPayoutBuilder poor_payout(w->chain(), 3000, w->p2tr(0, 1, 1), max_weight);
+    poor_payout.AddUTXO(FakeTxid(1), 0, 10000, w->p2tr(0, 0, 0));
+    for (uint32_t i = 0; i < 100; ++i) {
+        poor_payout.AddOutput(1000, w->p2tr(1, 0, i));
+    }
+    CHECK_THROWS_AS(poor_payout.Build(), ContractFundsNotEnough);
+}
+
+TEST_CASE("outpoint")
+{
+    const std::string txid = "c8bd1d5d3b2b7a2e4e8e5d0f2f6d9a3c1b4a5e6f708192a3b4c5d6e7f8091a2b";
+
+    auto tx_contract = std::make_shared<SimpleTransaction>(w->chain());
+    tx_contract->MiningFeeRate(1000);
+    tx_contract->AddUTXO(txid, 1, 10000, w->p2tr(0, 0, 1));
+    tx_contract->AddOutput(5000, w->p2tr(1, 0, 0));
+
+    const SimpleTransaction& const_contract = *tx_contract;
+    CHECK(const_contract.Inputs().front().output->OutPoint() == COutPoint(Txid::FromUint256(uint256S(txid)), 1));
+
+    CMutableTransaction tx = tx_contract->MakeTx("");
+    CHECK(tx.vin.front().prevout.hash.GetHex() == txid);
+    CHECK(tx.vin.front().prevout.n == 1);
+
+    ContractOutput out(tx_contract, 0);
+    CHECK(out.OutPoint() == COutPoint(tx.GetHash(), 0));
+    CHECK(out.TxID() == tx.GetHash().GetHex());
+
+    UTXO utxo(w->chain(), out);
+    CHECK(utxo.OutPoint() == out.OutPoint());
+    CHECK(utxo.TxID() == out.TxID());
+}
@@ -15,6 +15,8 @@
 
 #include <chrono>
 #include <cstdio>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <optional>
@@ -41,6 +43,38 @@ struct TestConfigFactory
     }
 };
 
+inline std::string FakeTxid(uint32_t n)
+{ return (std::ostringstream() << std::hex << std::setw(64) << std::setfill('0') << n).str(); }
+
+// Key registry for the tests signing contracts over fake UTXOs, no node is needed
+struct OfflineKeys
+{
+    l15::ChainMode m_chain;
+    l15::core::KeyRegistry mKeyRegistry;
+
+    OfflineKeys(l15::ChainMode chain, const std::string& seedhex) : m_chain(chain), mKeyRegistry(chain, seedhex)
+    { mKeyRegistry.AddKeyType("fund", R"({"look_cache":true, "key_type":"DEFAULT", "accounts":["0'","1'"], "change":["0","1"], "index_range":"0-256"})"); }
+
+    l15::ChainMode chain() const
+    { return m_chain; }
+
+    l15::core::KeyRegistry& keyreg()
+    { return mKeyRegistry; }
+
+    std::string keypath(uint32_t purpose, uint32_t account, uint32_t change, uint32_t index) const
+    {
+        char buf[32];
+        sprintf(buf, "m/%d'/%d'/%d'/%d/%d", purpose, chain() == l15::MAINNET ? 0 : 1, account, change, index);
+        return {buf};
+    }
+
+    std::string p2tr(uint32_t account, uint32_t change, uint32_t index)
+    { return keyreg().Derive(keypath(86, account, change, index), false).GetP2TRAddress(l15::Bech32(l15::BTC, chain())); }
+
+    std::string p2wpkh(uint32_t account, uint32_t change, uint32_t index)
+    { return keyreg().Derive(keypath(84, account, change, index), false).GetP2WPKHAddress(l15::Bech32(l15::BTC, chain())); }
+};
+
 struct TestcaseWrapper
 {
     static const std::array<const char*, 2048> en_dict;